@@ -0,0 +1,117 @@
+#include "AdvFilter.h"
+
+namespace
+{
+    // AD types (Bluetooth Core Supplement, part A)
+    constexpr uint8_t kAdUuid16Incomplete = 0x02;
+    constexpr uint8_t kAdUuid16Complete = 0x03;
+    constexpr uint8_t kAdUuid128Incomplete = 0x06;
+    constexpr uint8_t kAdUuid128Complete = 0x07;
+    constexpr uint8_t kAdNameShort = 0x08;
+    constexpr uint8_t kAdNameComplete = 0x09;
+    constexpr uint8_t kAdManufacturer = 0xFF;
+}
+
+void AdvIndex::clear()
+{
+    *this = AdvIndex();
+}
+
+uint8_t AdvIndex::matchName(const uint8_t *d, size_t len) const
+{
+    uint8_t hit = 0;
+    for (uint8_t m = nameFirst_[d[0]]; m; m &= m - 1)
+    {
+        uint8_t s = (uint8_t)__builtin_ctz(m);
+        if (len >= names_[s].len && memcmp(d, names_[s].text, names_[s].len) == 0)
+            hit |= (uint8_t)(1u << s);
+    }
+    return hit;
+}
+
+uint8_t AdvIndex::matchUuid16(uint16_t uuid) const
+{
+    uint8_t hit = 0;
+    for (uint8_t m = needUuid16_; m; m &= m - 1)
+    {
+        uint8_t s = (uint8_t)__builtin_ctz(m);
+        if (uuid16_[s] == uuid)
+            hit |= (uint8_t)(1u << s);
+    }
+    return hit;
+}
+
+uint8_t AdvIndex::matchUuid128(const uint8_t *uuid) const
+{
+    uint8_t hit = 0;
+    for (uint8_t m = needUuid128_; m; m &= m - 1)
+    {
+        uint8_t s = (uint8_t)__builtin_ctz(m);
+        if (memcmp(uuid128_[s], uuid, 16) == 0)
+            hit |= (uint8_t)(1u << s);
+    }
+    return hit;
+}
+
+uint8_t AdvIndex::matchMfg(uint16_t id) const
+{
+    uint8_t hit = 0;
+    for (uint8_t m = needMfg_; m; m &= m - 1)
+    {
+        uint8_t s = (uint8_t)__builtin_ctz(m);
+        if (mfg_[s] == id)
+            hit |= (uint8_t)(1u << s);
+    }
+    return hit;
+}
+
+uint8_t AdvIndex::match(const uint8_t *payload, size_t len) const
+{
+    uint8_t hit = matchMask(payload, len);
+    return hit ? (uint8_t)__builtin_ctz(hit) : kNoMatch;
+}
+
+uint8_t AdvIndex::matchMask(const uint8_t *payload, size_t len) const
+{
+    if (!indexed_ || !payload)
+        return 0;
+
+    uint8_t name = 0, uuid16 = 0, uuid128 = 0, mfg = 0;
+    for (size_t i = 0; i + 1 < len;)
+    {
+        const uint8_t n = payload[i];
+        if (n == 0 || i + 1 + n > len)
+            break; // padding or truncated structure
+        const uint8_t type = payload[i + 1];
+        const uint8_t *d = payload + i + 2;
+        const size_t dl = n - 1;
+        switch (type)
+        {
+        case kAdNameShort:
+        case kAdNameComplete:
+            if (dl && needName_)
+                name |= matchName(d, dl);
+            break;
+        case kAdUuid16Incomplete:
+        case kAdUuid16Complete:
+            for (size_t k = 0; needUuid16_ && k + 2 <= dl; k += 2)
+                uuid16 |= matchUuid16((uint16_t)(d[k] | d[k + 1] << 8));
+            break;
+        case kAdUuid128Incomplete:
+        case kAdUuid128Complete:
+            for (size_t k = 0; needUuid128_ && k + 16 <= dl; k += 16)
+                uuid128 |= matchUuid128(d + k);
+            break;
+        case kAdManufacturer:
+            if (dl >= 2 && needMfg_)
+                mfg |= matchMfg((uint16_t)(d[0] | d[1] << 8));
+            break;
+        default:
+            break;
+        }
+        i += n + 1;
+    }
+
+    return indexed_ & (name | ~needName_) & (uuid16 | ~needUuid16_) & (uuid128 | ~needUuid128_) &
+           (mfg | ~needMfg_);
+}
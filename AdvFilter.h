@@ -0,0 +1,103 @@
+#pragma once
+#ifndef ADV_FILTER_H
+#define ADV_FILTER_H
+
+#include <Arduino.h>
+
+// What an advertisement must carry for a handler to want it. Unset fields are
+// not checked; every set field must be present.
+struct AdvCriteria
+{
+    const char *namePrefix = nullptr;        // complete (0x09) or shortened (0x08) local name
+    uint16_t serviceUuid16 = 0;              // in a 16-bit service UUID list
+    const uint8_t *serviceUuid128 = nullptr; // 16 bytes, over-the-air (little-endian) order
+    int32_t manufacturerId = -1;             // company identifier of the 0xFF data
+};
+
+// Precomputed match table over the raw AD payload: one pass over the AD
+// structures, no heap, no virtual calls. Slots are handler indexes; the
+// lowest matching slot wins. add() is constexpr, so a table for criteria
+// known at build time can be a constant (kept in flash, see BLEManager<>).
+class AdvIndex
+{
+public:
+    static constexpr uint8_t kSlots = 8;
+    static constexpr uint8_t kNoMatch = 0xFF;
+    static constexpr size_t kMaxName = 29; // longest name one AD structure can carry
+
+    // false if the criteria are empty or unusable (slot stays unindexed)
+    constexpr bool add(uint8_t slot, const AdvCriteria &c)
+    {
+        if (slot >= kSlots)
+            return false;
+        const uint8_t bit = (uint8_t)(1u << slot);
+        size_t nameLen = 0;
+        while (c.namePrefix && c.namePrefix[nameLen])
+            nameLen++;
+        if (nameLen > kMaxName)
+            return false;
+        if (!nameLen && !c.serviceUuid16 && !c.serviceUuid128 && c.manufacturerId < 0)
+            return false;
+
+        if (nameLen)
+        {
+            names_[slot].len = (uint8_t)nameLen;
+            for (size_t i = 0; i < nameLen; i++)
+                names_[slot].text[i] = c.namePrefix[i];
+            nameFirst_[(uint8_t)c.namePrefix[0]] |= bit;
+            needName_ |= bit;
+        }
+        if (c.serviceUuid16)
+        {
+            uuid16_[slot] = c.serviceUuid16;
+            needUuid16_ |= bit;
+        }
+        if (c.serviceUuid128)
+        {
+            for (size_t i = 0; i < 16; i++)
+                uuid128_[slot][i] = c.serviceUuid128[i];
+            needUuid128_ |= bit;
+        }
+        if (c.manufacturerId >= 0)
+        {
+            mfg_[slot] = (uint16_t)c.manufacturerId;
+            needMfg_ |= bit;
+        }
+        indexed_ |= bit;
+        return true;
+    }
+    void clear();
+
+    // Lowest indexed slot whose criteria all appear in `payload`, else kNoMatch
+    uint8_t match(const uint8_t *payload, size_t len) const;
+    // Bitmask of every indexed slot whose criteria all appear
+    uint8_t matchMask(const uint8_t *payload, size_t len) const;
+    // Bitmask of indexed slots
+    uint8_t indexed() const { return indexed_; }
+
+private:
+    struct Name
+    {
+        uint8_t len;
+        char text[kMaxName];
+    };
+
+    Name names_[kSlots] = {};
+    uint16_t uuid16_[kSlots] = {};
+    uint8_t uuid128_[kSlots][16] = {};
+    uint16_t mfg_[kSlots] = {};
+
+    uint8_t indexed_ = 0;
+    uint8_t needName_ = 0;
+    uint8_t needUuid16_ = 0;
+    uint8_t needUuid128_ = 0;
+    uint8_t needMfg_ = 0;
+    uint8_t nameFirst_[256] = {}; // first name byte -> slots worth a memcmp
+
+    uint8_t matchName(const uint8_t *d, size_t len) const;
+    uint8_t matchUuid16(uint16_t uuid) const;
+    uint8_t matchUuid128(const uint8_t *uuid) const;
+    uint8_t matchMfg(uint16_t id) const;
+};
+
+#endif // ADV_FILTER_H
@@ -0,0 +1,261 @@
+#include "Ahrs.h"
+
+namespace
+{
+    inline float invNorm3(float x, float y, float z)
+    {
+        float n = x * x + y * y + z * z;
+        return n > 0.0f ? 1.0f / sqrtf(n) : 0.0f;
+    }
+}
+
+void Ahrs::reset()
+{
+    q_ = Quaternion();
+    integralFb_ = Axis3();
+    initialised_ = false;
+}
+
+void Ahrs::update(const Axis3 &gyro, const Axis3 &accel, const Axis3 &mag, float dt)
+{
+    bool haveMag = config.useMag && (mag.x != 0.0f || mag.y != 0.0f || mag.z != 0.0f);
+    if (!initialised_)
+    {
+        if (accel.x == 0.0f && accel.y == 0.0f && accel.z == 0.0f)
+            return;
+        seed(accel, mag, haveMag);
+        return;
+    }
+
+    if (config.filter == AhrsFilter::Mahony)
+        mahony(gyro.x, gyro.y, gyro.z, accel.x, accel.y, accel.z, mag.x, mag.y, mag.z, haveMag, dt);
+    else
+        madgwick(gyro.x, gyro.y, gyro.z, accel.x, accel.y, accel.z, mag.x, mag.y, mag.z, haveMag, dt);
+}
+
+void Ahrs::propagate(const Axis3 &gyro, float dt)
+{
+    if (!initialised_)
+        return;
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+    float qDot1 = 0.5f * (-q1 * gyro.x - q2 * gyro.y - q3 * gyro.z);
+    float qDot2 = 0.5f * (q0 * gyro.x + q2 * gyro.z - q3 * gyro.y);
+    float qDot3 = 0.5f * (q0 * gyro.y - q1 * gyro.z + q3 * gyro.x);
+    float qDot4 = 0.5f * (q0 * gyro.z + q1 * gyro.y - q2 * gyro.x);
+    q0 += qDot1 * dt;
+    q1 += qDot2 * dt;
+    q2 += qDot3 * dt;
+    q3 += qDot4 * dt;
+    float n = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q_.w = q0 * n;
+    q_.x = q1 * n;
+    q_.y = q2 * n;
+    q_.z = q3 * n;
+}
+
+void Ahrs::toEuler(const Quaternion &q, Orientation &out)
+{
+    const float w = q.w, x = q.x, y = q.y, z = q.z;
+    out.roll = atan2f(w * x + y * z, 0.5f - x * x - y * y);
+    float s = 2.0f * (w * y - x * z);
+    out.pitch = asinf(constrain(s, -1.0f, 1.0f));
+    out.yaw = atan2f(w * z + x * y, 0.5f - y * y - z * z);
+}
+
+void Ahrs::seed(const Axis3 &accel, const Axis3 &mag, bool haveMag)
+{
+    // Tilt from gravity, heading from the tilt-compensated magnetometer
+    float roll = atan2f(accel.y, accel.z);
+    float pitch = atan2f(-accel.x, sqrtf(accel.y * accel.y + accel.z * accel.z));
+    float yaw = 0.0f;
+    float cr = cosf(roll), sr = sinf(roll);
+    float cp = cosf(pitch), sp = sinf(pitch);
+    if (haveMag)
+    {
+        float bx = mag.x * cp + mag.y * sr * sp + mag.z * cr * sp;
+        float by = mag.y * cr - mag.z * sr;
+        yaw = atan2f(-by, bx);
+    }
+
+    float hr = roll * 0.5f, hp = pitch * 0.5f, hy = yaw * 0.5f;
+    float c1 = cosf(hr), s1 = sinf(hr);
+    float c2 = cosf(hp), s2 = sinf(hp);
+    float c3 = cosf(hy), s3 = sinf(hy);
+    q_.w = c1 * c2 * c3 + s1 * s2 * s3;
+    q_.x = s1 * c2 * c3 - c1 * s2 * s3;
+    q_.y = c1 * s2 * c3 + s1 * c2 * s3;
+    q_.z = c1 * c2 * s3 - s1 * s2 * c3;
+    integralFb_ = Axis3();
+    initialised_ = true;
+}
+
+// Madgwick, "An efficient orientation filter for inertial and inertial/magnetic
+// sensor arrays" (2010): gyro rate plus a normalised gradient-descent step.
+void Ahrs::madgwick(float gx, float gy, float gz, float ax, float ay, float az,
+                    float mx, float my, float mz, bool haveMag, float dt)
+{
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+
+    // Rate of change of quaternion from gyroscope
+    float qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    float an = invNorm3(ax, ay, az);
+    if (an > 0.0f)
+    {
+        ax *= an;
+        ay *= an;
+        az *= an;
+
+        float s0, s1, s2, s3;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+
+        float mn = haveMag ? invNorm3(mx, my, mz) : 0.0f;
+        if (mn > 0.0f)
+        {
+            mx *= mn;
+            my *= mn;
+            mz *= mn;
+
+            float _2q0mx = 2.0f * q0 * mx, _2q0my = 2.0f * q0 * my, _2q0mz = 2.0f * q0 * mz;
+            float _2q1mx = 2.0f * q1 * mx;
+            float _2q0q2 = 2.0f * q0 * q2, _2q2q3 = 2.0f * q2 * q3;
+            float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+            float q1q2 = q1 * q2, q1q3 = q1 * q3, q2q3 = q2 * q3;
+
+            // Reference direction of Earth's magnetic field
+            float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+            float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+            float _2bx = sqrtf(hx * hx + hy * hy);
+            float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+            float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+            // Objective function residuals shared by the gradient terms
+            float fa = 2.0f * q1q3 - _2q0q2 - ax;
+            float fb = 2.0f * q0q1 + _2q2q3 - ay;
+            float fc = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+            float fx = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+            float fy = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+            float fz = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+            s0 = -_2q2 * fa + _2q1 * fb - _2bz * q2 * fx + (-_2bx * q3 + _2bz * q1) * fy + _2bx * q2 * fz;
+            s1 = _2q3 * fa + _2q0 * fb - 4.0f * q1 * fc + _2bz * q3 * fx + (_2bx * q2 + _2bz * q0) * fy + (_2bx * q3 - _4bz * q1) * fz;
+            s2 = -_2q0 * fa + _2q3 * fb - 4.0f * q2 * fc + (-_4bx * q2 - _2bz * q0) * fx + (_2bx * q1 + _2bz * q3) * fy + (_2bx * q0 - _4bz * q2) * fz;
+            s3 = _2q1 * fa + _2q2 * fb + (-_4bx * q3 + _2bz * q1) * fx + (-_2bx * q0 + _2bz * q2) * fy + _2bx * q1 * fz;
+        }
+        else
+        {
+            float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+            float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+            s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+            s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+            s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+            s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+        }
+
+        float sn = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (sn > 0.0f)
+        {
+            sn = config.beta / sqrtf(sn);
+            qDot1 -= sn * s0;
+            qDot2 -= sn * s1;
+            qDot3 -= sn * s2;
+            qDot4 -= sn * s3;
+        }
+    }
+
+    q0 += qDot1 * dt;
+    q1 += qDot2 * dt;
+    q2 += qDot3 * dt;
+    q3 += qDot4 * dt;
+
+    float qn = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q_.w = q0 * qn;
+    q_.x = q1 * qn;
+    q_.y = q2 * qn;
+    q_.z = q3 * qn;
+}
+
+// Mahony et al., "Nonlinear complementary filters on the special orthogonal
+// group" (2008): PI correction of the gyro rate from the accel/mag error.
+void Ahrs::mahony(float gx, float gy, float gz, float ax, float ay, float az,
+                  float mx, float my, float mz, bool haveMag, float dt)
+{
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+
+    float an = invNorm3(ax, ay, az);
+    if (an > 0.0f)
+    {
+        ax *= an;
+        ay *= an;
+        az *= an;
+
+        float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+        float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+        float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+        // Estimated direction of gravity; error is the cross product
+        float halfvx = q1q3 - q0q2;
+        float halfvy = q0q1 + q2q3;
+        float halfvz = q0q0 - 0.5f + q3q3;
+        float halfex = ay * halfvz - az * halfvy;
+        float halfey = az * halfvx - ax * halfvz;
+        float halfez = ax * halfvy - ay * halfvx;
+
+        float mn = haveMag ? invNorm3(mx, my, mz) : 0.0f;
+        if (mn > 0.0f)
+        {
+            mx *= mn;
+            my *= mn;
+            mz *= mn;
+
+            // Reference direction of Earth's magnetic field, then estimated field direction
+            float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+            float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+            float bx = sqrtf(hx * hx + hy * hy);
+            float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+            float halfwx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+            float halfwy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+            float halfwz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+            halfex += my * halfwz - mz * halfwy;
+            halfey += mz * halfwx - mx * halfwz;
+            halfez += mx * halfwy - my * halfwx;
+        }
+
+        if (config.ki > 0.0f)
+        {
+            integralFb_.x += 2.0f * config.ki * halfex * dt;
+            integralFb_.y += 2.0f * config.ki * halfey * dt;
+            integralFb_.z += 2.0f * config.ki * halfez * dt;
+            gx += integralFb_.x;
+            gy += integralFb_.y;
+            gz += integralFb_.z;
+        }
+        else
+        {
+            integralFb_ = Axis3();
+        }
+
+        gx += 2.0f * config.kp * halfex;
+        gy += 2.0f * config.kp * halfey;
+        gz += 2.0f * config.kp * halfez;
+    }
+
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    float qa = q0, qb = q1, qc = q2;
+    q0 += -qb * gx - qc * gy - q3 * gz;
+    q1 += qa * gx + qc * gz - q3 * gy;
+    q2 += qa * gy - qb * gz + q3 * gx;
+    q3 += qa * gz + qb * gy - qc * gx;
+
+    float qn = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q_.w = q0 * qn;
+    q_.x = q1 * qn;
+    q_.y = q2 * qn;
+    q_.z = q3 * qn;
+}
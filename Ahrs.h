@@ -0,0 +1,62 @@
+#pragma once
+#ifndef AHRS_H
+#define AHRS_H
+
+#include <Arduino.h>
+#include "JoyData.h"
+
+// Quaternion attitude estimator (accel + gyro + optional magnetometer).
+// Float-only so it stays on the ESP32-S3 single-precision FPU. Device-agnostic:
+// handlers convert their raw samples to SI units and call update() per sample.
+enum class AhrsFilter : uint8_t
+{
+    Madgwick, // gradient descent, gain = beta
+    Mahony,   // PI feedback on the error vector, gains = kp/ki
+};
+
+struct AhrsConfig
+{
+    AhrsFilter filter = AhrsFilter::Madgwick;
+    float beta = 0.1f; // Madgwick gain (rad/s)
+    float kp = 1.0f;   // Mahony proportional gain
+    float ki = 0.0f;   // Mahony integral gain (gyro bias learning)
+    bool useMag = true;
+};
+
+struct Quaternion
+{
+    float w = 1, x = 0, y = 0, z = 0;
+};
+
+class Ahrs
+{
+public:
+    AhrsConfig config;
+
+    // Forget the attitude; the next update() re-seeds it from accel/mag
+    void reset();
+
+    // gyro rad/s, accel any unit (normalised), mag any unit (zero = absent), dt seconds
+    void update(const Axis3 &gyro, const Axis3 &accel, const Axis3 &mag, float dt);
+    // Gyro-only step, no accel/mag correction (bridging samples that never arrived)
+    void propagate(const Axis3 &gyro, float dt);
+
+    const Quaternion &quaternion() const { return q_; }
+    bool initialised() const { return initialised_; }
+    // Aerospace ZYX Euler angles (rad)
+    void toEuler(Orientation &out) const { toEuler(q_, out); }
+    static void toEuler(const Quaternion &q, Orientation &out);
+
+private:
+    Quaternion q_;
+    Axis3 integralFb_; // Mahony integral term
+    bool initialised_ = false;
+
+    void seed(const Axis3 &accel, const Axis3 &mag, bool haveMag);
+    void madgwick(float gx, float gy, float gz, float ax, float ay, float az,
+                  float mx, float my, float mz, bool haveMag, float dt);
+    void mahony(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx, float my, float mz, bool haveMag, float dt);
+};
+
+#endif // AHRS_H
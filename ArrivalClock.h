@@ -0,0 +1,39 @@
+#pragma once
+#ifndef ARRIVAL_CLOCK_H
+#define ARRIVAL_CLOCK_H
+
+#include <Arduino.h>
+
+// Receive stamps against the controller's own clock. The absolute link
+// delay is not observable from one side, but the fastest packet seen sets a
+// best-case offset between the two clocks: how far a packet arrives behind
+// it is its extra (queueing / connection interval) delay.
+class ArrivalClock
+{
+public:
+    // The device clock may run a little fast against ours: let the best-case
+    // offset creep up by this much per packet (~70 us/s, > 50 ppm)
+    static constexpr int32_t kDriftUsPerPacket = 1;
+
+    // Delay of this packet over the best case so far, in us
+    uint32_t excess(uint32_t stampUs, uint32_t sensorUs)
+    {
+        int32_t offset = (int32_t)(stampUs - sensorUs);
+        if (!valid_ || offset < minOffset_)
+        {
+            minOffset_ = offset;
+            valid_ = true;
+        }
+        uint32_t e = (uint32_t)(offset - minOffset_);
+        minOffset_ += kDriftUsPerPacket;
+        return e;
+    }
+    // New link: the device clock restarted
+    void reset() { valid_ = false; }
+
+private:
+    int32_t minOffset_ = 0;
+    bool valid_ = false;
+};
+
+#endif // ARRIVAL_CLOCK_H
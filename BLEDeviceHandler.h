@@ -1,6 +1,15 @@
 #pragma once
 #include <Arduino.h>
 #include "BLEDevice.h"
+#include "AdvFilter.h"
+
+// GATT attribute handles a handler needs to run a link without discovery
+struct PeerHandles
+{
+    uint16_t write = 0;
+    uint16_t notify = 0;
+    uint16_t cccd = 0;
+};
 
 // Base class for any BLE controller handled by BLEManager.
 class BLEDeviceHandler
@@ -12,6 +21,11 @@ public:
     // NOTE: BLEAdvertisedDevice::getName() is non-const, so arg can't be const here.
     virtual bool matchesAdvertisement(BLEAdvertisedDevice &dev) = 0;
 
+    // Optional: declare what matching advertisements carry. Queried once at
+    // registration; the manager then matches on the raw payload and never
+    // calls matchesAdvertisement() for this handler.
+    virtual bool advertisementCriteria(AdvCriteria &out) const { return false; }
+
     // UUIDs needed to discover the device's service/characteristics
     virtual BLEUUID serviceUuid() const = 0;
     virtual BLEUUID writeCharUuid() const = 0;
@@ -22,8 +36,50 @@ public:
 
     // Connection lifecycle
     virtual bool onConnected(BLEClient *client_) = 0;
+    // BLE task, at the start of the pass after the link dropped
     virtual void onDisconnected() = 0;
 
     // Next-frame send mechanics
     virtual void update(uint32_t tick) = 0;
+    // Milliseconds until update() has timed work (0 = now, UINT32_MAX = only
+    // when woken). The default keeps the old 1 ms polling.
+    virtual uint32_t msUntilNext(uint32_t now) const { return 1; }
+
+    // Installed by BLEManager: wake() from any task (BT callbacks included)
+    // gets update() called without waiting for the next timeout
+    void setWakeHook(void (*fn)(void *ctx), void *ctx)
+    {
+        wakeCtx_ = ctx;
+        wakeFn_ = fn;
+    }
+
+    // Connection slot assigned by BLEManager at registration (0 when used
+    // stand-alone); also the handler's source on the shared HID output
+    void setSlot(uint8_t slot) { slot_ = slot; }
+    uint8_t slot() const { return slot_; }
+
+    // Optional fast reconnect: after onConnected() succeeds, report the handles
+    // to cache; on a later direct connect to the same bonded peer, start the
+    // link from them instead of rediscovering. Notifications then arrive via
+    // onRawNotify() (BLE task) since no BLERemoteCharacteristic exists.
+    virtual bool exportHandles(PeerHandles &out) const { return false; }
+    virtual bool attachCached(BLEClient *client_, const PeerHandles &handles) { return false; }
+    virtual void onRawNotify(uint16_t handle, uint8_t *data, size_t len) {}
+    // Cache-attached link that never got going (the stack takes raw GATT
+    // requests and fails them later, if at all): true once the handler has
+    // given up on starting it. The manager then forgets the cached handles
+    // and drops the link; the reconnect rediscovers
+    virtual bool attachStalled() const { return false; }
+
+protected:
+    void wake() const
+    {
+        if (wakeFn_)
+            wakeFn_(wakeCtx_);
+    }
+
+private:
+    void (*wakeFn_)(void *ctx) = nullptr;
+    void *wakeCtx_ = nullptr;
+    uint8_t slot_ = 0;
 };
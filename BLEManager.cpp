@@ -1,11 +1,12 @@
 #include "BLEManager.h"
 #include "esp_bt_main.h"
 #include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
 
 // static
-BLEManager *BLEManager::active_ = nullptr;
+BLEManagerBase *BLEManagerBase::active_ = nullptr;
 
-class BLEManager::SecurityCallback : public BLESecurityCallbacks
+class BLEManagerBase::SecurityCallback : public BLESecurityCallbacks
 {
     uint32_t onPassKeyRequest() override
     {
@@ -32,75 +33,143 @@ class BLEManager::SecurityCallback : public BLESecurityCallbacks
     }
 };
 
-class BLEManager::ScanResult : public BLEAdvertisedDeviceCallbacks
+class BLEManagerBase::ScanResult : public BLEAdvertisedDeviceCallbacks
 {
 public:
-    explicit ScanResult(BLEManager *mgr) : mgr_(mgr) {}
+    explicit ScanResult(BLEManagerBase *mgr) : mgr_(mgr) {}
     void onResult(BLEAdvertisedDevice advertisedDevice) override
     {
-        // Iterate registered handlers to find a match
-        for (size_t i = 0; i < mgr_->handlerCount_; ++i)
-        {
-            BLEDeviceHandler *h = mgr_->handlers_[i];
-            if (!h)
-                continue;
-            // getName() is non-const; advertisedDevice cannot be const here
-            if (h->matchesAdvertisement(advertisedDevice))
-            {
-                BLELOG("Target matched by handler. Stopping scan...\n");
-                BLEDevice::getScan()->stop();
-                if (mgr_->foundDev_)
-                    delete mgr_->foundDev_;
-                mgr_->foundDev_ = new BLEAdvertisedDevice(advertisedDevice);
-                mgr_->activeHandler_ = h;
-                mgr_->doConnect_ = true;
-                mgr_->doScan_ = false;
-                return;
-            }
-        }
+        // Only slots without a link take a new peripheral, and a peripheral
+        // already linked (or being connected) is not taken twice
+        uint8_t idle = mgr_->idleSlots();
+        if (!idle || mgr_->suspended_ || mgr_->claimed(advertisedDevice.getAddress()))
+            return;
+
+        size_t slot = mgr_->matchSlot(advertisedDevice, idle);
+        if (slot >= mgr_->handlerCount_)
+            return;
+
+        BLELOG("Target matched by handler %u. Stopping scan...\n", (unsigned)slot);
+        BLEDevice::getScan()->stop();
+        Slot &s = mgr_->slots_[slot];
+        if (s.found)
+            delete s.found;
+        s.found = new BLEAdvertisedDevice(advertisedDevice);
+        s.matched = true;
+        mgr_->matchMs_ = millis();
+        mgr_->signal(kEvtMatch);
     }
 
 private:
-    BLEManager *mgr_;
+    BLEManagerBase *mgr_;
 };
 
-class BLEManager::ClientCallback : public BLEClientCallbacks
+class BLEManagerBase::ClientCallback : public BLEClientCallbacks
 {
 public:
-    explicit ClientCallback(BLEManager *mgr) : mgr_(mgr) {}
+    ClientCallback(BLEManagerBase *mgr, size_t slot) : mgr_(mgr), slot_(slot) {}
     void onConnect(BLEClient *pClient) override
     {
-        BLELOG("onConnect()\n");
-        // user-level onConnect is owned by handler->onConnected after discovery
-        mgr_->connected_ = true;
+        BLELOG("onConnect(%u)\n", (unsigned)slot_);
+        // user-level onConnect is owned by handler->onConnected after
+        // discovery; the link counts once the connect task has it live
+        mgr_->slots_[slot_].connected = true;
         mgr_->ledState = SystemState::Connected;
-
+        mgr_->signal(kEvtLink);
     }
     void onDisconnect(BLEClient *pClient) override
     {
-        BLELOG("onDisconnect()\n");
-        if (mgr_->activeHandler_)
-            mgr_->activeHandler_->onDisconnected();
-
-        mgr_->connected_ = false;
-        mgr_->doScan_ = true;
-        mgr_->ledState = SystemState::Idle;
-        BLELOG("Idle...\n");
+        BLELOG("onDisconnect(%u)\n", (unsigned)slot_);
+        // The handler's teardown touches state the BLE task works on (HidOut,
+        // its command queue): update() runs onDisconnected() there
+        Slot &s = mgr_->slots_[slot_];
+        s.lost = true;
+        s.connected = false;
+        if (s.live.exchange(false))
+            mgr_->links_--;
+        s.rawNotify = false;
+        mgr_->linkLostMs_ = millis();
+        // cached peer first, then a fast burst to pick it back up
+        mgr_->signal(kEvtLink | kEvtDirect | kEvtRescan);
+        if (mgr_->links() == 0)
+        {
+            mgr_->ledState = SystemState::Idle;
+            BLELOG("Idle...\n");
+        }
     }
 
 private:
-    BLEManager *mgr_;
+    BLEManagerBase *mgr_;
+    size_t slot_;
 };
 
-BLEManager::BLEManager() {}
+BLEManagerBase::BLEManagerBase() {}
+
+void BLEManagerBase::registerHandler(BLEDeviceHandler *handler)
+{
+    if (handlerCount_ >= kMaxHandlers)
+        return;
+    AdvCriteria criteria;
+    if (handler->advertisementCriteria(criteria))
+        advIndex_.add((uint8_t)handlerCount_, criteria);
+    adoptHandler(handler);
+}
+
+void BLEManagerBase::adoptHandler(BLEDeviceHandler *handler)
+{
+    if (handlerCount_ >= kMaxHandlers)
+        return;
+    handler->setWakeHook(wakeFromHandler, this);
+    handler->setSlot((uint8_t)handlerCount_);
+    slots_[handlerCount_++].handler = handler;
+}
+
+uint8_t BLEManagerBase::matchSlot(BLEAdvertisedDevice &adv, uint8_t idle)
+{
+    // Handlers with declared criteria: one pass over the raw payload
+    uint8_t hits = advIndex_.matchMask(adv.getPayload(), adv.getPayloadLength()) & idle;
+    size_t slot = hits ? (size_t)__builtin_ctz(hits) : handlerCount_;
+
+    // The rest keep the per-handler check; earlier registrations still win
+    for (size_t i = 0; i < slot; ++i)
+    {
+        if (!(idle & (1u << i)) || (advIndex_.indexed() & (1u << i)))
+            continue;
+        // getName() is non-const; adv cannot be const here
+        if (slots_[i].handler->matchesAdvertisement(adv))
+            return (uint8_t)i;
+    }
+    return slot < handlerCount_ ? (uint8_t)slot : AdvIndex::kNoMatch;
+}
 
-void BLEManager::registerHandler(BLEDeviceHandler *handler)
+void BLEManagerBase::serviceLinks(uint32_t tick)
 {
-    if (handlerCount_ < kMaxHandlers)
-        handlers_[handlerCount_++] = handler;
+    const size_t first = nextFirst();
+    for (size_t k = 0; k < handlerCount_; k++)
+    {
+        const size_t i = (first + k) % handlerCount_;
+        // live, not just connected: the connect task may still be in
+        // onConnected() / attachCached()
+        if (linkUp(i))
+            slots_[i].handler->update(tick);
+    }
 }
 
-void BLEManager::init()
+uint32_t BLEManagerBase::linksMsUntilNext(uint32_t now) const
+{
+    uint32_t next = UINT32_MAX;
+    for (size_t i = 0; i < handlerCount_; i++)
+        if (linkUp(i))
+            next = min(next, slots_[i].handler->msUntilNext(now));
+    return next;
+}
+
+void BLEManagerBase::rawNotify(size_t slot, uint16_t handle, uint8_t *data, size_t len)
+{
+    slots_[slot].handler->onRawNotify(handle, data, len);
+}
+
+void BLEManagerBase::init()
 {
     active_ = this;
 
@@ -119,12 +188,24 @@ void BLEManager::init()
 
     BLEScan *scan = BLEDevice::getScan();
     scan->setAdvertisedDeviceCallbacks(new ScanResult(this));
-    scan->setInterval(1349);
-    scan->setWindow(449);
+    scan->setInterval(scan_.config.interval);
+    scan->setWindow(scan_.config.window);
     scan->setActiveScan(true);
 
-    connected_ = false;
-    doScan_ = true;
+    // One client per slot for the lifetime of the manager, reused across reconnects
+    for (size_t i = 0; i < handlerCount_; i++)
+    {
+        slots_[i].client = BLEDevice::createClient();
+        slots_[i].client->setClientCallbacks(new ClientCallback(this, i));
+    }
+
+    // Notifications of links started from cached handles bypass the
+    // library's characteristic map (nothing was discovered)
+    BLEDevice::setCustomGattcHandler(onGattcEvent);
+    peers_.load();
+    linkLostMs_ = millis();
+
+    scan_.begin(millis(), false);
     active_->ledState = SystemState::Idle;
 
     // Start LED Control Thread
@@ -137,13 +218,40 @@ void BLEManager::init()
         &ledTaskHandle, // Handle
         0               // Core 0 (recommended; BLE is on core 1)
     );
+
+    // Connect task: connects and discovery block for seconds on hardware,
+    // so they stay off the task serving the links already up. Below the
+    // BLE task, which preempts it whenever frames come in
+    xTaskCreatePinnedToCore(
+        connectTask,         // Task function
+        "ConnTask",          // Name
+        8192,                // Stack size: discovery and NVS writes
+        this,                // Parameter
+        1,                   // Priority
+        &connectTaskHandle_, // Handle
+        1                    // Core 1
+    );
+
+    // BLE service task: blocks on notifications from the BT callbacks and
+    // handlers instead of being polled from loop()
+    xTaskCreatePinnedToCore(
+        bleTask,         // Task function
+        "BLETask",       // Name
+        8192,            // Stack size: loopTask's; connects, discovery, NVS, AHRS and HID run here
+        this,            // Parameter
+        2,               // Priority (above LED, below the BT controller)
+        &bleTaskHandle_, // Handle
+        1                // Core 1
+    );
+    if (peers_.size() > 0)
+        signal(kEvtDirect);
 }
 
-void BLEManager::ledTask(void* param)
+void BLEManagerBase::ledTask(void* param)
 {
     BLELOG("LED Thread Started\n");
-    BLEManager* mgr = static_cast<BLEManager*>(param);
-    uint32_t last = millis(), blink = 0, timeout = 0;
+    BLEManagerBase* mgr = static_cast<BLEManagerBase*>(param);
+    uint32_t last = millis(), blink = 0;
     for(;;) {
         uint32_t now = millis();
         uint32_t tick = now - last;
@@ -151,16 +259,10 @@ void BLEManager::ledTask(void* param)
         SystemState state = mgr->GetState();
         switch (state) {
             case SystemState::Connected:
-                timeout = 0;
                 neopixelWrite(RGB_BUILTIN, 0, RGB_BRIGHTNESS, 0);
                 break;
             case SystemState::Scanning:
-                timeout += tick;
-                // 5 minutes == 300000 ms
-                if (timeout >= 300000) {
-                    mgr->Timeout();
-                    break;
-                }
+                // scan timeout is owned by the ScanScheduler
                 blink += tick;
                 if (blink >= 500)
                 {
@@ -171,7 +273,6 @@ void BLEManager::ledTask(void* param)
                 }
                 break;
             default:
-                timeout = 0;
                 neopixelWrite(RGB_BUILTIN, 0, 0, 0);
                 break;
         }
@@ -180,50 +281,480 @@ void BLEManager::ledTask(void* param)
     BLELOG("LED Thread Ended\n");
 }
 
-bool BLEManager::connectToServer()
+uint8_t BLEManagerBase::idleSlots() const
 {
-    if (!foundDev_ || !activeHandler_)
-        return false;
+    uint8_t idle = 0;
+    size_t taken = 0;
+    for (size_t i = 0; i < handlerCount_; i++)
+    {
+        const Slot &s = slots_[i];
+        if (s.live || s.connected || s.matched || s.busy)
+            taken++;
+        else if (!s.lost)
+            idle |= (uint8_t)(1u << i);
+    }
+    return taken < kMaxLinks ? idle : 0;
+}
+
+bool BLEManagerBase::claimed(BLEAddress addr) const
+{
+    for (size_t i = 0; i < handlerCount_; i++)
+    {
+        const Slot &s = slots_[i];
+        if (s.connected && s.client && s.client->getPeerAddress().equals(addr))
+            return true;
+        if (s.matched && s.found && s.found->getAddress().equals(addr))
+            return true;
+    }
+    return false;
+}
 
-    String addr = foundDev_->getAddress().toString().c_str();
-    BLELOG("Connecting to %s\n", addr.c_str());
+bool BLEManagerBase::connectToServer(size_t slot)
+{
+    Slot &s = slots_[slot];
+    if (!s.found)
+        return false;
 
-    client_ = BLEDevice::createClient();
-    client_->setClientCallbacks(new ClientCallback(this));
+    BLEAddress addr = s.found->getAddress();
+    BLELOG("Connecting slot %u to %s\n", (unsigned)slot, addr.toString().c_str());
 
-    if (!client_->connect(foundDev_))
+    if (!s.client->connect(s.found))
     {
         BLELOG(" - Unable to connect\n");
         return false;
     }
     // Inform handler
-    return activeHandler_->onConnected(client_);
+    if (!s.handler->onConnected(s.client))
+    {
+        // the slot is idle again once the drop is handled
+        if (s.client->isConnected())
+            s.client->disconnect();
+        return false;
+    }
+
+    // Cache the peer for a scan-free, discovery-free reconnect next time
+    PeerHandles handles;
+    if (s.handler->exportHandles(handles))
+    {
+        peers_.remember(*addr.getNative(), s.found->getAddressType(), (uint8_t)slot, handles);
+        peers_.save();
+    }
+    return true;
+}
+
+size_t BLEManagerBase::connectCached(uint32_t now)
+{
+    const PeerEntry *order[PeerCache::kEntries];
+    size_t n = peers_.ordered(order);
+    size_t linked = 0;
+    for (size_t i = 0; i < n && !full(); i++)
+    {
+        // copy out: failed()/remember() rewrite the slot
+        PeerEntry e = *order[i];
+        if (e.handler >= handlerCount_)
+        {
+            peers_.forget(e.addr);
+            continue;
+        }
+        // its slot has a link already (this peer or another one)
+        Slot &s = slots_[e.handler];
+        if (!(idleSlots() & (1u << e.handler)))
+            continue;
+        s.busy = true;
+        if (linkCached(e))
+        {
+            goLive(e.handler);
+            linked++;
+        }
+        s.busy = false;
+    }
+    peers_.save();
+    return linked;
+}
+
+bool BLEManagerBase::linkCached(const PeerEntry &e)
+{
+    Slot &s = slots_[e.handler];
+    BLEAddress addr(e.addr);
+    BLELOG("Direct connect to cached %s\n", addr.toString().c_str());
+    if (!s.client->connect(addr, (esp_ble_addr_type_t)e.addrType, kDirectConnectMs))
+    {
+        if (!peers_.failed(e.addr))
+            BLELOG(" - Dropped %s from the peer cache\n", addr.toString().c_str());
+        return false;
+    }
+
+    BLEDeviceHandler *h = s.handler;
+    s.stale = false;
+    s.regHandle = e.handles.notify;
+    s.rawNotify = true;
+    if (h->attachCached(s.client, e.handles))
+    {
+        peers_.remember(e.addr, e.addrType, e.handler, e.handles);
+        return true;
+    }
+
+    // Handles went stale (peer firmware changed?): discover on this link
+    BLELOG(" - Cached handles rejected, discovering\n");
+    s.rawNotify = false;
+    s.regHandle = 0;
+    PeerHandles handles;
+    if (s.client->isConnected() && h->onConnected(s.client))
+    {
+        if (h->exportHandles(handles))
+            peers_.remember(e.addr, e.addrType, e.handler, handles);
+        else
+            peers_.forget(e.addr);
+        return true;
+    }
+    peers_.forget(e.addr);
+    if (s.client->isConnected())
+        s.client->disconnect();
+    return false;
+}
+
+void BLEManagerBase::goLive(size_t slot)
+{
+    Slot &s = slots_[slot];
+    links_++;
+    s.live = true;
+    // dropped while being set up: the disconnect callback found it not live
+    if (!s.connected && s.live.exchange(false))
+        links_--;
+}
+
+void BLEManagerBase::connectPass()
+{
+    // seq_cst pair with suspend(): either it waits for this pass, or the
+    // pass sees the suspension and leaves the work for resume()
+    connecting_ = true;
+    if (suspended_)
+    {
+        connecting_ = false;
+        return;
+    }
+    uint32_t work = connectWork_.exchange(0, std::memory_order_acquire);
+
+    // cache-attached links that never got going: forget the entry first so
+    // the reconnect the drop triggers scans and rediscovers
+    for (size_t i = 0; (work & kEvtStale) && i < handlerCount_; i++)
+    {
+        Slot &s = slots_[i];
+        if (!s.stale.exchange(false))
+            continue;
+        BLELOG("Cached handles of slot %u went stale, rediscovering\n", (unsigned)i);
+        peers_.forget(*s.client->getPeerAddress().getNative());
+        peers_.save();
+        if (s.client->isConnected())
+            s.client->disconnect();
+    }
+
+    // bonded peers: straight to the address, no scan, no discovery
+    if ((work & kEvtDirect) && !full() && connectCached(millis()))
+    {
+        lastDirect_ = true;
+        lastConnectMs_ = millis() - linkLostMs_;
+        BLELOG("Connected from cache in %u ms.\n", lastConnectMs());
+    }
+
+    // scan matches
+    uint8_t done = 0;
+    for (size_t i = 0; (work & kEvtMatch) && i < handlerCount_; i++)
+    {
+        Slot &s = slots_[i];
+        if (!s.matched)
+            continue;
+        done |= kMatchTried;
+        // a cached connect took the slot after the match
+        if (s.live || s.connected)
+        {
+            s.matched = false;
+            continue;
+        }
+        s.busy = true;
+        bool ok = connectToServer(i);
+        s.matched = false;
+        if (ok)
+        {
+            goLive(i);
+            lastDirect_ = false;
+            lastConnectMs_ = millis() - linkLostMs_;
+            BLELOG("Connected to server in %u ms.\n", lastConnectMs());
+        }
+        else
+        {
+            done |= kMatchFailed;
+            BLELOG("Failed to connect.\n");
+        }
+        s.busy = false;
+    }
+    connectDone_.fetch_or(done, std::memory_order_release);
+    connecting_ = false;
+    // scan follow-up, and drops during set-up, are the BLE task's
+    signal(kEvtLink);
+}
+
+bool BLEManagerBase::suspend()
+{
+    suspended_ = true;
+    signal(kEvtWake); // the BLE task stops the scan
+    // a connect under way ends, and any link it dropped is torn down
+    for (;;)
+    {
+        bool settling = connecting_;
+        for (size_t i = 0; i < handlerCount_; i++)
+            settling = settling || slots_[i].busy || slots_[i].lost;
+        if (!settling)
+            break;
+        delay(5);
+    }
+    if (links() > 0)
+    {
+        resume();
+        return false;
+    }
+    return true;
+}
+
+void BLEManagerBase::resume()
+{
+    suspended_ = false;
+    // work left while suspended, cached peers, then a fresh scan
+    signal(kEvtDirect | kEvtRescan);
+}
+
+void BLEManagerBase::connectTask(void *param)
+{
+    BLELOG("Connect Thread Started\n");
+    BLEManagerBase *mgr = static_cast<BLEManagerBase *>(param);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        mgr->connectPass();
+    }
+}
+
+void BLEManagerBase::onGattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param)
+{
+    // BT task: only events of cache-attached links are ours: their raw
+    // notifications, routed to the slot whose client owns the connection,
+    // and the outcome of their raw subscribe
+    BLEManagerBase *mgr = active_;
+    if (!mgr)
+        return;
+    if (event == ESP_GATTC_NOTIFY_EVT)
+    {
+        for (size_t i = 0; i < mgr->handlerCount_; i++)
+        {
+            Slot &s = mgr->slots_[i];
+            if (!s.rawNotify || !s.client || param->notify.conn_id != s.client->getConnId())
+                continue;
+            if (s.regHandle.load(std::memory_order_relaxed))
+                s.regHandle.store(0, std::memory_order_relaxed);
+            mgr->rawNotify(i, param->notify.handle, param->notify.value, param->notify.value_len);
+            return;
+        }
+        return;
+    }
+
+    // register-for-notify and the CCCD write only queue their request; a
+    // stale handle fails here. Register events carry no connection: the
+    // handle picks the slots that have not been notified yet
+    const bool reg = event == ESP_GATTC_REG_FOR_NOTIFY_EVT;
+    if (!reg && event != ESP_GATTC_WRITE_DESCR_EVT)
+        return;
+    if ((reg ? param->reg_for_notify.status : param->write.status) == ESP_GATT_OK)
+        return;
+    for (size_t i = 0; i < mgr->handlerCount_; i++)
+    {
+        Slot &s = mgr->slots_[i];
+        uint16_t pending = s.regHandle.load(std::memory_order_relaxed);
+        if (!s.rawNotify || !s.client || !pending)
+            continue;
+        if (reg ? param->reg_for_notify.handle == pending : param->write.conn_id == s.client->getConnId())
+        {
+            s.stale = true;
+            mgr->signal(kEvtLink);
+        }
+    }
+}
+
+void BLEManagerBase::rescan()
+{
+    signal(kEvtRescan);
+}
+
+void BLEManagerBase::onScanComplete(BLEScanResults results)
+{
+    // BT task: window ended without a match
+    if (active_)
+        active_->signal(kEvtScanEnd);
+}
+
+void BLEManagerBase::signal(uint32_t events)
+{
+    events_.fetch_or(events, std::memory_order_release);
+    if (bleTaskHandle_)
+        xTaskNotifyGive(bleTaskHandle_);
+}
+
+void BLEManagerBase::wakeFromHandler(void *ctx)
+{
+    static_cast<BLEManagerBase *>(ctx)->signal(kEvtWake);
+}
+
+void BLEManagerBase::bleTask(void *param)
+{
+    BLELOG("BLE Thread Started\n");
+    BLEManagerBase *mgr = static_cast<BLEManagerBase *>(param);
+    uint32_t last = millis();
+    for (;;)
+    {
+        uint32_t wait = mgr->msUntilNext(millis());
+        if (wait)
+            ulTaskNotifyTake(pdTRUE, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+        mgr->wakeups_.fetch_add(1, std::memory_order_relaxed);
+        uint32_t now = millis();
+        mgr->update(now - last);
+        last = now;
+    }
 }
 
-void BLEManager::update(uint32_t tick)
+uint32_t BLEManagerBase::msUntilNext(uint32_t now) const
 {
-    if (connected_) {
-        // next-frame BLE writes
-        if (activeHandler_)
-            activeHandler_->update(tick); // allow device timers
-    } else {
-        // connect step
-        if (doConnect_)
+    if (events_.load(std::memory_order_acquire))
+        return 0;
+    uint32_t next = linksMsUntilNext(now);
+    if (!full())
+        next = min(next, scan_.msUntilNext(now));
+    return next;
+}
+
+void BLEManagerBase::serviceScan(uint32_t now, uint32_t events)
+{
+    if (events & kEvtRescan)
+        scan_.begin(now, true);
+    if (events & kEvtScanEnd)
+        scan_.onScanEnd(now);
+
+    BLEScan *scan = BLEDevice::getScan();
+    ScanScheduler::Params p;
+    switch (scan_.poll(now, p))
+    {
+    case ScanScheduler::Action::Start:
+        scan->stop();
+        scan->clearResults();
+        scan->setInterval(p.interval);
+        scan->setWindow(p.window);
+        // Non-blocking; the stack calls onScanComplete when the window ends
+        scan->start((p.durationMs + 999) / 1000, onScanComplete, false);
+        BLELOG("Scanning (%s, %u ms)...\n",
+               scan_.phase() == ScanPhase::Burst ? "burst" : "window", p.durationMs);
+        break;
+    case ScanScheduler::Action::Stop:
+        scan->stop();
+        break;
+    default:
+        break;
+    }
+
+    ScanPhase phase = scan_.phase();
+    if (phase != lastPhase_)
+    {
+        if (phase == ScanPhase::TimedOut)
+            BLELOG("Scan timed out, radio idle\n");
+        lastPhase_ = phase;
+    }
+    if (!connected())
+        ledState = scan_.active() ? SystemState::Scanning : SystemState::Idle;
+}
+
+void BLEManagerBase::update(uint32_t tick)
+{
+    uint32_t now = millis();
+    // events first: a link-down event implies the slot is already marked down
+    uint32_t events = events_.exchange(0, std::memory_order_acquire);
+
+    // links dropped since the last pass: handler teardown on this task,
+    // before the other links' frames and HID reports. A slot the connect
+    // task is still on waits for it; the slot turns idle only afterwards
+    for (size_t i = 0; i < handlerCount_; i++)
+    {
+        Slot &s = slots_[i];
+        if (s.lost && !s.busy)
         {
-            if (connectToServer())
-                BLELOG("Connected to server.\n");
-            else
-                BLELOG("Failed to connect.\n");
-            doConnect_ = false;
+            s.handler->onDisconnected();
+            s.lost = false;
         }
-        
-        // re-scan if not connected
-        if (doScan_)
+    }
+
+    // Every link gets its pass (frames, timers, next-frame BLE writes). The
+    // first slot rotates so no controller's frames, and the HID report
+    // flushed after them, always go ahead of the others'
+    serviceLinks(tick);
+
+    // connect step: cached peers and scan matches go to the connect task
+    uint32_t work = 0;
+    // cache-attached links that never got going (a failed raw request, or
+    // the handler gave up): the connect task forgets the entry, drops the link
+    for (size_t i = 0; i < handlerCount_; i++)
+    {
+        Slot &s = slots_[i];
+        if (!linkUp(i) || !s.rawNotify || !s.regHandle)
+            continue;
+        if (s.stale || s.handler->attachStalled())
         {
-            BLELOG("Scanning...\n");
-            active_->ledState = SystemState::Scanning;
-            // Non-blocking scan
-            BLEDevice::getScan()->start(0, false);
+            s.rawNotify = false;
+            s.stale = true;
+            work |= kEvtStale;
         }
     }
+    if ((events & kEvtDirect) && !full())
+        work |= kEvtDirect;
+    if (events & kEvtMatch)
+    {
+        scan_.onMatch(matchMs_);
+        BLELOG("Matched after %u ms (avg %u, max %u)\n", scan_.stats().lastLatencyMs,
+               scan_.stats().avgLatencyMs(), scan_.stats().maxLatencyMs);
+        work |= kEvtMatch;
+    }
+    if (work)
+    {
+        connectWork_.fetch_or(work, std::memory_order_release);
+        if (connectTaskHandle_)
+            xTaskNotifyGive(connectTaskHandle_);
+        else
+            connectPass();
+    }
+    // more to find after a match: the other slots' peers, or this one again
+    uint8_t done = 0;
+    if (connectDone_.load(std::memory_order_relaxed))
+        done = connectDone_.exchange(0, std::memory_order_acquire);
+    if ((done & kMatchTried) && !full())
+        scan_.begin(now, done & kMatchFailed);
+
+    // capture replay under way (suspend()): radio quiet until resume()
+    if (suspended_)
+    {
+        if (scan_.active())
+        {
+            scan_.cancel();
+            BLEDevice::getScan()->stop();
+        }
+        return;
+    }
+
+    // every slot taken: no scanning
+    if (full())
+    {
+        if (scan_.active())
+        {
+            scan_.cancel();
+            BLEDevice::getScan()->stop();
+        }
+        return;
+    }
+
+    // scan windows / backoff / timeout
+    serviceScan(now, events);
 }
@@ -3,57 +3,202 @@
 #define BLE_MANAGER_H
 
 #include <Arduino.h>
+#include <atomic>
+#include <tuple>
+#include <utility>
 #include "BLEDevice.h"
 #include "BLEDeviceHandler.h"
+#include "DeferredLog.h"
+#include "HidOutput.h"
 #include "Helper.h"
+#include "PeerCache.h"
+#include "ScanScheduler.h"
 
+// Deferred (DLOG): safe in the Bluedroid callbacks
 #ifndef BLE_DEBUG
 #define BLE_DEBUG 1
 #endif
 #if BLE_DEBUG
-  #define BLELOG(...)  do { Serial.printf(__VA_ARGS__); } while(0)
+  #define BLELOG(...)  DLOG(__VA_ARGS__)
 #else
-  #define BLELOG(...)  do {} while(0)
+  // dead call: arguments stay used and format-checked, nothing is emitted
+  #define BLELOG(...)  do { if (false) Serial.printf(__VA_ARGS__); } while(0)
 #endif
 
-class BLEManager
+// Link management for a fixed set of handlers, one connection slot each.
+// Handlers are registered at run time (registerHandler(), every call
+// virtual) or, with BLEManager<Handlers...> below, fixed at build time.
+class BLEManagerBase
 {
 public:
-    BLEManager();
+    BLEManagerBase();
+    virtual ~BLEManagerBase() {}
 
+    // Sets up BLE and starts the BLE task, which runs update() whenever a
+    // callback signals an event or a scan/handler timer is due, and the
+    // connect task, which brings links up (connect, discovery, peer cache)
+    // while the BLE task goes on serving the links already up
     void init();
+    // One service pass. Called by the BLE task; only call it yourself if the
+    // task could not be started (host harness). Without the connect task,
+    // connects run inline here
     void update(uint32_t tick);
+    // Milliseconds the task may sleep before update() has timed work
+    uint32_t msUntilNext(uint32_t now) const;
+    bool taskRunning() const { return bleTaskHandle_ != nullptr; }
+    uint32_t taskWakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+    // Any link up / how many / this handler's
+    bool connected() const { return links() > 0; }
+    size_t links() const { return links_.load(std::memory_order_relaxed); }
+    bool connected(size_t slot) const { return slot < handlerCount_ && slots_[slot].live; }
 
-    // Register up to N handlers; the first matching advertisement wins
+    // Register up to kMaxHandlers handlers, one connection slot each (register
+    // two instances for two controllers of a kind). An advertisement goes to
+    // the first idle slot whose handler matches; scanning goes on while a
+    // slot is idle and fewer than kMaxLinks links are up.
+    static constexpr size_t kMaxHandlers = 4;
+    static constexpr size_t kMaxLinks = 3; // controller's default connection limit
     void registerHandler(BLEDeviceHandler *handler);
     SystemState GetState() const { return ledState; }
-    void Timeout() { ledState = SystemState::Idle; }
+
+    // Scan scheduling: tune before init(); rescan() restarts after a timeout
+    ScanConfig &scanConfig() { return scan_.config; }
+    const ScanStats &scanStats() const { return scan_.stats(); }
+    void rescan();
+
+    // Radio quiet for a capture replay on another task: no scanning, no
+    // connects, and none under way when suspend() returns, so no handler
+    // or HidOut call comes from the BLE task meanwhile. False (and not
+    // suspended) if a link is up
+    bool suspend();
+    void resume();
+
+    // Bonded peers tried by direct connect before scanning
+    PeerCache &peers() { return peers_; }
+    // Power-on/disconnect -> link ready, and whether it came from the cache
+    uint32_t lastConnectMs() const { return lastConnectMs_.load(std::memory_order_relaxed); }
+    bool lastConnectDirect() const { return lastDirect_.load(std::memory_order_relaxed); }
+
+protected:
+    // Per-pass and per-event handler calls. The defaults go through the
+    // BLEDeviceHandler virtuals; BLEManager<Handlers...> overrides them with
+    // direct calls for its own slots.
+    // Run update() of every linked handler, first slot rotating
+    virtual void serviceLinks(uint32_t tick);
+    // Earliest msUntilNext() of the linked handlers
+    virtual uint32_t linksMsUntilNext(uint32_t now) const;
+    // Slot (in `idle`) to take this advertisement, or AdvIndex::kNoMatch
+    virtual uint8_t matchSlot(BLEAdvertisedDevice &adv, uint8_t idle);
+    // Notification of a cache-attached link (BT task)
+    virtual void rawNotify(size_t slot, uint16_t handle, uint8_t *data, size_t len);
+
+    // A handler the subclass matches itself: takes a slot, stays out of advIndex_
+    void adoptHandler(BLEDeviceHandler *handler);
+    bool linkUp(size_t slot) const { return slots_[slot].live.load(std::memory_order_relaxed); }
+    BLEDeviceHandler *slotHandler(size_t slot) const { return slots_[slot].handler; }
+    size_t slotCount() const { return handlerCount_; }
+    // Slot serviced first this pass; moves on by one per call
+    size_t nextFirst()
+    {
+        size_t f = first_;
+        first_ = handlerCount_ ? (first_ + 1) % handlerCount_ : 0;
+        return f;
+    }
+
 private:
-    // scan/connect state
-    bool doConnect_ = false;
-    bool connected_ = false;
-    bool doScan_ = false;
+    // Events for the BLE task. Set from BT callbacks and handlers, taken all
+    // at once by update(); data they refer to is written before signalling.
+    enum : uint32_t
+    {
+        kEvtMatch = 1u << 0,   // scan result matched: a slot's found/matched, matchMs_
+        kEvtScanEnd = 1u << 1, // scan window ended without a match
+        kEvtRescan = 1u << 2,  // open a burst scan session
+        kEvtDirect = 1u << 3,  // try the cached peers
+        kEvtLink = 1u << 4,    // connected / disconnected (a slot's lost)
+        kEvtWake = 1u << 5,    // handler has frames or commands
+        kEvtStale = 1u << 6,   // connect work only: a slot's cached handles went stale
+    };
+    std::atomic<uint32_t> events_{0};
+    volatile uint32_t matchMs_ = 0;
+    ScanScheduler scan_;
+    ScanPhase lastPhase_ = ScanPhase::Off;
 
-    BLEClient *client_ = nullptr;
-    BLERemoteCharacteristic *notify_ = nullptr;
-    BLERemoteCharacteristic *write_ = nullptr;
-    BLEAdvertisedDevice *foundDev_ = nullptr;
+    // fast reconnect
+    static constexpr uint32_t kDirectConnectMs = 1500; // per cached peer
+    PeerCache peers_;
+    volatile uint32_t linkLostMs_ = 0;
+    std::atomic<uint32_t> lastConnectMs_{0};
+    std::atomic<bool> lastDirect_{false};
 
-    // handlers
-    static constexpr size_t kMaxHandlers = 4;
-    BLEDeviceHandler *handlers_[kMaxHandlers] = {nullptr, nullptr, nullptr, nullptr};
+    class ClientCallback;
+
+    // Connection slots: slot i belongs to handler i and owns its client, so
+    // each link has its own GATT path, command queue and notify ring (the
+    // handler's). Flags are set from the BT callbacks and the connect task;
+    // the BLE task runs a slot's handler only while the slot is live.
+    struct Slot
+    {
+        BLEDeviceHandler *handler = nullptr;
+        BLEClient *client = nullptr;
+        BLEAdvertisedDevice *found = nullptr; // scan match, written by the scan callback
+        std::atomic<bool> matched{false};     // found waits for the connect step
+        std::atomic<bool> connected{false};   // GAP link up
+        std::atomic<bool> busy{false};        // the connect task is setting it up
+        std::atomic<bool> live{false};        // set up: the BLE task services it
+        std::atomic<bool> rawNotify{false};   // link attached from cached handles
+        std::atomic<bool> lost{false};        // link dropped, onDisconnected() not run yet
+        std::atomic<bool> stale{false};       // cache-attached link the stack failed (or stalled)
+        std::atomic<uint16_t> regHandle{0};   // cached notify handle, until its first notification
+    };
+    static_assert(kMaxHandlers <= AdvIndex::kSlots, "handler index must fit the advertisement index");
+    static_assert(kMaxHandlers <= HidOutput::kSources, "slot must fit the HID source mask");
+    Slot slots_[kMaxHandlers];
     size_t handlerCount_ = 0;
-    BLEDeviceHandler *activeHandler_ = nullptr;
+    std::atomic<uint32_t> links_{0};
+    AdvIndex advIndex_; // slot = handler index
+    size_t first_ = 0;  // slot serviced first in the next pass (round robin)
 
     // callbacks classes
     class SecurityCallback;
     class ScanResult;
-    class ClientCallback;
 
-    static BLEManager *active_; // for trampoline
+    static BLEManagerBase *active_; // for trampoline
+
+    // Slots free to take a new peripheral (bit per slot; 0 at kMaxLinks)
+    uint8_t idleSlots() const;
+    bool full() const { return idleSlots() == 0; }
+    // A slot is linked to, or about to connect to, this address
+    bool claimed(BLEAddress addr) const;
+    bool connectToServer(size_t slot);
+    size_t connectCached(uint32_t now);
+    bool linkCached(const PeerEntry &e);
+    // Set-up slot goes into service (unless its link dropped meanwhile)
+    void goLive(size_t slot);
+    void serviceScan(uint32_t now, uint32_t events);
+    static void onScanComplete(BLEScanResults results);
+    static void onGattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param);
 
-    bool connectToServer();
-    void enableNotifications();
+    // Connect task: takes kEvtDirect/kEvtMatch work from update(), reports
+    // back in connectDone_ and wakes the BLE task
+    enum : uint8_t
+    {
+        kMatchTried = 1u << 0,  // a scan match was connected to
+        kMatchFailed = 1u << 1, // ... and at least one attempt failed
+    };
+    std::atomic<uint32_t> connectWork_{0};
+    std::atomic<uint8_t> connectDone_{0};
+    std::atomic<bool> connecting_{false}; // connectPass() running
+    std::atomic<bool> suspended_{false};  // work waits in connectWork_ for resume()
+    TaskHandle_t connectTaskHandle_ = nullptr;
+    void connectPass();
+    static void connectTask(void *param);
+
+    // BLE task: sleeps until signalled or the next timer
+    TaskHandle_t bleTaskHandle_ = nullptr;
+    std::atomic<uint32_t> wakeups_{0};
+    void signal(uint32_t events);
+    static void wakeFromHandler(void *ctx);
+    static void bleTask(void *param);
 
     // Thread to handle LED state
     TaskHandle_t ledTaskHandle = nullptr;
@@ -61,4 +206,146 @@ private:
     static void ledTask(void* param);
 };
 
+// Handler registry. BLEManager<> registers handlers at run time. With handler
+// types as arguments, BLEManager<GearVR, GearVR> owns one instance of each
+// in the first slots: their advertisement criteria (Handler::kAdvCriteria)
+// form a constant AdvIndex, and update(), msUntilNext(), onRawNotify() and
+// the unindexed matchesAdvertisement() are called directly (qualified, so
+// never through the vtable) from the scan and update paths. registerHandler()
+// still adds run-time handlers after them.
+template <typename... Handlers>
+class BLEManager : public BLEManagerBase
+{
+public:
+    static constexpr size_t kStatic = sizeof...(Handlers);
+    static_assert(kStatic <= kMaxHandlers, "more handlers than slots");
+
+    BLEManager()
+    {
+        adopt(std::index_sequence_for<Handlers...>());
+    }
+
+    template <size_t I>
+    auto &handler() { return std::get<I>(handlers_); }
+
+protected:
+    void serviceLinks(uint32_t tick) override
+    {
+        const size_t n = slotCount(), first = nextFirst();
+        for (size_t k = 0; k < n; k++)
+        {
+            size_t i = (first + k) % n;
+            if (!linkUp(i))
+                continue;
+            if (i < kStatic)
+                visit(i, [tick](auto h) { h.update(tick); });
+            else
+                slotHandler(i)->update(tick);
+        }
+    }
+
+    uint32_t linksMsUntilNext(uint32_t now) const override
+    {
+        uint32_t next = UINT32_MAX;
+        forEach([&](size_t i, const auto &h) {
+            if (linkUp(i))
+                next = min(next, h.msUntilNext(now));
+        });
+        if (slotCount() > kStatic)
+            next = min(next, BLEManagerBase::linksMsUntilNext(now));
+        return next;
+    }
+
+    uint8_t matchSlot(BLEAdvertisedDevice &adv, uint8_t idle) override
+    {
+        constexpr uint8_t mine = (uint8_t)((1u << kStatic) - 1);
+        uint8_t hits = kIndex.matchMask(adv.getPayload(), adv.getPayloadLength()) & idle & mine;
+        size_t slot = hits ? (size_t)__builtin_ctz(hits) : kStatic;
+        // unindexed handlers ahead of the first hit keep their own check
+        for (size_t i = 0; i < slot; i++)
+        {
+            if (!(idle & (1u << i)) || (kIndex.indexed() & (1u << i)))
+                continue;
+            bool match = false;
+            visit(i, [&](auto h) { match = h.matchesAdvertisement(adv); });
+            if (match)
+                return (uint8_t)i;
+        }
+        if (slot < kStatic)
+            return (uint8_t)slot;
+        return BLEManagerBase::matchSlot(adv, idle & (uint8_t)~mine);
+    }
+
+    void rawNotify(size_t slot, uint16_t handle, uint8_t *data, size_t len) override
+    {
+        if (slot < kStatic)
+            visit(slot, [&](auto h) { h.onRawNotify(handle, data, len); });
+        else
+            BLEManagerBase::rawNotify(slot, handle, data, len);
+    }
+
+private:
+    std::tuple<Handlers...> handlers_;
+
+    static constexpr AdvIndex buildIndex()
+    {
+        AdvIndex index;
+        uint8_t slot = 0;
+        (index.add(slot++, Handlers::kAdvCriteria), ...);
+        return index;
+    }
+    static constexpr AdvIndex kIndex = buildIndex();
+
+    template <size_t... I>
+    void adopt(std::index_sequence<I...>)
+    {
+        (adoptHandler(&std::get<I>(handlers_)), ...);
+    }
+
+    // f(handler I) for I == i; the qualified call inside is direct
+    template <typename F, size_t... I>
+    void visit(size_t i, F &&f, std::index_sequence<I...>)
+    {
+        (void)((i == I ? (f(direct<I>()), true) : false) || ...);
+    }
+    template <typename F>
+    void visit(size_t i, F &&f)
+    {
+        visit(i, f, std::index_sequence_for<Handlers...>());
+    }
+    template <typename F, size_t... I>
+    void forEach(F &&f, std::index_sequence<I...>) const
+    {
+        (f(I, direct<I>()), ...);
+    }
+    template <typename F>
+    void forEach(F &&f) const
+    {
+        forEach(f, std::index_sequence_for<Handlers...>());
+    }
+
+    // Handler I through a wrapper whose calls name the final type
+    template <size_t I>
+    struct Direct
+    {
+        using H = typename std::tuple_element<I, std::tuple<Handlers...>>::type;
+        H &h;
+        void update(uint32_t tick) { h.H::update(tick); }
+        uint32_t msUntilNext(uint32_t now) const { return h.H::msUntilNext(now); }
+        bool matchesAdvertisement(BLEAdvertisedDevice &adv) { return h.H::matchesAdvertisement(adv); }
+        void onRawNotify(uint16_t handle, uint8_t *data, size_t len) { h.H::onRawNotify(handle, data, len); }
+    };
+    template <size_t I>
+    Direct<I> direct() const
+    {
+        return Direct<I>{const_cast<typename Direct<I>::H &>(std::get<I>(handlers_))};
+    }
+};
+
+// Run-time registration only
+template <>
+class BLEManager<> : public BLEManagerBase
+{
+};
+
 #endif // BLE_MANAGER_H
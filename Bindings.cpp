@@ -0,0 +1,238 @@
+#include "Bindings.h"
+#include <Preferences.h>
+#include "HidOutput.h"
+
+namespace
+{
+    const char *kNamespace = "bindings";
+    const char *kKey = "profile";
+    const uint8_t kMagic[3] = {'B', 'N', 'D'};
+
+    // One table from a list: every entry valid, at most one per input
+    bool build(const Binding *bindings, size_t n, Binding (&out)[InputBindings::kInputs])
+    {
+        Binding t[InputBindings::kInputs];
+        uint16_t seen = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const Binding &b = bindings[i];
+            if (b.input >= InputBindings::kInputs || b.action >= BindAction::kCount || b.mode >= BindMode::kCount)
+                return false;
+            if (seen & (1u << b.input))
+                return false;
+            seen |= (uint16_t)(1u << b.input);
+            t[b.input] = b;
+        }
+        for (size_t i = 0; i < InputBindings::kInputs; i++)
+            out[i] = t[i];
+        return true;
+    }
+}
+
+InputBindings::InputBindings()
+{
+    for (MacroId &id : chord_)
+        id = MacroSequencer::kNoMacro;
+}
+
+bool InputBindings::set(const Binding *bindings, size_t n)
+{
+    return build(bindings, n, table_);
+}
+
+size_t InputBindings::count() const
+{
+    size_t n = 0;
+    for (const Binding &b : table_)
+        n += b.action != BindAction::None;
+    return n;
+}
+
+bool InputBindings::parse(const uint8_t *profile, size_t len, Binding (&out)[kInputs])
+{
+    if (len < kHeaderSize || memcmp(profile, kMagic, sizeof(kMagic)) != 0 || profile[3] != kVersion)
+        return false;
+    size_t n = profile[4];
+    if (n > kInputs || len != kHeaderSize + n * kEntrySize)
+        return false;
+    Binding list[kInputs];
+    const uint8_t *e = profile + kHeaderSize;
+    for (size_t i = 0; i < n; i++, e += kEntrySize)
+    {
+        list[i].input = e[0];
+        list[i].action = (BindAction)e[1];
+        list[i].mode = (BindMode)e[2];
+        list[i].modifiers = e[3];
+        list[i].code = (uint16_t)(e[4] | e[5] << 8);
+    }
+    return build(list, n, out);
+}
+
+bool InputBindings::load(const uint8_t *profile, size_t len)
+{
+    // staged_ is the loader's until pending_ hands it to process()
+    if (pending_.load(std::memory_order_acquire))
+        return false;
+    if (!parse(profile, len, staged_))
+        return false;
+    pending_.store(true, std::memory_order_release);
+    return true;
+}
+
+size_t InputBindings::save(uint8_t *out, size_t cap) const
+{
+    size_t n = count();
+    size_t len = kHeaderSize + n * kEntrySize;
+    if (cap < len)
+        return 0;
+    memcpy(out, kMagic, sizeof(kMagic));
+    out[3] = kVersion;
+    out[4] = (uint8_t)n;
+    uint8_t *e = out + kHeaderSize;
+    for (const Binding &b : table_)
+    {
+        if (b.action == BindAction::None)
+            continue;
+        e[0] = b.input;
+        e[1] = (uint8_t)b.action;
+        e[2] = (uint8_t)b.mode;
+        e[3] = b.modifiers;
+        e[4] = (uint8_t)(b.code & 0xFF);
+        e[5] = (uint8_t)(b.code >> 8);
+        e += kEntrySize;
+    }
+    return len;
+}
+
+bool InputBindings::loadStored()
+{
+    uint8_t buf[kMaxProfile];
+    Preferences prefs;
+    prefs.begin(kNamespace, true);
+    size_t len = prefs.getBytes(kKey, buf, sizeof(buf));
+    prefs.end();
+    return len && load(buf, len);
+}
+
+bool InputBindings::store() const
+{
+    uint8_t buf[kMaxProfile];
+    size_t len = save(buf, sizeof(buf));
+    if (!len)
+        return false;
+    Preferences prefs;
+    prefs.begin(kNamespace, false);
+    bool ok = prefs.putBytes(kKey, buf, len) == len;
+    prefs.end();
+    return ok;
+}
+
+void InputBindings::fire(const Binding &b, bool down)
+{
+    switch (b.action)
+    {
+    case BindAction::Mouse:
+        if (down)
+            HidOut.press((uint8_t)b.code, source_);
+        else
+            HidOut.release((uint8_t)b.code, source_);
+        break;
+    case BindAction::Key:
+        if (down && b.modifiers)
+            chord(b, false);
+        else if (down)
+            HidOut.keyPress((uint8_t)b.code, source_);
+        else
+        {
+            // the key may still be waiting on its modifiers
+            HidOut.stop(chord_[b.input]);
+            chord_[b.input] = MacroSequencer::kNoMacro;
+            HidOut.keyRelease((uint8_t)b.code, source_);
+            for (uint8_t m = 0; m < 8; m++)
+                if (b.modifiers & (1u << m))
+                    HidOut.keyRelease((uint8_t)(0xE0 + m), source_);
+        }
+        break;
+    case BindAction::Consumer:
+        if (down)
+            HidOut.consumerPress(b.code, source_);
+        else
+            HidOut.consumerRelease(source_);
+        break;
+    case BindAction::Local:
+        if (local_)
+            local_(localCtx_, b.code, down);
+        break;
+    default:
+        break;
+    }
+}
+
+void InputBindings::chord(const Binding &b, bool tap)
+{
+    MacroStep steps[2 * 8 + 3];
+    size_t n = 0;
+    for (uint8_t m = 0; m < 8; m++)
+        if (b.modifiers & (1u << m))
+            steps[n++] = {MacroOp::KeyPress, (uint16_t)(0xE0 + m)};
+    steps[n++] = {MacroOp::Wait, kModifierLeadMs};
+    steps[n++] = {MacroOp::KeyPress, b.code};
+    if (tap)
+    {
+        steps[n++] = {MacroOp::KeyRelease, b.code};
+        for (uint8_t m = 0; m < 8; m++)
+            if (b.modifiers & (1u << m))
+                steps[n++] = {MacroOp::KeyRelease, (uint16_t)(0xE0 + m)};
+    }
+    chord_[b.input] = HidOut.play(steps, n, source_);
+}
+
+void InputBindings::releaseHeld()
+{
+    for (uint16_t held = last_; held; held &= (uint16_t)(held - 1))
+    {
+        const Binding &b = table_[__builtin_ctz(held)];
+        if (b.mode == BindMode::Hold)
+            fire(b, false);
+    }
+    last_ = 0;
+}
+
+void InputBindings::process(uint16_t inputs)
+{
+    if (pending_.load(std::memory_order_acquire))
+    {
+        // held inputs come back as press edges of the new table
+        releaseHeld();
+        for (size_t i = 0; i < kInputs; i++)
+            table_[i] = staged_[i];
+        pending_.store(false, std::memory_order_release);
+    }
+
+    uint16_t changed = inputs ^ last_;
+    last_ = inputs;
+    for (; changed; changed &= (uint16_t)(changed - 1))
+    {
+        const uint8_t i = (uint8_t)__builtin_ctz(changed);
+        const Binding &b = table_[i];
+        if (b.action == BindAction::None)
+            continue;
+        const bool down = (inputs >> i) & 1;
+        if (b.mode == BindMode::Hold)
+            fire(b, down);
+        else if (down && b.action == BindAction::Key && b.modifiers)
+            chord(b, true); // the release has to wait for the key too
+        else if (down)
+        {
+            fire(b, true);
+            fire(b, false);
+        }
+    }
+}
+
+void InputBindings::reset()
+{
+    last_ = 0;
+    for (MacroId &id : chord_)
+        id = MacroSequencer::kNoMacro;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef BINDINGS_H
+#define BINDINGS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "MacroSequencer.h"
+
+// Table-driven input -> HID mapping. A handler reduces each packet to an
+// input bitmask (buttons, plus gestures it recognises) and calls process():
+// one XOR against the previous mask gives every edge, and only the set edge
+// bits are looked up, each in a table indexed by input bit. The cost per
+// packet depends on how many inputs changed, not on how many are bound.
+//
+// The table loads from a binary profile (see load()) at any time, from any
+// task: the new table is staged and takes over at the next process(), after
+// whatever the old one held has been released.
+//
+// A key with modifiers goes out as a macro on HidOut (modifiers, a short
+// wait, then the key), so process() never waits for the host to see the
+// modifiers first.
+enum class BindAction : uint8_t
+{
+    None,
+    Mouse,    // code: mouse button bits
+    Key,      // code: keyboard usage ID; `modifiers` held with it
+    Consumer, // code: consumer usage
+    Local,    // code: handler-defined command (e.g. pointer mode), see LocalHook
+    kCount
+};
+
+enum class BindMode : uint8_t
+{
+    Hold, // down while the input is held
+    Tap,  // pressed and released on the input's press edge
+    kCount
+};
+
+// Input bit of a one-bit input mask (JoyButton, JoyGesture), so tables
+// follow the masks if they are renumbered
+constexpr uint8_t inputBit(uint16_t mask)
+{
+    return (uint8_t)__builtin_ctz(mask);
+}
+
+struct Binding
+{
+    uint8_t input = 0;        // input bit, 0..InputBindings::kInputs-1
+    BindAction action = BindAction::None;
+    BindMode mode = BindMode::Hold;
+    uint8_t modifiers = 0;    // Key: bit i = modifier usage 0xE0 + i
+    uint16_t code = 0;
+};
+
+class InputBindings
+{
+public:
+    static constexpr uint8_t kInputs = 16;
+    static constexpr uint16_t kModifierLeadMs = 10; // modifiers down before the key
+
+    // Local actions are carried out by the handler: down on the press edge,
+    // !down on the release edge (Hold only)
+    typedef void (*LocalHook)(void *ctx, uint16_t code, bool down);
+    void setLocalHook(LocalHook hook, void *ctx)
+    {
+        local_ = hook;
+        localCtx_ = ctx;
+    }
+    // HID source the actions are sent from (the handler's link slot)
+    void setSource(uint8_t source) { source_ = source; }
+
+    // Replace the table with `n` bindings (at most one per input)
+    bool set(const Binding *bindings, size_t n);
+    const Binding &binding(uint8_t input) const { return table_[input]; }
+    size_t count() const;
+
+    // Binary profile: "BND" + version byte + count byte, then per binding
+    // input, action, mode, modifiers, code (u16 LE). load() validates the
+    // whole profile before staging it; false leaves the table unchanged.
+    static constexpr size_t kHeaderSize = 5;
+    static constexpr size_t kEntrySize = 6;
+    static constexpr size_t kMaxProfile = kHeaderSize + kInputs * kEntrySize;
+    bool load(const uint8_t *profile, size_t len);
+    // Profile of the current table into `out`; returns the bytes written
+    size_t save(uint8_t *out, size_t cap) const;
+    // The profile kept in NVS, if any
+    bool loadStored();
+    bool store() const;
+
+    InputBindings();
+
+    // Map this packet's inputs; edges against the previous call
+    void process(uint16_t inputs);
+    // Link lost / new link: nothing held, no previous inputs
+    void reset();
+    uint16_t held() const { return last_; }
+
+private:
+    static constexpr uint8_t kVersion = 1;
+
+    Binding table_[kInputs];
+    Binding staged_[kInputs];
+    std::atomic<bool> pending_{false}; // staged_ waits for process()
+    uint16_t last_ = 0;
+    uint8_t source_ = 0;
+    LocalHook local_ = nullptr;
+    void *localCtx_ = nullptr;
+    MacroId chord_[kInputs]; // modifier + key macro per input
+
+    static bool parse(const uint8_t *profile, size_t len, Binding (&out)[kInputs]);
+    void fire(const Binding &b, bool down);
+    void chord(const Binding &b, bool tap);
+    void releaseHeld();
+};
+
+#endif // BINDINGS_H
@@ -0,0 +1,131 @@
+#include "CmdQueue.h"
+
+bool CmdQueue::push(const uint8_t data[kCmdLen], CmdPriority prio, const CmdPolicy &policy, uint32_t now)
+{
+    Cmd *free = nullptr;
+    Cmd *victim = nullptr;
+    for (Cmd &c : slots_)
+    {
+        if (!c.used)
+        {
+            if (!free)
+                free = &c;
+            continue;
+        }
+        if (memcmp(c.data, data, kCmdLen) == 0)
+        {
+            // Same command already waiting: keep its place, take the stronger
+            // priority and the fresh policy (a retry backoff is cleared)
+            if (prio > c.prio)
+                c.prio = prio;
+            c.policy = policy;
+            c.attempts = 0;
+            c.notBefore = now;
+            c.queuedAt = now;
+            stats_.deduped++;
+            return true;
+        }
+        // newest entry of the lowest priority is the eviction candidate
+        if (!victim || c.prio < victim->prio || (c.prio == victim->prio && c.seq > victim->seq))
+            victim = &c;
+    }
+
+    if (!free)
+    {
+        if (!victim || victim->prio >= prio)
+        {
+            stats_.rejected++;
+            return false;
+        }
+        drop(victim);
+        stats_.evicted++;
+        free = victim;
+    }
+
+    memcpy(free->data, data, kCmdLen);
+    free->prio = prio;
+    free->policy = policy;
+    free->attempts = 0;
+    free->notBefore = now;
+    free->queuedAt = now;
+    free->seq = ++seq_;
+    free->used = true;
+    count_++;
+    stats_.queued++;
+    return true;
+}
+
+CmdQueue::Cmd *CmdQueue::next(uint32_t now)
+{
+    Cmd *best = nullptr;
+    for (Cmd &c : slots_)
+    {
+        if (!c.used)
+            continue;
+        if (c.policy.ttlMs && now - c.queuedAt >= c.policy.ttlMs)
+        {
+            drop(&c);
+            stats_.expired++;
+            continue;
+        }
+        if ((int32_t)(now - c.notBefore) < 0)
+            continue;
+        if (!best || c.prio > best->prio || (c.prio == best->prio && c.seq < best->seq))
+            best = &c;
+    }
+    return best;
+}
+
+void CmdQueue::sent(Cmd *c)
+{
+    drop(c);
+    stats_.sent++;
+}
+
+void CmdQueue::failed(Cmd *c, uint32_t now)
+{
+    if (++c->attempts >= c->policy.maxAttempts)
+    {
+        drop(c);
+        stats_.gaveUp++;
+        return;
+    }
+    c->notBefore = now + c->policy.retryMs;
+    stats_.retries++;
+}
+
+uint32_t CmdQueue::msUntilNext(uint32_t now) const
+{
+    uint32_t next = UINT32_MAX;
+    for (const Cmd &c : slots_)
+    {
+        if (!c.used)
+            continue;
+        int32_t wait = (int32_t)(c.notBefore - now);
+        if (wait <= 0)
+            return 0;
+        next = min(next, (uint32_t)wait);
+    }
+    return next;
+}
+
+bool CmdQueue::contains(uint8_t cmd) const
+{
+    for (const Cmd &c : slots_)
+        if (c.used && c.data[0] == cmd)
+            return true;
+    return false;
+}
+
+void CmdQueue::clear()
+{
+    for (Cmd &c : slots_)
+        c.used = false;
+    count_ = 0;
+}
+
+void CmdQueue::drop(Cmd *c)
+{
+    c->used = false;
+    count_--;
+}
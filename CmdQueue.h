@@ -0,0 +1,78 @@
+#pragma once
+#ifndef CMD_QUEUE_H
+#define CMD_QUEUE_H
+
+#include <Arduino.h>
+
+// Outgoing controller commands waiting for a GATT write. Fixed capacity,
+// highest priority first, FIFO within a priority. Queuing a command that is
+// already waiting does not add a second copy.
+enum class CmdPriority : uint8_t
+{
+    Background, // keepalive and other droppable traffic
+    Normal,
+    Urgent,     // handshake / mode changes
+};
+
+struct CmdPolicy
+{
+    bool response = false;    // write with response (one per pump, blocks for the ack)
+    uint8_t maxAttempts = 1;  // failed writes retried until this many tries
+    uint16_t retryMs = 0;     // wait between tries
+    uint16_t ttlMs = 0;       // give up if still unsent after this long (0 = never)
+};
+
+struct CmdQueueStats
+{
+    uint32_t queued = 0;
+    uint32_t deduped = 0;  // already waiting: merged
+    uint32_t evicted = 0;  // lower-priority entry dropped to make room
+    uint32_t rejected = 0; // full of equal/higher priority entries
+    uint32_t expired = 0;  // ttl ran out
+    uint32_t retries = 0;
+    uint32_t gaveUp = 0;   // maxAttempts exhausted
+    uint32_t sent = 0;
+};
+
+class CmdQueue
+{
+public:
+    static constexpr size_t kCapacity = 8;
+    static constexpr size_t kCmdLen = 2;
+
+    struct Cmd
+    {
+        uint8_t data[kCmdLen];
+        CmdPriority prio;
+        CmdPolicy policy;
+        uint8_t attempts;
+        uint32_t notBefore; // retry backoff
+        uint32_t queuedAt;
+        uint32_t seq;
+        bool used;
+    };
+
+    bool push(const uint8_t data[kCmdLen], CmdPriority prio, const CmdPolicy &policy, uint32_t now);
+    // Next command to write at `now` (expired ones are dropped on the way)
+    Cmd *next(uint32_t now);
+    // Outcome of writing the command returned by next()
+    void sent(Cmd *c);
+    void failed(Cmd *c, uint32_t now);
+
+    void clear();
+    // Milliseconds until next() has something (0 = now, UINT32_MAX = empty)
+    uint32_t msUntilNext(uint32_t now) const;
+    size_t size() const { return count_; }
+    bool contains(uint8_t cmd) const;
+    const CmdQueueStats &stats() const { return stats_; }
+
+private:
+    Cmd slots_[kCapacity] = {};
+    size_t count_ = 0;
+    uint32_t seq_ = 0;
+    CmdQueueStats stats_;
+
+    void drop(Cmd *c);
+};
+
+#endif // CMD_QUEUE_H
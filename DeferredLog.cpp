@@ -0,0 +1,266 @@
+#include "DeferredLog.h"
+
+DeferredLog DebugLog;
+
+namespace
+{
+    struct Arg
+    {
+        DeferredLog::ArgTag tag;
+        int64_t i;
+        uint64_t u;
+        double f;
+        const char *s;
+        uint8_t len;
+    };
+
+    // Next tagged argument from the payload; false when it ran out
+    bool nextArg(const uint8_t *data, size_t size, size_t &at, Arg &a)
+    {
+        if (at >= size)
+            return false;
+        a.tag = (DeferredLog::ArgTag)data[at++];
+        switch (a.tag)
+        {
+        case DeferredLog::kArgI32:
+        {
+            int32_t v;
+            memcpy(&v, data + at, 4);
+            at += 4;
+            a.i = v;
+            a.u = (uint32_t)v; // printf reads an int's bits for %u/%x
+            a.f = v;
+            return true;
+        }
+        case DeferredLog::kArgU32:
+        {
+            uint32_t v;
+            memcpy(&v, data + at, 4);
+            at += 4;
+            a.i = (int32_t)v;
+            a.u = v;
+            a.f = v;
+            return true;
+        }
+        case DeferredLog::kArgI64:
+            memcpy(&a.i, data + at, 8);
+            at += 8;
+            a.u = (uint64_t)a.i;
+            a.f = (double)a.i;
+            return true;
+        case DeferredLog::kArgU64:
+            memcpy(&a.u, data + at, 8);
+            at += 8;
+            a.i = (int64_t)a.u;
+            a.f = (double)a.u;
+            return true;
+        case DeferredLog::kArgF64:
+            memcpy(&a.f, data + at, 8);
+            at += 8;
+            a.i = (int64_t)a.f;
+            a.u = (uint64_t)a.i;
+            return true;
+        case DeferredLog::kArgStr:
+            a.len = data[at++];
+            a.s = (const char *)data + at;
+            at += a.len;
+            return true;
+        }
+        return false;
+    }
+
+    // Advances the line length by what snprintf wrote, clamped to the buffer
+    size_t advance(size_t cap, size_t n, int wrote)
+    {
+        if (wrote < 0)
+            return n;
+        n += (size_t)wrote;
+        return n < cap ? n : cap - 1;
+    }
+}
+
+size_t DeferredLog::render(const char *fmt, const uint8_t *data, size_t size, char *out, size_t cap)
+{
+    if (cap == 0)
+        return 0;
+    size_t n = 0, at = 0;
+    out[0] = 0;
+    for (const char *p = fmt; *p && n + 1 < cap;)
+    {
+        if (*p != '%')
+        {
+            out[n++] = *p++;
+            out[n] = 0;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out[n++] = '%';
+            out[n] = 0;
+            p += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conv: the length modifier is
+        // replaced by the one matching the stored width
+        char spec[24];
+        size_t k = 0;
+        spec[k++] = *p++;
+        while (*p && strchr("-+ #0", *p) && k < 6)
+            spec[k++] = *p++;
+        while (*p >= '0' && *p <= '9' && k < 10)
+            spec[k++] = *p++;
+        int prec = -1;
+        if (*p == '.')
+        {
+            prec = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++)
+                prec = prec * 10 + (*p - '0');
+        }
+        while (*p && strchr("hlLqjzt", *p))
+            p++;
+        char conv = *p;
+        if (!conv)
+            break;
+        p++;
+
+        Arg a{};
+        if (!nextArg(data, size, at, a) || (conv == 's') != (a.tag == kArgStr))
+        {
+            out[n++] = '?';
+            out[n] = 0;
+            continue;
+        }
+        if (conv == 's')
+        {
+            // stored bytes carry no terminator: the precision bounds them
+            if (prec < 0 || prec > a.len)
+                prec = a.len;
+            memcpy(spec + k, ".*s", 4);
+            n = advance(cap, n, snprintf(out + n, cap - n, spec, prec, a.s));
+            continue;
+        }
+        if (prec >= 0)
+            k += snprintf(spec + k, sizeof(spec) - k - 4, ".%d", prec);
+        const bool integer = strchr("diuxXo", conv) != nullptr;
+        if (integer)
+        {
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+        }
+        spec[k++] = conv;
+        spec[k] = 0;
+        char *dst = out + n;
+        size_t room = cap - n;
+        switch (conv)
+        {
+        case 'd':
+        case 'i':
+            n = advance(cap, n, snprintf(dst, room, spec, (long long)a.i));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            n = advance(cap, n, snprintf(dst, room, spec, (unsigned long long)a.u));
+            break;
+        case 'c':
+            n = advance(cap, n, snprintf(dst, room, spec, (int)a.i));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            n = advance(cap, n, snprintf(dst, room, spec, a.f));
+            break;
+        default:
+            out[n++] = '?';
+            out[n] = 0;
+            break;
+        }
+    }
+    return n;
+}
+
+DeferredLog::DeferredLog()
+{
+    for (uint32_t i = 0; i < kCapacity; i++)
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+}
+
+DeferredLog::Slot *DeferredLog::claim(uint32_t &pos)
+{
+    // Bounded multi-producer ring (Vyukov): a slot's sequence says whether
+    // this lap's producer may take it; the CAS on head_ hands it out once
+    pos = head_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &s = slots_[pos & (kCapacity - 1)];
+        int32_t dif = (int32_t)(s.seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0)
+        {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &s;
+        }
+        else if (dif < 0)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+            pos = head_.load(std::memory_order_relaxed);
+    }
+}
+
+size_t DeferredLog::drain(Print &out, size_t max)
+{
+    char line[kLineMax];
+    size_t done = 0;
+    while (done < max)
+    {
+        Slot &s = slots_[tail_ & (kCapacity - 1)];
+        if (s.seq.load(std::memory_order_acquire) != tail_ + 1)
+            break;
+        uint32_t drops = dropped_.load(std::memory_order_relaxed);
+        if (drops != reportedDrops_)
+        {
+            out.printf("[log] %u dropped\n", (unsigned)(drops - reportedDrops_));
+            reportedDrops_ = drops;
+        }
+        size_t n = render(s.fmt, s.data, s.size, line, sizeof(line));
+        s.seq.store(tail_ + kCapacity, std::memory_order_release);
+        tail_++;
+        out.write((const uint8_t *)line, n);
+        done++;
+    }
+    return done;
+}
+
+void DeferredLog::begin(Print &out)
+{
+    out_ = &out;
+    if (!task_)
+        xTaskCreatePinnedToCore(logTask, "LogTask", 3072, this, 1, &task_, 0);
+}
+
+void DeferredLog::flush()
+{
+    if (task_)
+        xTaskNotifyGive(task_);
+}
+
+void DeferredLog::logTask(void *arg)
+{
+    DeferredLog *self = static_cast<DeferredLog *>(arg);
+    for (;;)
+    {
+        while (self->drain(*self->out_))
+        {
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(kDrainMs));
+    }
+}
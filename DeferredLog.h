@@ -0,0 +1,177 @@
+#pragma once
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+// Deferred diagnostics: a call site stores the format pointer (its ID: the
+// literal lives in flash for the life of the program) and the raw argument
+// values into a lock-free ring; formatting and the Serial write happen later
+// in a low-priority task. A record costs a few hundred cycles at the call
+// site, never blocks on the UART/CDC, and never allocates. A full ring drops
+// the new record and the drop is reported with the next line printed.
+//
+// Arguments are kept with a one-byte type tag, so the formatter reproduces
+// printf for the usual conversions (d i u x X o c s f e g, flags, width,
+// precision). Strings are copied at the call site, so c_str() temporaries
+// are fine; long ones are truncated to the space left in the record.
+class DeferredLog
+{
+public:
+    static constexpr size_t kCapacity = 64; // records, power of two
+    static constexpr size_t kPayload = 48;  // argument bytes per record
+    static constexpr size_t kLineMax = 160; // formatted line, truncated beyond
+    static constexpr uint32_t kDrainMs = 20; // formatter task period
+
+    enum ArgTag : uint8_t
+    {
+        kArgI32,
+        kArgU32,
+        kArgI64,
+        kArgU64,
+        kArgF64,
+        kArgStr, // length byte + bytes, no terminator
+    };
+
+    DeferredLog();
+
+    // Producer side, any task or callback. Use DLOG() rather than calling
+    // this directly: the macro keeps printf format checking.
+    template <typename... Args>
+    bool record(const char *fmt, const Args &...args)
+    {
+        uint32_t pos;
+        Slot *s = claim(pos);
+        if (!s)
+            return false;
+        s->fmt = fmt;
+        Writer w{s->data, 0};
+        (w.put(args), ...);
+        s->size = w.n;
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Starts the formatter task writing to `out`. Without a task (host
+    // harness) call drain() yourself.
+    void begin(Print &out);
+    // Formats and writes up to `max` records; returns how many
+    size_t drain(Print &out, size_t max = kCapacity);
+    // Wakes the formatter task now instead of at its next period
+    void flush();
+
+    // Formats one record's payload the way printf would
+    static size_t render(const char *fmt, const uint8_t *data, size_t size, char *out, size_t cap);
+
+    uint32_t recorded() const { return head_.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint32_t pending() const { return head_.load(std::memory_order_acquire) - tail_; }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq; // == pos: free, pos + 1: filled
+        const char *fmt;
+        uint8_t size;
+        uint8_t data[kPayload];
+    };
+
+    struct Writer
+    {
+        uint8_t *p;
+        uint8_t n;
+
+        void raw(ArgTag tag, const void *v, size_t len)
+        {
+            if ((size_t)n + 1 + len > kPayload)
+            {
+                n = kPayload; // no room: later arguments print as '?'
+                return;
+            }
+            p[n++] = tag;
+            memcpy(p + n, v, len);
+            n += len;
+        }
+
+        void str(const char *s)
+        {
+            if ((size_t)n + 2 > kPayload)
+            {
+                n = kPayload;
+                return;
+            }
+            size_t len = s ? strlen(s) : 0;
+            size_t room = kPayload - n - 2;
+            if (len > room)
+                len = room;
+            p[n++] = kArgStr;
+            p[n++] = (uint8_t)len;
+            memcpy(p + n, s, len);
+            n += len;
+        }
+
+        void put(const char *s) { str(s); }
+        void put(char *s) { str(s); }
+
+        template <typename T>
+        void put(const T &v)
+        {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "DLOG: unsupported argument type");
+            if constexpr (std::is_floating_point<T>::value)
+            {
+                double d = v;
+                raw(kArgF64, &d, sizeof(d));
+            }
+            else if constexpr (sizeof(T) > 4)
+            {
+                if constexpr (std::is_signed<T>::value)
+                {
+                    int64_t x = v;
+                    raw(kArgI64, &x, sizeof(x));
+                }
+                else
+                {
+                    uint64_t x = v;
+                    raw(kArgU64, &x, sizeof(x));
+                }
+            }
+            else if constexpr (std::is_signed<T>::value)
+            {
+                int32_t x = (int32_t)v;
+                raw(kArgI32, &x, sizeof(x));
+            }
+            else
+            {
+                uint32_t x = (uint32_t)v;
+                raw(kArgU32, &x, sizeof(x));
+            }
+        }
+    };
+
+    Slot slots_[kCapacity];
+    std::atomic<uint32_t> head_{0}; // next position to claim (producers)
+    uint32_t tail_ = 0;             // next position to format (consumer)
+    std::atomic<uint32_t> dropped_{0};
+    uint32_t reportedDrops_ = 0;
+    TaskHandle_t task_ = nullptr;
+    Print *out_ = nullptr;
+
+    Slot *claim(uint32_t &pos);
+    static void logTask(void *arg);
+};
+
+extern DeferredLog DebugLog;
+
+// Deferred printf. The dead Serial.printf keeps -Wformat checking on the
+// call site; "" fmt insists on a literal (its address is the record's ID).
+#define DLOG(fmt, ...)                                        \
+    do                                                        \
+    {                                                         \
+        if (false)                                            \
+            Serial.printf(fmt, ##__VA_ARGS__);                \
+        DebugLog.record("" fmt, ##__VA_ARGS__);               \
+    } while (0)
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Fixed-size single-producer/single-consumer ring of raw notification frames.
+// The producer is the BLE notify callback (Bluedroid task), the consumer is the
+// BLE task. No locks, no allocation: a full ring drops the new frame and
+// counts it in overflows().
+template <size_t FrameSize, size_t Capacity>
+class FrameRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    struct Frame
+    {
+        uint32_t stampUs; // micros() at receipt
+        uint8_t len;
+        uint8_t data[FrameSize];
+    };
+
+    // Producer side
+    bool push(const uint8_t *data, size_t len, uint32_t stampUs)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t used = head - tail_.load(std::memory_order_acquire);
+        if (used >= Capacity)
+        {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (used + 1 > highWater_.load(std::memory_order_relaxed))
+            highWater_.store(used + 1, std::memory_order_relaxed);
+
+        Frame &f = slots_[head & (Capacity - 1)];
+        if (len > FrameSize)
+            len = FrameSize;
+        f.stampUs = stampUs;
+        f.len = (uint8_t)len;
+        memcpy(f.data, data, len);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: oldest frame or nullptr; call pop() when done with it
+    const Frame *peek() const
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots_[tail & (Capacity - 1)];
+    }
+
+    void pop() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Only while the producer is quiescent (e.g. before notifications are registered)
+    void reset()
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        overflows_.store(0, std::memory_order_relaxed);
+        highWater_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+    uint32_t pushed() const { return head_.load(std::memory_order_relaxed); }
+    uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+    uint32_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    Frame slots_[Capacity];
+    std::atomic<uint32_t> head_{0}; // written by producer
+    std::atomic<uint32_t> tail_{0}; // written by consumer
+    std::atomic<uint32_t> overflows_{0};
+    std::atomic<uint32_t> highWater_{0};
+};
+
+#endif // FRAME_RING_H
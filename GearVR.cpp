@@ -1,35 +1,40 @@
 #include "GearVR.h"
 #include "HID.h"
+#include "HidAbsPointer.h"
+#include "HidOutput.h"
+#include "LatencyTrace.h"
 #include "USBHIDMouse.h"
-#include "USBHIDKeyboard.h"
-#include "USBHIDConsumerControl.h"
-
-extern USBHIDMouse Mouse;
-extern USBHIDKeyboard Keyboard;
-extern USBHIDConsumerControl ConsumerControl;
+#include "esp_gattc_api.h"
 
 // UUIDs
-BLEUUID GearVR::sService = BLEUUID("4f63756c-7573-2054-6872-65656d6f7465");
-BLEUUID GearVR::sWrite = BLEUUID("c8c51726-81bc-483b-a052-f7a14ea3d282");
-BLEUUID GearVR::sNotify = BLEUUID("c8c51726-81bc-483b-a052-f7a14ea3d281");
-BLEUUID GearVR::sCCCD = BLEUUID("00002902-0000-1000-8000-00805f9b34fb");
-
-// Commands
-const uint8_t GearVR::kOff[2] = {0x00, 0x00};
-const uint8_t GearVR::kSensor[2] = {0x01, 0x00};
-const uint8_t GearVR::kFwUp[2] = {0x02, 0x00};
-const uint8_t GearVR::kCal[2] = {0x03, 0x00};
-const uint8_t GearVR::kKeep[2] = {0x04, 0x00};
-const uint8_t GearVR::kUnk[2] = {0x05, 0x00};
-const uint8_t GearVR::kLpmEn[2] = {0x06, 0x00};
-const uint8_t GearVR::kLpmDis[2] = {0x07, 0x00};
-const uint8_t GearVR::kVr[2] = {0x08, 0x00};
+BLEUUID GearVR::sService = BLEUUID(kServiceUuid);
+BLEUUID GearVR::sWrite = BLEUUID(kWriteUuid);
+BLEUUID GearVR::sNotify = BLEUUID(kNotifyUuid);
+BLEUUID GearVR::sCCCD = BLEUUID(kCccdUuid);
+
+// Trigger = left click, volume/home/back = media keys, and a pad click by
+// where the thumb is: sides skip, down play/pause, up Alt+Tab, centre
+// switches between touchpad and gyro pointer
+const Binding GearVR::kDefaultBindings[] = {
+    {inputBit(kBtnTrigger), BindAction::Mouse, BindMode::Hold, 0, MOUSE_LEFT},
+    {inputBit(kBtnHome), BindAction::Consumer, BindMode::Hold, 0, MEDIA_HOME},
+    {inputBit(kBtnBack), BindAction::Consumer, BindMode::Hold, 0, MEDIA_BACK},
+    {inputBit(kBtnVolumeUp), BindAction::Consumer, BindMode::Hold, 0, MEDIA_VOLUME_UP},
+    {inputBit(kBtnVolumeDown), BindAction::Consumer, BindMode::Hold, 0, MEDIA_VOLUME_DOWN},
+    {inputBit(kGestureCenter), BindAction::Local, BindMode::Tap, 0, kLocalTogglePointer},
+    {inputBit(kGestureLeft), BindAction::Consumer, BindMode::Hold, 0, MEDIA_BACKWARD},
+    {inputBit(kGestureRight), BindAction::Consumer, BindMode::Hold, 0, MEDIA_FORWARD},
+    {inputBit(kGestureUp), BindAction::Key, BindMode::Hold, 1u << (KEYUSAGE_LEFT_ALT - 0xE0), KEYUSAGE_TAB},
+    {inputBit(kGestureDown), BindAction::Consumer, BindMode::Hold, 0, MEDIA_PLAY_PAUSE},
+};
+const size_t GearVR::kDefaultBindingCount = sizeof(kDefaultBindings) / sizeof(kDefaultBindings[0]);
 
 GearVR::GearVR()
 {
     joy.Clear();
-    lastjoy.Clear();
     config = PointerConfig();
+    bindings.set(kDefaultBindings, kDefaultBindingCount);
+    bindings.setLocalHook(onLocalBinding, this);
 }
 
 bool GearVR::matchesAdvertisement(BLEAdvertisedDevice &dev)
@@ -38,7 +43,13 @@ bool GearVR::matchesAdvertisement(BLEAdvertisedDevice &dev)
     String name = dev.getName();
     if (name.length() == 0)
         return false;
-    return name.startsWith("Gear VR Controller");
+    return name.startsWith(kAdvName);
+}
+
+bool GearVR::advertisementCriteria(AdvCriteria &out) const
+{
+    out = kAdvCriteria;
+    return true;
 }
 
 BLEUUID GearVR::serviceUuid() const { return sService; }
@@ -72,35 +83,140 @@ bool GearVR::onConnected(BLEClient *client_)
         return false;
     }
     
+    GearVR::client_ = client_;
+    handles_ = PeerHandles();
     client_->setMTU(63);
     delay(50);
     GVLOG("GearVR connected (MTU now=%u)\n", client_->getMTU());
 
-    // Enable CCCD first
+    // Enable CCCD first (ring is idle until the callback is registered)
+    rx_.reset();
     notify_->registerForNotify(
         [this](BLERemoteCharacteristic* chr, uint8_t* data, size_t len, bool isNotify) {
             this->onNotify(chr, data, len, isNotify);
         });
     BLERemoteDescriptor *d = notify_->getDescriptor(notifyDescriptorUuid());
     if (d)
-    {
-        queueCmd(kSensor);
         GVLOG("CCCD written: notifications enabled\n");
-    }
 
-    // queue Sensor first, not VR
-    handshakeStage_ = 0; // new member to track progress
-    handshakeTimer_ = 0;
+    // re-seed attitude from the first packet's gravity/heading; the learned
+    // gyro bias survives reconnects, only its sample window restarts
+    ahrs.reset();
+    gyroBias.restart();
+    continuity_.clear();
+    predictor_.reset();
+
+    // Sensor first, not VR
+    if (d)
+        applyHandshake(hs_.begin(millis()));
     return true;
 }
 
+bool GearVR::exportHandles(PeerHandles &out) const
+{
+    if (!write_ || !notify_)
+        return false;
+    out.write = write_->getHandle();
+    out.notify = notify_->getHandle();
+    BLERemoteDescriptor *d = notify_->getDescriptor(sCCCD);
+    out.cccd = d ? d->getHandle() : 0;
+    return out.write && out.notify && out.cccd;
+}
+
+bool GearVR::attachCached(BLEClient *client_, const PeerHandles &handles)
+{
+    if (!handles.write || !handles.notify || !handles.cccd)
+        return false;
+
+    // Bonded peer, same GATT table: subscribe by handle and skip discovery
+    rx_.reset();
+    if (esp_ble_gattc_register_for_notify(client_->getGattcIf(), *client_->getPeerAddress().getNative(),
+                                          handles.notify) != ESP_OK)
+        return false;
+    GearVR::client_ = client_;
+    write_ = nullptr;
+    notify_ = nullptr;
+    handles_ = handles;
+    // MTU exchange runs in the background; the first frames fit either way
+    client_->setMTU(63);
+    if (!writeCccd(true))
+    {
+        handles_ = PeerHandles();
+        GearVR::client_ = nullptr;
+        return false;
+    }
+    GVLOG("GearVR attached from cache (no discovery)\n");
+    attachStreams_ = hs_.stats().streams;
+
+    ahrs.reset();
+    gyroBias.restart();
+    continuity_.clear();
+    predictor_.reset();
+    applyHandshake(hs_.begin(millis()));
+    return true;
+}
+
+bool GearVR::attachStalled() const
+{
+    // handshake parked without a single stream since the attach
+    return handles_.notify && hs_.state() == HsState::Parked && hs_.stats().streams == attachStreams_;
+}
+
+void GearVR::onRawNotify(uint16_t handle, uint8_t *data, size_t len)
+{
+    // BLE task, same contract as onNotify
+    if (handle != handles_.notify)
+        return;
+    rx_.push(data, len, micros());
+    wake();
+}
+
+bool GearVR::writeCmd(const uint8_t *data, size_t len, bool response)
+{
+    if (write_)
+        return write_->writeValue((uint8_t *)data, len, response);
+    if (!client_ || !handles_.write)
+        return false;
+    return esp_ble_gattc_write_char(client_->getGattcIf(), client_->getConnId(), handles_.write, (uint16_t)len,
+                                    (uint8_t *)data, response ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP,
+                                    ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
+bool GearVR::writeCccd(bool response)
+{
+    uint8_t enable[2] = {0x01, 0x00};
+    if (notify_)
+    {
+        BLERemoteDescriptor *d = notify_->getDescriptor(sCCCD);
+        if (!d)
+            d = notify_->getDescriptor(BLEUUID((uint16_t)0x2902));
+        return d && d->writeValue(enable, 2, response);
+    }
+    if (!client_ || !handles_.cccd)
+        return false;
+    return esp_ble_gattc_write_char_descr(client_->getGattcIf(), client_->getConnId(), handles_.cccd, 2, enable,
+                                          response ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP,
+                                          ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
 void GearVR::onNotify(BLERemoteCharacteristic *chr, uint8_t *pData, size_t length, bool isNotify)
 {
     if (!isNotify)
         return;
+    // Runs on the Bluedroid task: no parsing, logging or GATT calls here
+    feedNotify(pData, length);
+}
+
+void GearVR::feedNotify(const uint8_t *data, size_t len)
+{
+    rx_.push(data, len, micros());
+    wake();
+}
 
+void GearVR::processFrame(const uint8_t *pData, size_t length, uint32_t stampUs)
+{
     // Short “command request” frames
-    if (length < 60)
+    if (length < GearVRPacket::kLength)
     {
         if (length >= 2)
         {
@@ -132,8 +248,8 @@ void GearVR::onNotify(BLERemoteCharacteristic *chr, uint8_t *pData, size_t lengt
             }
             else if (c0 == kLpmEn[0])
             {
-                GVLOG("Req: LPM Enable → queue VR\n");
-                queueCmd(kVr);
+                GVLOG("Req: LPM Enable\n");
+                applyHandshake(hs_.onEvent(HsEvent::LpmRequest, millis()));
             }
             else if (c0 == kLpmDis[0])
             {
@@ -141,30 +257,8 @@ void GearVR::onNotify(BLERemoteCharacteristic *chr, uint8_t *pData, size_t lengt
             }
             else if (c0 == kVr[0])
             {
-                GVLOG("Req: VR Mode → queue Sensor\n");
-                queueCmd(kSensor);
-                // Re-enable CCCD after VR mode (device resets its internal stack)
-                if (notify_)
-                {
-                    BLERemoteDescriptor *d = notify_->getDescriptor(sCCCD);
-                    if (!d)
-                        d = notify_->getDescriptor(BLEUUID((uint16_t)0x2902));
-                    if (d)
-                    {
-                        uint8_t enable[2] = {0x01, 0x00};
-                        d->writeValue(enable, 2, /*response=*/true);
-                        GVLOG("Rewrote CCCD after VR mode\n");
-                    }
-                }
-                // Try MTU upgrade again
-                if (client_)
-                {
-                    client_->setMTU(63);
-                    GVLOG("MTU after VR request: %u\n", client_->getMTU());
-                }
-
-                // Defer Sensor request until next loop
-                queueCmd(kSensor);
+                GVLOG("Req: VR Mode\n");
+                applyHandshake(hs_.onEvent(HsEvent::VrRequest, millis()));
                 return;
             }
             if (length >= 4)
@@ -178,60 +272,107 @@ void GearVR::onNotify(BLERemoteCharacteristic *chr, uint8_t *pData, size_t lengt
     }
 
     // Full controller packet
+    LAT_SINCE(kLatQueue, stampUs);
     if (!receiving_)
     {
-        GVLOG("Receiving controller stream (len=%u)\n", (unsigned)length);
+        GVLOG("Receiving controller stream (len=%u) at %u ms\n", (unsigned)length, millis());
         receiving_ = true;
-        streaming_ = true;
-        keepaliveMs_ = 0;
     }
+    applyHandshake(hs_.onEvent(HsEvent::FullPacket, millis()));
 
-    lastjoy = joy;
+    joy.advance(); // previous sample stays in the other buffer
     parseFullPacket(pData, length);
-    emitUSB(joy, lastjoy); // USB actions can fire immediately
+    LAT_ARRIVAL(stampUs, joy.now().sensor_time[2]);
+    aim(stampUs);
+#if LATENCY_TRACE
+    HidOut.markOrigin(stampUs);
+#endif
+    LAT_STAMP(emitStart);
+    emitUSB(joy.now(), joy.prev()); // USB actions can fire immediately
+    LAT_SINCE(kLatEmit, emitStart);
 }
 
 void GearVR::onDisconnected()
 {
-    GVLOG("GearVR disconnected\n");
+    GVLOG("GearVR disconnected: %u packets, %u lost in %u gaps (max %u ms), %u duplicates, %u resyncs\n",
+          linkStats().packets, linkStats().lost, linkStats().gaps, linkStats().maxGapUs / 1000,
+          linkStats().duplicates, linkStats().resyncs);
     client_ = nullptr;
     write_ = nullptr;
     notify_ = nullptr;
-    pending_ = false;
-    pendingCmd_[0] = pendingCmd_[1] = 0x00;
+    handles_ = PeerHandles();
+    cmds_.clear();
+    hs_.end();
     receiving_ = false;
     mode_ = 0x00;
+    // nothing of ours stays held down with the controller gone; BLE task,
+    // like every other HidOut call (see BLEManagerBase::update)
+    HidOut.releaseAll(slot());
+    bindings.reset();
+    gesture_ = 0;
+    LAT_RELINK();
 }
 
 void GearVR::queueCmd(const uint8_t cmd[2])
 {
-    pendingCmd_[0] = cmd[0];
-    pendingCmd_[1] = cmd[1];
-    pending_ = true; // will send on next manager update()
+    // Per-command policy: only Sensor needs an acknowledged write; handshake
+    // commands jump the queue, keepalives are the first thing to go
+    CmdPriority prio = CmdPriority::Normal;
+    CmdPolicy policy = {false, 2, 100, 1000};
+    switch (cmd[0])
+    {
+    case kSensor[0]:
+        prio = CmdPriority::Urgent;
+        policy = {true, 3, 100, 2000};
+        break;
+    case kLpmEn[0]:
+    case kLpmDis[0]:
+    case kVr[0]:
+        prio = CmdPriority::Urgent;
+        policy = {false, 3, 100, 2000};
+        break;
+    case kKeep[0]:
+        prio = CmdPriority::Background;
+        policy = {false, 1, 0, 1000};
+        break;
+    default:
+        break;
+    }
+    if (!cmds_.push(cmd, prio, policy, millis()))
+        GVLOG("GearVR: command queue full, dropped 0x%02X\n", cmd[0]);
+    else
+        wake();
 }
 
-bool GearVR::hasPending() const { return pending_; }
-
-void GearVR::trySendPending(BLERemoteCharacteristic *writeChr)
+void GearVR::pumpCommands(uint32_t now)
 {
-    if (!pending_ || !writeChr)
-        return;
-
-    // NO-RESPONSE write (false)
-    bool resp = (pendingCmd_[0] == kSensor[0]);
-    writeChr->writeValue((uint8_t *)pendingCmd_, 2, resp);
-
-    GVLOG("GearVR: sent cmd 0x%02X 0x%02X%s\n",
-          pendingCmd_[0], pendingCmd_[1],
-          resp ? " (rsp)" : " (no-rsp)");
+    for (uint8_t n = 0; n < kPipelineDepth; n++)
+    {
+        CmdQueue::Cmd *c = cmds_.next(now);
+        if (!c)
+            return;
+        bool resp = c->policy.response;
+        if (!writeCmd(c->data, CmdQueue::kCmdLen, resp))
+        {
+            GVLOG("GearVR: write of cmd 0x%02X failed\n", c->data[0]);
+            cmds_.failed(c, now);
+            return;
+        }
 
-    mode_ = pendingCmd_[0];
-    pending_ = false;
-    pendingCmd_[0] = pendingCmd_[1] = 0;
+        GVLOG("GearVR: sent cmd 0x%02X 0x%02X%s\n", c->data[0], c->data[1],
+              resp ? " (rsp)" : " (no-rsp)");
+        if (capture_)
+            capture_->tx(c->data, CmdQueue::kCmdLen, micros());
+        mode_ = c->data[0];
+        cmds_.sent(c);
+        if (resp)
+            return;
+    }
 }
-void GearVR::parseFullPacket(uint8_t *p, size_t len)
+
+void GearVR::parseFullPacket(const uint8_t *p, size_t len)
 {
-    if (len < 60)
+    if (len < GearVRPacket::kLength)
         return;
     //  20:47:06.013 -> === GearVR Raw Packet (60 bytes) ===
     //  20:47:06.013 ->
@@ -248,244 +389,286 @@ void GearVR::parseFullPacket(uint8_t *p, size_t len)
     //  }
     //  Serial.println("\n===================================");
 
-    constexpr float ACC_LSB_TO_MS2 = 9.80665f / 2048.0f;
+    LAT_STAMP(parseStart);
+    JoySample &cur = joy.now();
+    const JoySample &last = joy.prev();
+    GearVRPacket::decode(p, cur);
+
+    joy.state.updateCounts++;
+    cur.lastUpdated = millis();
+
+    LAT_SINCE(kLatParse, parseStart);
+    LAT_STAMP(fusionStart);
+
+    // A repeated packet carries nothing new for the filter
+    FrameCheck order = continuity_.check(cur.sensor_time);
+    if (order.order == FrameOrder::Duplicate)
+        return;
+
+    // Learn gyro bias while the controller rests, then remove it
     for (int t = 0; t < 3; t++)
+        gyroBias.add(cur.gyro[t], cur.accel[t]);
+    const Axis3 &bias = gyroBias.bias();
+
+    Axis3 magno;
+    magno.x = cur.magno.x * kMagnoFactor;
+    magno.y = cur.magno.y * kMagnoFactor;
+    magno.z = cur.magno.z * kMagnoFactor;
+
+    Axis3 rate; // newest body rate, for the predictor
+    if (config.integration == ImuIntegration::PerSample)
+    {
+        // One filter step per IMU subsample, dt from the device's own clock
+        uint32_t prevTime = last.sensor_time[2];
+        if (order.order == FrameOrder::First || order.order == FrameOrder::Resync)
+            prevTime = 0; // nominal step
+        else if (order.order == FrameOrder::Gap && config.bridgeGaps)
+        {
+            bridgeGap(last, cur, bias, order);
+            prevTime = cur.sensor_time[0] - order.stepUs;
+        }
+        for (int t = 0; t < 3; t++)
+        {
+            Axis3 gyro, accel;
+            gyro.x = (cur.gyro[t].x - bias.x) * GYR_SCALE;
+            gyro.y = (cur.gyro[t].y - bias.y) * GYR_SCALE;
+            gyro.z = (cur.gyro[t].z - bias.z) * GYR_SCALE;
+            accel.x = cur.accel[t].x * ACC_SCALE;
+            accel.y = cur.accel[t].y * ACC_SCALE;
+            accel.z = cur.accel[t].z * ACC_SCALE;
+
+            ahrs.update(gyro, accel, magno, sampleDt(prevTime, cur.sensor_time[t]));
+            prevTime = cur.sensor_time[t];
+            rate = gyro;
+        }
+    }
+    else
     {
-        int base = t * 16;
-
-        joy.sensor_time[t] = ((uint32_t)p[base + 3] << 24) |
-                             ((uint32_t)p[base + 2] << 16) |
-                             ((uint32_t)p[base + 1] << 8) |
-                             ((uint32_t)p[base + 0]);
-
-        // Accel: bytes 4..9  (little-endian)
-        int16_t ax = (int16_t)(p[base + 4] | (p[base + 5] << 8));
-        int16_t ay = (int16_t)(p[base + 6] | (p[base + 7] << 8));
-        int16_t az = (int16_t)(p[base + 8] | (p[base + 9] << 8));
-
-        // Gyro: bytes 10..15 (little-endian)
-        int16_t gx = (int16_t)(p[base + 10] | (p[base + 11] << 8));
-        int16_t gy = (int16_t)(p[base + 12] | (p[base + 13] << 8));
-        int16_t gz = (int16_t)(p[base + 14] | (p[base + 15] << 8));
-
-        joy.accel[t].x = ax * ACC_SCALE;
-        joy.accel[t].y = ay * ACC_SCALE;
-        joy.accel[t].z = az * ACC_SCALE;
-
-        joy.gyro[t].x = gx * GYR_SCALE;
-        joy.gyro[t].y = gy * GYR_SCALE;
-        joy.gyro[t].z = gz * GYR_SCALE;
+        // Weighted average of last 3 gyro frames for smoothness (raw LSB -> SI)
+        Axis3 gyro;
+        gyro.x = (cur.gyro[2].x * 0.6f + cur.gyro[1].x * 0.3f + cur.gyro[0].x * 0.1f - bias.x) * GYR_SCALE;
+        gyro.y = (cur.gyro[2].y * 0.6f + cur.gyro[1].y * 0.3f + cur.gyro[0].y * 0.1f - bias.y) * GYR_SCALE;
+        gyro.z = (cur.gyro[2].z * 0.6f + cur.gyro[1].z * 0.3f + cur.gyro[0].z * 0.1f - bias.z) * GYR_SCALE;
+
+        Axis3 accel;
+        accel.x = (cur.accel[2].x * 0.6f + cur.accel[1].x * 0.3f + cur.accel[0].x * 0.1f) * ACC_SCALE;
+        accel.y = (cur.accel[2].y * 0.6f + cur.accel[1].y * 0.3f + cur.accel[0].y * 0.1f) * ACC_SCALE;
+        accel.z = (cur.accel[2].z * 0.6f + cur.accel[1].z * 0.3f + cur.accel[0].z * 0.1f) * ACC_SCALE;
+
+        // Δt in seconds
+        float dt;
+        if (last.lastUpdated != 0 && cur.lastUpdated > last.lastUpdated)
+            dt = (cur.lastUpdated - last.lastUpdated) * 1e-3f;
+        else
+            dt = 1.0f / 120.0f; // fallback ≈120 Hz
+
+        ahrs.update(gyro, accel, magno, dt);
+        rate = gyro;
     }
 
-    joy.magno.x = (((int16_t)p[48] << 8) | p[49]);
-    joy.magno.y = (((int16_t)p[50] << 8) | p[51]);
-    joy.magno.z = (((int16_t)p[52] << 8) | p[53]);
-
-    joy.touchpad.x = (((p[54] & 0xF) << 6) | ((p[55] & 0xFC) >> 2)) & 0x3FF;
-    joy.touchpad.y = (((p[55] & 0x3) << 8) | ((p[56] & 0xFF) >> 0)) & 0x3FF;
-
-    joy.temperature = p[57];
-    joy.triggerButton = (p[58] & 0x01) != 0;
-    joy.homeButton = (p[58] & 0x02) != 0;
-    joy.backButton = (p[58] & 0x04) != 0;
-    joy.touchpad.button = (p[58] & 0x08) != 0;
-    joy.volumeUpButton = (p[58] & 0x10) != 0;
-    joy.volumeDownButton = (p[58] & 0x20) != 0;
-    joy.battery = p[59];
-
-    joy.updateCounts++;
-    joy.lastUpdated = millis();
-
-    // Weighted average of last 3 gyro frames for smoothness
-    Axis3 gyro = Axis3();
-    gyro.x = (joy.gyro[2].x * 0.6 + joy.gyro[1].x * 0.3 + joy.gyro[0].x * 0.1);
-    gyro.y = (joy.gyro[2].y * 0.6 + joy.gyro[1].y * 0.3 + joy.gyro[0].y * 0.1);
-    gyro.z = (joy.gyro[2].z * 0.6 + joy.gyro[1].z * 0.3 + joy.gyro[0].z * 0.1);
-
-    Axis3 accel = Axis3();
-    accel.x = (joy.accel[2].x * 0.6 + joy.accel[1].x * 0.3 + joy.accel[0].x * 0.1);
-    accel.y = (joy.accel[2].y * 0.6 + joy.accel[1].y * 0.3 + joy.accel[0].y * 0.1);
-    accel.z = (joy.accel[2].z * 0.6 + joy.accel[1].z * 0.3 + joy.accel[0].z * 0.1);
-    // Calculate Pointer on a Simulated Screen
-
-    // Δt in seconds
-    float dt;
-    if (joy.lastUpdated > lastjoy.lastUpdated)
-        dt = (joy.lastUpdated - lastjoy.lastUpdated) * 1e-3f; // assuming counter units ≈ µs
-    else
-        dt = 1.0f / 120.0f; // fallback ≈120 Hz
+    //  GVLOG("GearVR: magno.x=%d, magno.y=%d, magno.z=%d\n", cur.magno.x, cur.magno.y, cur.magno.z);
 
-    //  GVLOG("GearVR: gyro.x=%f, gyro.y=%f, gyro.z=%f\n", gyro.x, gyro.y, gyro.z);
-    //  GVLOG("GearVR: accel.x=%f, accel.y=%f, accel.z=%f\n", accel.x, accel.y, accel.z);
-    //  GVLOG("GearVR: magno.x=%f, magnoyro.y=%f, magno.z=%f\n", joy.magno.x, joy.magno.y, joy.magno.z);
+    // Euler view for the pointer mapping
+    ahrs.toEuler(joy.state.orient);
+    if (order.order == FrameOrder::Resync)
+        predictor_.reset();
+    predictor_.update(ahrs.quaternion(), rate, cur.sensor_time[2], config.prediction);
+    LAT_SINCE(kLatFusion, fusionStart);
+}
 
-    // Integrate gyro for fast changes
-    joy.orient.roll += gyro.x * dt;
-    joy.orient.pitch += gyro.y * dt;
-    joy.orient.yaw += gyro.z * dt;
+void GearVR::aim(uint32_t stampUs)
+{
+    // Touchpad mode leaves the attitude unused: skip the extrapolation
+    JoyState &st = joy.state;
+    st.aim = st.orient;
+    if (!config.prediction.enabled || st.usePad)
+        return;
+    float ms = predictor_.horizonMs(stampUs, micros(), joy.now().sensor_time[2], config.prediction);
+    Ahrs::toEuler(predictor_.predict(ms * 1e-3f, config.prediction), st.aim);
+}
 
-    // Compute accelerometer-based tilt (gravity)
-    float accRoll = atan2(accel.y, accel.z);
-    float accPitch = atan2(-accel.x, sqrt(accel.y * accel.y + accel.z * accel.z));
+void GearVR::bridgeGap(const JoySample &last, const JoySample &cur, const Axis3 &bias, const FrameCheck &gap)
+{
+    // The samples either side of the gap are known: interpolate the rate
+    // between them instead of holding either one across the whole gap
+    const RawAxis3 &a = last.gyro[2], &b = cur.gyro[0];
+    float dt = (gap.gapUs - gap.stepUs) * 1e-6f / gap.missing;
+    for (uint16_t i = 1; i <= gap.missing; i++)
+    {
+        float w = (float)i / (gap.missing + 1);
+        Axis3 gyro;
+        gyro.x = (a.x + (b.x - a.x) * w - bias.x) * GYR_SCALE;
+        gyro.y = (a.y + (b.y - a.y) * w - bias.y) * GYR_SCALE;
+        gyro.z = (a.z + (b.z - a.z) * w - bias.z) * GYR_SCALE;
+        ahrs.propagate(gyro, dt);
+    }
+}
 
-    // Complementary filter blend
-    const float alpha = 0.98f;
-    joy.orient.roll = alpha * joy.orient.roll + (1 - alpha) * accRoll;
-    joy.orient.pitch = alpha * joy.orient.pitch + (1 - alpha) * accPitch;
+float GearVR::sampleDt(uint32_t prevTime, uint32_t time)
+{
+    // sensor_time counts µs; unsigned subtraction handles wrap. First sample
+    // after connect or an implausible gap falls back to the nominal period.
+    uint32_t delta = time - prevTime;
+    if (prevTime == 0 || delta == 0 || delta > kMaxSampleGapUs)
+        delta = kNominalSampleUs;
+    return delta * 1e-6f;
+}
 
-    //  float heading = atan2(joy.magno.y, joy.magno.x);
-    //  joy.orient.yaw = alpha * joy.orient.yaw + (1 - alpha) * heading;
+float GearVR::packetDt(const JoySample &prev, const JoySample &now)
+{
+    // A packet carries three subsamples: its period is the sensor_time step
+    // between the last subsamples of consecutive packets
+    uint32_t delta = now.sensor_time[2] - prev.sensor_time[2];
+    if (prev.sensor_time[2] == 0 || delta == 0 || delta > kMaxSampleGapUs)
+        delta = 3 * kNominalSampleUs;
+    return delta * 1e-6f;
 }
 
-void GearVR::emitUSB(const JoyData &now, const JoyData &prev)
+float GearVR::wrapPi(float a)
 {
-    // ===== Mouse movement via touchpad =====
-    // Detect first touch contact to sync baseline
-    if (lastjoy.touchpad.x == 0 && lastjoy.touchpad.y == 0)
+    if (a > PI_F)
+        a -= 2.0f * PI_F;
+    else if (a < -PI_F)
+        a += 2.0f * PI_F;
+    return a;
+}
+
+uint16_t GearVR::touchGesture(const TouchAxis &pad)
+{
+    // Center reference is around 160,160 (10-bit, 0–315 range)
+    int dx = pad.x - 160;
+    int dy = pad.y - 160;
+    if (abs(dx) < 60 && abs(dy) < 60)
+        return kGestureCenter;
+    if (abs(dx) > abs(dy))
+        return dx > 0 ? kGestureRight : kGestureLeft;
+    return dy > 0 ? kGestureDown : kGestureUp;
+}
+
+void GearVR::onLocalBinding(void *ctx, uint16_t code, bool down)
+{
+    GearVR *self = static_cast<GearVR *>(ctx);
+    if (code == kLocalTogglePointer && down)
     {
-        lastjoy.touchpad.x = joy.touchpad.x;
-        lastjoy.touchpad.y = joy.touchpad.y;
+        JoyState &st = self->joy.state;
+        st.reference = st.orient;
+        st.usePad = !st.usePad;
+        self->pointer_.reset();
+        if (!st.usePad)
+            GVLOG("Using Gyro\n");
+        else
+            GVLOG("Using TouchPad\n");
     }
-    if (joy.touchpad.x > 0 && joy.touchpad.y > 0)
+}
+
+void GearVR::emitUSB(const JoySample &now, const JoySample &prev)
+{
+    JoyState &st = joy.state;
+
+    const float dt = packetDt(prev, now);
+    int mx = 0, my = 0;
+
+    // ===== Mouse movement via touchpad =====
+    // First contact only sets the baseline (previous sample had no touch)
+    bool prevTouch = prev.touchpad.x != 0 || prev.touchpad.y != 0;
+    bool touching = now.touchpad.x > 0 && now.touchpad.y > 0;
+    if (st.usePad && touching)
     {
-        int dx = joy.touchpad.x - lastjoy.touchpad.x;
-        int dy = joy.touchpad.y - lastjoy.touchpad.y;
-        if (abs(dx) > 1 || abs(dy) > 1)
-        {
-            if (joy.usePad)
-                Mouse.move(dx, dy, 0);
-        }
+        if (!prevTouch)
+            pointer_.reset();
+        if (pointer_.track(now.touchpad.x, now.touchpad.y, dt, config.touch, mx, my))
+            HidOut.move(mx, my, 0);
     }
-    if (!joy.usePad)
+    if (!st.usePad)
     {
         // Calculate mouse position on simulated screen
-        float dYaw = joy.orient.yaw - joy.reference.yaw;
-        float dPitch = joy.orient.pitch - joy.reference.pitch;
-        float screenX = tan(dYaw) * config.screenDistance;
-        float screenY = tan(dPitch) * config.screenDistance;
+        float dYaw = wrapPi(st.aim.yaw - st.reference.yaw);
+        float dPitch = wrapPi(st.aim.pitch - st.reference.pitch);
+        float screenX = tanf(dYaw) * config.screenDistance;
+        float screenY = tanf(dPitch) * config.screenDistance;
         // Normalize
         float normX = (screenX / (config.screenWidth / 2.0f));
         float normY = (screenY / (config.screenHeight / 2.0f));
         normX = constrain(normX, -1.0f, 1.0f);
         normY = constrain(normY, -1.0f, 1.0f);
-        // Calculate Mouse Movement
-        int mouseX = (int)(normX * 500); // adjust scaling for pixel speed
-        int mouseY = (int)(-normY * 500);
-        Mouse.move(mouseX, mouseY, 0);
-    }
-    // ===== Trigger = Mouse Left =====
-    if (joy.triggerButton && !lastjoy.triggerButton)
-    {
-        Mouse.press(MOUSE_LEFT);
-    }
-    if (!joy.triggerButton && lastjoy.triggerButton)
-    {
-        Mouse.release(MOUSE_LEFT);
-    }
-
-    // ===== Touch button alone = directional hotkeys =====
-    if (joy.touchpad.button && !joy.triggerButton && !lastjoy.touchpad.button)
-    {
-        // Center reference is around 160,160 (10-bit, 0–315 range)
-        int dx = joy.touchpad.x - 160;
-        int dy = joy.touchpad.y - 160;
-
-        if (abs(dx) < 60 && abs(dy) < 60)
+        if (config.gyroMode == GyroPointer::Absolute)
         {
-            // Center tap could be ignored or used for future
-            joy.reference = joy.orient;
-            joy.usePad = !joy.usePad;
-            if (!joy.usePad)
-                Serial.println("Using Gyro");
-            else
-                Serial.println("Using TouchPad");
-        }
-        else if (abs(dx) > abs(dy))
-        {
-            if (dx > 0)
-            {
-                GVLOG("Touch Right → Skip Forward\n");
-                ConsumerControl.press(MEDIA_FORWARD);
-            }
-            else
-            {
-                GVLOG("Touch Left → Skip Back\n");
-                ConsumerControl.press(MEDIA_BACKWARD);
-            }
+            // Place the cursor at the projected point: no integration, no drift
+            pointer_.smooth(normX, normY, dt, config.gyro.filter);
+            float absX = (normX + 1.0f) * 0.5f * HidAbsPointer::kMax;
+            float absY = (1.0f - normY) * 0.5f * HidAbsPointer::kMax;
+            HidOut.moveTo((uint16_t)lrintf(absX), (uint16_t)lrintf(absY));
         }
         else
         {
-            if (dy > 0)
-            {
-                GVLOG("Touch Down → Play/Pause\n");
-                ConsumerControl.press(MEDIA_PLAY_PAUSE);
-                ;
-            }
-            else
-            {
-                GVLOG("Touch Up → Alt+Tab\n");
-                Keyboard.press(KEYCODE_LEFT_ALT);
-                delay(10);
-                Keyboard.press(KEYCODE_TAB);
-            }
+            // Deflection sets the pointer speed; fractions carry to the next packet
+            pointer_.rate(normX, -normY, config.gyroCountsPerSec, dt, config.gyro, mx, my);
+            HidOut.move(mx, my, 0);
         }
     }
 
-    // Release any held directional or media key when touch released
-    if (!joy.touchpad.button && lastjoy.touchpad.button)
+    // ===== Buttons and pad-click gestures -> bindings =====
+    // A click with the trigger up is a gesture, by where the thumb is; it
+    // stays set until the click ends
+    if (!now.pressed(kBtnTouch))
+        gesture_ = 0;
+    else if (!prev.pressed(kBtnTouch) && !now.pressed(kBtnTrigger))
+        gesture_ = touchGesture(now.touchpad);
+    bindings.setSource(slot());
+    bindings.process(now.buttons | gesture_);
+}
+
+void GearVR::applyHandshake(uint8_t actions)
+{
+    if (actions & kHsRewriteCccd)
     {
-        ConsumerControl.release();
-        Keyboard.releaseAll();
+        // Re-enable CCCD after VR mode (device resets its internal stack)
+        if (writeCccd(/*response=*/true))
+            GVLOG("Rewrote CCCD after VR mode\n");
+        // Try MTU upgrade again
+        if (client_)
+        {
+            client_->setMTU(63);
+            GVLOG("MTU after VR request: %u\n", client_->getMTU());
+        }
+    }
+    if (actions & kHsSendVr)
+        queueCmd(kVr);
+    if (actions & kHsSendSensor)
+        queueCmd(kSensor);
+    if (actions & kHsKeepalive)
+    {
+        queueCmd(kKeep);
+        GVLOG("KA\n");
     }
-
-    // ===== Volume and Home/Back =====
-    if (joy.volumeUpButton && !lastjoy.volumeUpButton)
-        ConsumerControl.press(MEDIA_VOLUME_UP);
-    if (!joy.volumeUpButton && lastjoy.volumeUpButton)
-        ConsumerControl.release();
-
-    if (joy.volumeDownButton && !lastjoy.volumeDownButton)
-        ConsumerControl.press(MEDIA_VOLUME_DOWN);
-    if (!joy.volumeDownButton && lastjoy.volumeDownButton)
-        ConsumerControl.release();
-
-    if (joy.homeButton && !lastjoy.homeButton)
-        ConsumerControl.press(MEDIA_HOME);
-    if (!joy.homeButton && lastjoy.homeButton)
-        ConsumerControl.release();
-
-    if (joy.backButton && !lastjoy.backButton)
-        ConsumerControl.press(MEDIA_BACK);
-    if (!joy.backButton && lastjoy.backButton)
-        ConsumerControl.release();
 }
 
 void GearVR::update(uint32_t tick)
 {
-    // if (handshakeStage_ == 0)
-    // {
-    //     handshakeTimer_ += tick;
-    //     if (handshakeStage_ == 0 && handshakeTimer_ >= 300)
-    //     {
-    //         // after 150 ms of Sensor request
-    //         GVLOG("No stream → try VR mode\n");
-    //         queueCmd(kVr);
-    //         handshakeStage_ = 1;
-    //         handshakeTimer_ = 0;
-    //     }
-    // }
-    
-    //  // existing keepalive...
-    //  if (!streaming_) {
-    //    keepaliveMs_ += tick;
-    //    if (keepaliveMs_ >= 5000) {
-    //      keepaliveMs_ = 0;
-    //      queueCmd(kKeep);
-    //      GVLOG("KA\n");
-    //    }
-    //  }
-    if (hasPending())
+    // Drain the frames queued when the pass began; later ones wait for the
+    // next pass, so a flooding link cannot hold the task from the others
+    for (size_t n = rx_.size(); n > 0; n--)
     {
-        trySendPending(write_); // next-frame BLE write
+        const RxRing::Frame *f = rx_.peek();
+        if (capture_)
+            capture_->rx(f->data, f->len, f->stampUs);
+        processFrame(f->data, f->len, f->stampUs);
+        rx_.pop();
     }
+
+    uint32_t now = millis();
+    applyHandshake(hs_.poll(now)); // timeouts, retries, keepalive
+    pumpCommands(now);             // next-frame BLE writes
+    HidOut.flush(micros());        // at most one HID report per USB frame
+}
+
+uint32_t GearVR::msUntilNext(uint32_t now) const
+{
+    if (rx_.size())
+        return 0;
+    uint32_t next = min(hs_.msUntilNext(now), cmds_.msUntilNext(now));
+    uint32_t hidUs = HidOut.usUntilNext(micros());
+    if (hidUs != UINT32_MAX)
+        next = min(next, (hidUs + 999) / 1000);
+    return next;
 }
@@ -6,40 +6,104 @@
 #include "BLEDevice.h"
 #include "BLEDeviceHandler.h"
 #include "JoyData.h"
+#include "FrameRing.h"
+#include "Ahrs.h"
+#include "Bindings.h"
+#include "GyroBias.h"
+#include "CmdQueue.h"
+#include "Handshake.h"
+#include "Pointer.h"
+#include "SensorContinuity.h"
+#include "Predictor.h"
+#include "DeferredLog.h"
+#include "PacketCapture.h"
+#include "PacketLayout.h"
 
-// Debug gate
+// Debug gate: records go to the deferred log, formatted by its own task
 #ifndef GEARVR_DEBUG
 #define GEARVR_DEBUG 1
 #endif
 #if GEARVR_DEBUG
-  #define GVLOG(...)  do { Serial.printf(__VA_ARGS__); } while(0)
+  #define GVLOG(...)  DLOG(__VA_ARGS__)
 #else
-  #define GVLOG(...)  do {} while(0)
+  // dead call: arguments stay used and format-checked, nothing is emitted
+  #define GVLOG(...)  do { if (false) Serial.printf(__VA_ARGS__); } while(0)
 #endif
 
+// How parseFullPacket feeds the orientation filter
+enum class ImuIntegration : uint8_t
+{
+    Averaged,  // one step per packet on a 0.6/0.3/0.1 blend, dt from millis()
+    PerSample, // one step per IMU subsample, dt from sensor_time
+};
+
+// How the gyro pointer drives the cursor
+enum class GyroPointer : uint8_t
+{
+    Absolute, // HidAbsPointer: cursor at the projected point on the virtual screen
+    Rate,     // relative mouse: deflection sets the cursor speed
+};
+
 struct PointerConfig
 {
     float screenDistance = 0.5f; // meters
     float screenWidth = 0.6f;    // meters
     float screenHeight = 0.35f;  // meters
-    float smoothing = 0.15f;     // 0..1 for low-pass filter
+    // Touchpad: position in pad counts (0..315), 1:1 to mouse counts
+    PointerTuning touch = {{1.0f, 0.05f, 1.0f}, AccelCurve()};
+    // Gyro pointer: deflection on the virtual screen (-1..1) sets the speed
+    PointerTuning gyro = {{1.0f, 10.0f, 1.0f}, AccelCurve()};
+    GyroPointer gyroMode = GyroPointer::Absolute;
+    float gyroCountsPerSec = 35000.0f; // Rate: at full deflection (~500 per packet)
+    ImuIntegration integration = ImuIntegration::PerSample;
+    // PerSample: fill lost packets (up to SensorContinuity::kMaxBridgeUs) with
+    // gyro-only steps at rates interpolated across the gap; false takes the
+    // whole gap as one step at the new packet's rate
+    bool bridgeGaps = true;
+    // Gyro pointer: aim with the attitude extrapolated over the link latency
+    PredictionConfig prediction;
 };
 
 constexpr float ACC_LSB_PER_G = 2048.0f;
 constexpr float GYR_LSB_PER_DPS = 14.285f;
 constexpr float G_TO_MS2 = 9.80665f;
 constexpr float DEG2RAD = 0.017453292519943295f;
+constexpr float PI_F = 3.14159265358979f;
 constexpr float ACC_SCALE = G_TO_MS2 / ACC_LSB_PER_G;  // 0.004788 m/s² per LSB
 constexpr float GYR_SCALE = DEG2RAD / GYR_LSB_PER_DPS; // 0.00122 rad/s per LSB
+constexpr float MAG_SCALE = 0.06f;                     // µT per LSB
 
 class GearVR : public BLEDeviceHandler
 {
 public:
     GearVR();
     PointerConfig config;
+    Ahrs ahrs; // orientation estimator; filter/gains via ahrs.config
+    GyroBias gyroBias; // raw-LSB bias, kept across reconnects
+    // Buttons and touch-click gestures -> HID; kDefaultBindings until a
+    // profile is loaded
+    InputBindings bindings;
+    static const Binding kDefaultBindings[];
+    static const size_t kDefaultBindingCount;
+    // BindAction::Local codes
+    enum : uint16_t
+    {
+        kLocalTogglePointer = 1, // touchpad <-> gyro pointer, recentred
+    };
+
+    // Identity, known at build time: BLEManager<GearVR> indexes and matches
+    // on these without asking the instance
+    static constexpr char kAdvName[] = "Gear VR Controller";
+    static constexpr char kServiceUuid[] = "4f63756c-7573-2054-6872-65656d6f7465";
+    static constexpr char kWriteUuid[] = "c8c51726-81bc-483b-a052-f7a14ea3d282";
+    static constexpr char kNotifyUuid[] = "c8c51726-81bc-483b-a052-f7a14ea3d281";
+    static constexpr char kCccdUuid[] = "00002902-0000-1000-8000-00805f9b34fb";
+    // Name only: the controller does not list its service in the advertisement
+    static constexpr AdvCriteria kAdvCriteria = {kAdvName};
 
     // BLEDeviceHandler overrides
     bool matchesAdvertisement(BLEAdvertisedDevice &dev) override;
+    bool advertisementCriteria(AdvCriteria &out) const override;
     BLEUUID serviceUuid() const override;
     BLEUUID writeCharUuid() const override;
     BLEUUID notifyCharUuid() const override;
@@ -48,9 +112,36 @@ public:
     bool onConnected(BLEClient *client_) override;
     void onDisconnected() override;
     void update(uint32_t tick) override;
+    uint32_t msUntilNext(uint32_t now) const override;
+
+    bool exportHandles(PeerHandles &out) const override;
+    bool attachCached(BLEClient *client_, const PeerHandles &handles) override;
+    void onRawNotify(uint16_t handle, uint8_t *data, size_t len) override;
+    bool attachStalled() const override;
+
+    // Public state for main/UI if needed (current/previous sample double buffer)
+    JoyData joy;
 
-    // Public state for main/UI if needed
-    JoyData joy, lastjoy;
+    // Outgoing command queue counters
+    const CmdQueueStats &cmdStats() const { return cmds_.stats(); }
+    // Stream start-up state and time-to-first-full-packet metrics
+    const Handshake &handshake() const { return hs_; }
+    // Lost / repeated packets on the current (or last) connection, from sensor_time
+    const ContinuityStats &linkStats() const { return continuity_.stats(); }
+    // Latest fused attitude and body rate, extrapolated for the gyro pointer
+    const OrientationPredictor &predictor() const { return predictor_; }
+
+    // Notify -> main loop hand-off
+    static constexpr size_t kFrameSize = 60;
+    static constexpr size_t kRxFrames = 16;
+    typedef FrameRing<kFrameSize, kRxFrames> RxRing;
+    const RxRing &rx() const { return rx_; }
+
+    // Queue a frame exactly as the notify callback does (capture replay)
+    void feedNotify(const uint8_t *data, size_t len);
+    // Session capture of frames drained and commands written (not owned;
+    // records only while the capture is active)
+    void setCapture(PacketCapture *capture) { capture_ = capture; }
 
 private:
     // UUIDs
@@ -59,49 +150,144 @@ private:
     static BLEUUID sNotify;
     static BLEUUID sCCCD;
 
-    // Commands
-    static const uint8_t kOff[2];
-    static const uint8_t kSensor[2];
-    static const uint8_t kFwUp[2];
-    static const uint8_t kCal[2];
-    static const uint8_t kKeep[2];
-    static const uint8_t kUnk[2];
-    static const uint8_t kLpmEn[2];
-    static const uint8_t kLpmDis[2];
-    static const uint8_t kVr[2];
+    // Commands (constant expressions: queueCmd() switches on the opcodes)
+    static constexpr uint8_t kOff[2] = {0x00, 0x00};
+    static constexpr uint8_t kSensor[2] = {0x01, 0x00};
+    static constexpr uint8_t kFwUp[2] = {0x02, 0x00};
+    static constexpr uint8_t kCal[2] = {0x03, 0x00};
+    static constexpr uint8_t kKeep[2] = {0x04, 0x00};
+    static constexpr uint8_t kUnk[2] = {0x05, 0x00};
+    static constexpr uint8_t kLpmEn[2] = {0x06, 0x00};
+    static constexpr uint8_t kLpmDis[2] = {0x07, 0x00};
+    static constexpr uint8_t kVr[2] = {0x08, 0x00};
 
     // local connection context (not owned)
     BLEClient *client_ = nullptr;
     BLERemoteCharacteristic *write_ = nullptr;
     BLERemoteCharacteristic *notify_ = nullptr;
+    PeerHandles handles_; // raw GATT path when attached from the peer cache
+    uint32_t attachStreams_ = 0; // hs_ streams when attached from the cache
 
-    // send-next-frame queue (exactly one short command)
-    volatile bool pending_ = false;
-    uint8_t pendingCmd_[2] = {0x00, 0x00};
+    // outgoing commands, written from update()
+    static constexpr uint8_t kPipelineDepth = 4; // no-response writes per update()
+    CmdQueue cmds_;
     uint8_t mode_ = 0x00;
     bool receiving_ = false;
-    bool streaming_ = false;
-    uint32_t keepaliveMs_ = 0;
-    uint8_t handshakeStage_ = 0;
-    uint32_t handshakeTimer_ = 0;
+    Handshake hs_;
+
+    // raw frames queued by onNotify, drained by update()
+    RxRing rx_;
+
+    PacketCapture *capture_ = nullptr;
+
+    // sensor_time continuity: loss/duplicate detection, per connection
+    SensorContinuity continuity_;
+
+    // latency compensation for the gyro pointer (config.prediction)
+    OrientationPredictor predictor_;
+
+    // touch / gyro pointer shaping, reset on contact and mode changes
+    PointerPath pointer_;
+
+    // JoyGesture bit of the current pad click, 0 when not clicked
+    uint16_t gesture_ = 0;
+    static uint16_t touchGesture(const TouchAxis &pad);
+    static void onLocalBinding(void *ctx, uint16_t code, bool down);
 
     // device-specific constants (were in JoyData before)
     static constexpr int kMaxRadius = 315;
-    static constexpr double kRadius = kMaxRadius / 2.0;
-    static constexpr double kGyroFactor = 10000.0 * 0.017453292 / 14.285;
-    static constexpr double kAccelFactor = 10000.0 * 9.80665 / 2048.0;
-    static constexpr double kMagnoFactor = 0.06;
+    static constexpr float kRadius = kMaxRadius / 2.0f;
+    static constexpr float kGyroFactor = 10000.0f * 0.017453292f / 14.285f;
+    static constexpr float kAccelFactor = 10000.0f * 9.80665f / 2048.0f;
+    static constexpr float kMagnoFactor = MAG_SCALE;
+    static constexpr uint32_t kNominalSampleUs = 4750;  // observed subsample spacing
+    static constexpr uint32_t kMaxSampleGapUs = 100000; // larger deltas are not trusted
 
     void queueCmd(const uint8_t cmd[2]);
-    void parseFullPacket(uint8_t *p, size_t len);
+    // Carry out HsAction bits returned by hs_
+    void applyHandshake(uint8_t actions);
+    void parseFullPacket(const uint8_t *p, size_t len);
+    // Gyro-only steps over `gap.missing` lost subsamples
+    void bridgeGap(const JoySample &last, const JoySample &cur, const Axis3 &bias, const FrameCheck &gap);
+    // joy.state.aim for the packet received at stampUs
+    void aim(uint32_t stampUs);
+    static float sampleDt(uint32_t prevTime, uint32_t time);
+    static float packetDt(const JoySample &prev, const JoySample &now);
+    static float wrapPi(float a);
 
     // (Optional) emit USB HID actions immediately here if you want device-owned mapping
-    void emitUSB(const JoyData &now, const JoyData &prev);
+    void emitUSB(const JoySample &now, const JoySample &prev);
     
+    // BLE callback task: copy the frame into rx_ and return
     void onNotify(BLERemoteCharacteristic *chr, uint8_t *data, size_t len, bool isNotify);
-    bool hasPending() const;
-    void trySendPending(BLERemoteCharacteristic *writeChr);
+    // Main loop: handle one queued frame (command request or full packet)
+    void processFrame(const uint8_t *pData, size_t length, uint32_t stampUs);
+    // Write due commands: no-response writes back to back, at most one
+    // response write (it blocks for the ack) per call
+    void pumpCommands(uint32_t now);
+    // Characteristic writes through whichever path the link was set up with
+    bool writeCmd(const uint8_t *data, size_t len, bool response);
+    bool writeCccd(bool response);
+
+};
+
+// Wire layout of the 60-byte controller packet:
+//   0..47  three IMU subsamples of 16 bytes: sensor_time (LE u32), accel and
+//          gyro (LE s16 x, y, z)
+//  48..53  magnetometer (BE s16 x, y, z)
+//  54..56  touchpad x, y: two 10-bit values packed big-endian
+//  57      temperature, 58 buttons (JoyButton bits), 59 battery
+struct GearVRPacket
+{
+    static constexpr uint8_t kImuStride = 16;
+    static constexpr size_t kImuSamples = 3;
+    static constexpr size_t kLength = 60;
 
+    static constexpr PacketField kTime = le32(0).repeated(kImuStride);
+    static constexpr PacketField kAccelX = le16(4).asSigned().scaledBy(ACC_SCALE).repeated(kImuStride);
+    static constexpr PacketField kAccelY = le16(6).asSigned().scaledBy(ACC_SCALE).repeated(kImuStride);
+    static constexpr PacketField kAccelZ = le16(8).asSigned().scaledBy(ACC_SCALE).repeated(kImuStride);
+    static constexpr PacketField kGyroX = le16(10).asSigned().scaledBy(GYR_SCALE).repeated(kImuStride);
+    static constexpr PacketField kGyroY = le16(12).asSigned().scaledBy(GYR_SCALE).repeated(kImuStride);
+    static constexpr PacketField kGyroZ = le16(14).asSigned().scaledBy(GYR_SCALE).repeated(kImuStride);
+    static constexpr PacketField kMagnoX = be16(48).asSigned().scaledBy(MAG_SCALE);
+    static constexpr PacketField kMagnoY = be16(50).asSigned().scaledBy(MAG_SCALE);
+    static constexpr PacketField kMagnoZ = be16(52).asSigned().scaledBy(MAG_SCALE);
+    static constexpr PacketField kTouchX = be16(54).bitRange(2, 10);
+    static constexpr PacketField kTouchY = be16(55).bitRange(0, 10);
+    static constexpr PacketField kTemperature = u8(57);
+    static constexpr PacketField kButtons = u8(58).bitRange(0, 6);
+    static constexpr PacketField kBattery = u8(59);
+    static_assert(kGyroZ.end(kImuSamples) <= kMagnoX.offset, "IMU subsamples overlap the magnetometer");
+    static_assert(kBattery.end() == kLength, "layout must cover the packet");
+
+    // Raw device units into `out`; len >= kLength checked by the caller
+    static void decode(const uint8_t *p, JoySample &out)
+    {
+        decodeImu(p, out, std::make_index_sequence<kImuSamples>());
+        out.magno.x = (int16_t)readField<kMagnoX>(p);
+        out.magno.y = (int16_t)readField<kMagnoY>(p);
+        out.magno.z = (int16_t)readField<kMagnoZ>(p);
+        out.touchpad.x = (uint16_t)readField<kTouchX>(p);
+        out.touchpad.y = (uint16_t)readField<kTouchY>(p);
+        out.temperature = (uint8_t)readField<kTemperature>(p);
+        out.buttons = (uint8_t)readField<kButtons>(p);
+        out.battery = (uint8_t)readField<kBattery>(p);
+    }
+
+private:
+    template <size_t... T>
+    static void decodeImu(const uint8_t *p, JoySample &out, std::index_sequence<T...>)
+    {
+        ((out.sensor_time[T] = readField<kTime, T>(p),
+          out.accel[T].x = (int16_t)readField<kAccelX, T>(p),
+          out.accel[T].y = (int16_t)readField<kAccelY, T>(p),
+          out.accel[T].z = (int16_t)readField<kAccelZ, T>(p),
+          out.gyro[T].x = (int16_t)readField<kGyroX, T>(p),
+          out.gyro[T].y = (int16_t)readField<kGyroY, T>(p),
+          out.gyro[T].z = (int16_t)readField<kGyroZ, T>(p)),
+         ...);
+    }
 };
 
 #endif // GEARVR_H
@@ -0,0 +1,81 @@
+#include "GyroBias.h"
+
+namespace
+{
+    inline void slide(int16_t in, int16_t out, bool evict, int32_t &sum, int64_t &sq)
+    {
+        sum += in;
+        sq += (int32_t)in * in;
+        if (evict)
+        {
+            sum -= out;
+            sq -= (int32_t)out * out;
+        }
+    }
+
+    inline float variance(int64_t sq, float invN, float mean)
+    {
+        return (float)sq * invN - mean * mean;
+    }
+}
+
+bool GyroBias::add(const RawAxis3 &gyro, const RawAxis3 &accel)
+{
+    const bool evict = count_ == kWindow;
+    const RawAxis3 oldG = gyro_[head_];
+    const RawAxis3 oldA = accel_[head_];
+    gyro_[head_] = gyro;
+    accel_[head_] = accel;
+    head_ = (uint8_t)((head_ + 1) % kWindow);
+    if (!evict)
+        count_++;
+
+    slide(gyro.x, oldG.x, evict, gSum_[0], gSq_[0]);
+    slide(gyro.y, oldG.y, evict, gSum_[1], gSq_[1]);
+    slide(gyro.z, oldG.z, evict, gSum_[2], gSq_[2]);
+    slide(accel.x, oldA.x, evict, aSum_[0], aSq_[0]);
+    slide(accel.y, oldA.y, evict, aSum_[1], aSq_[1]);
+    slide(accel.z, oldA.z, evict, aSum_[2], aSq_[2]);
+
+    still_ = false;
+    if (count_ < kWindow)
+        return false;
+
+    const float invN = 1.0f / kWindow;
+    float mean[3];
+    for (int i = 0; i < 3; i++)
+    {
+        mean[i] = gSum_[i] * invN;
+        if (fabsf(mean[i]) > config.maxBias || variance(gSq_[i], invN, mean[i]) > config.gyroVar)
+            return false;
+        float aMean = aSum_[i] * invN;
+        if (variance(aSq_[i], invN, aMean) > config.accelVar)
+            return false;
+    }
+
+    still_ = true;
+    stillSamples_++;
+    bias_.x += config.rate * (mean[0] - bias_.x);
+    bias_.y += config.rate * (mean[1] - bias_.y);
+    bias_.z += config.rate * (mean[2] - bias_.z);
+    return true;
+}
+
+void GyroBias::restart()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        gSum_[i] = aSum_[i] = 0;
+        gSq_[i] = aSq_[i] = 0;
+    }
+    head_ = 0;
+    count_ = 0;
+    still_ = false;
+}
+
+void GyroBias::clear()
+{
+    restart();
+    stillSamples_ = 0;
+    bias_ = Axis3();
+}
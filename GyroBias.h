@@ -0,0 +1,55 @@
+#pragma once
+#ifndef GYRO_BIAS_H
+#define GYRO_BIAS_H
+
+#include <Arduino.h>
+#include "JoyData.h"
+
+// Online gyro bias estimator. Keeps running sums of the last kWindow raw
+// gyro/accel subsamples; while both variances stay under threshold (and the
+// gyro mean is small enough to be a bias, not a slow turn) the per-axis bias
+// follows the window mean. Constant memory, O(1) per subsample.
+struct GyroBiasConfig
+{
+    float gyroVar = 16.0f;   // LSB², max per-axis gyro variance when still
+    float accelVar = 400.0f; // LSB², max per-axis accel variance when still
+    float maxBias = 60.0f;   // LSB, means above this are motion, not bias
+    float rate = 1.0f / 64;  // EMA weight per still subsample
+};
+
+class GyroBias
+{
+public:
+    static constexpr uint8_t kWindow = 32; // ~150 ms at 210 Hz
+
+    GyroBiasConfig config;
+
+    // Feed one raw subsample; returns true if the window was judged still
+    bool add(const RawAxis3 &gyro, const RawAxis3 &accel);
+
+    // Drop the window (e.g. on reconnect) but keep the learned bias
+    void restart();
+    // Forget everything, including the bias
+    void clear();
+
+    // Bias in raw LSB; subtract before scaling
+    const Axis3 &bias() const { return bias_; }
+    void setBias(const Axis3 &b) { bias_ = b; }
+    bool still() const { return still_; }
+    uint32_t stillSamples() const { return stillSamples_; }
+
+private:
+    RawAxis3 gyro_[kWindow];
+    RawAxis3 accel_[kWindow];
+    int32_t gSum_[3] = {0, 0, 0};
+    int32_t aSum_[3] = {0, 0, 0};
+    int64_t gSq_[3] = {0, 0, 0};
+    int64_t aSq_[3] = {0, 0, 0};
+    uint8_t head_ = 0;
+    uint8_t count_ = 0;
+    bool still_ = false;
+    uint32_t stillSamples_ = 0;
+    Axis3 bias_;
+};
+
+#endif // GYRO_BIAS_H
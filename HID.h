@@ -11,6 +11,10 @@
 #define KEYCODE_LEFT_ALT    0x82
 #define KEYCODE_TAB         0x09
 
+// Keyboard page usage IDs (HidOutput::keyPress)
+#define KEYUSAGE_LEFT_ALT   0xE2
+#define KEYUSAGE_TAB        0x2B
+
 #define MEDIA_VOLUME_UP     0xe9
 #define MEDIA_VOLUME_DOWN   0xea
 #define MEDIA_MUTE          0xE2
@@ -0,0 +1,126 @@
+#include "Handshake.h"
+
+// Timeouts are a few controller frame times: the requests normally follow a
+// command within ~20 ms, a 300 ms silence means the write or reply got lost.
+const Handshake::StateDef Handshake::kStates[] = {
+    // timeout retries enter                          onTimeout             onLpm        onVr                  onPacket
+    {0, 0, kHsNone, HsState::Idle, HsState::Idle, HsState::Idle, HsState::Idle},                                    // Idle
+    {300, 2, kHsSendSensor, HsState::Vr, HsState::Vr, HsState::SensorAgain, HsState::Streaming},                    // Sensor
+    {300, 2, kHsSendVr, HsState::SensorAgain, HsState::Vr, HsState::SensorAgain, HsState::Streaming},               // Vr
+    {300, 2, kHsRewriteCccd | kHsSendSensor, HsState::Parked, HsState::Vr, HsState::SensorAgain, HsState::Streaming}, // SensorAgain
+    {1000, 0, kHsNone, HsState::Sensor, HsState::Vr, HsState::SensorAgain, HsState::Streaming},                     // Streaming
+    {10000, 0, kHsNone, HsState::Sensor, HsState::Vr, HsState::SensorAgain, HsState::Streaming},                    // Parked
+};
+
+uint8_t Handshake::begin(uint32_t now)
+{
+    keepaliveAt_ = now + config.keepaliveMs;
+    restart(now);
+    return enter(HsState::Sensor, now);
+}
+
+void Handshake::end()
+{
+    state_ = HsState::Idle;
+}
+
+void Handshake::restart(uint32_t now)
+{
+    started_ = now;
+    path_ = 0;
+    stats_.handshakes++;
+}
+
+uint8_t Handshake::enter(HsState s, uint32_t now)
+{
+    const StateDef &d = kStates[(uint8_t)s];
+    if (s == HsState::Streaming)
+    {
+        uint32_t ttff = now - started_;
+        stats_.lastTtffMs = ttff;
+        stats_.sumTtffMs += ttff;
+        if (stats_.streams == 0 || ttff < stats_.minTtffMs)
+            stats_.minTtffMs = ttff;
+        if (ttff > stats_.maxTtffMs)
+            stats_.maxTtffMs = ttff;
+        stats_.streams++;
+    }
+    else if (s == HsState::Parked)
+    {
+        stats_.parks++;
+    }
+    if (state_ == HsState::Streaming && s != HsState::Streaming)
+        keepaliveAt_ = now + config.keepaliveMs;
+
+    state_ = s;
+    path_ |= (uint8_t)(1u << (uint8_t)s);
+    retriesLeft_ = d.retries;
+    deadline_ = now + d.timeoutMs;
+    return d.enter;
+}
+
+uint8_t Handshake::onEvent(HsEvent ev, uint32_t now)
+{
+    if (state_ == HsState::Idle)
+        return kHsNone;
+    const StateDef &d = kStates[(uint8_t)state_];
+    HsState next = ev == HsEvent::LpmRequest ? d.onLpm : ev == HsEvent::VrRequest ? d.onVr : d.onPacket;
+    if (next == state_)
+    {
+        deadline_ = now + d.timeoutMs;
+        return kHsNone;
+    }
+    return enter(next, now);
+}
+
+uint8_t Handshake::poll(uint32_t now)
+{
+    if (state_ == HsState::Idle)
+        return kHsNone;
+
+    uint8_t actions = kHsNone;
+    // Keepalive scheduler: only while the controller is not streaming
+    if (state_ != HsState::Streaming && (int32_t)(now - keepaliveAt_) >= 0)
+    {
+        keepaliveAt_ = now + config.keepaliveMs;
+        stats_.keepalives++;
+        actions |= kHsKeepalive;
+    }
+
+    const StateDef &d = kStates[(uint8_t)state_];
+    if (!d.timeoutMs || (int32_t)(now - deadline_) < 0)
+        return actions;
+
+    if (retriesLeft_)
+    {
+        retriesLeft_--;
+        stats_.retries++;
+        deadline_ = now + d.timeoutMs;
+        return actions | d.enter;
+    }
+
+    stats_.timeouts++;
+    if (state_ == HsState::Streaming)
+        stats_.stalls++;
+    if (state_ == HsState::Streaming || state_ == HsState::Parked)
+        restart(now); // a new handshake attempt
+    return actions | enter(d.onTimeout, now);
+}
+
+uint32_t Handshake::msUntilNext(uint32_t now) const
+{
+    if (state_ == HsState::Idle)
+        return UINT32_MAX;
+    uint32_t next = UINT32_MAX;
+    if (state_ != HsState::Streaming)
+    {
+        int32_t ka = (int32_t)(keepaliveAt_ - now);
+        next = ka > 0 ? (uint32_t)ka : 0;
+    }
+    if (kStates[(uint8_t)state_].timeoutMs)
+    {
+        int32_t to = (int32_t)(deadline_ - now);
+        next = min(next, to > 0 ? (uint32_t)to : 0u);
+    }
+    return next;
+}
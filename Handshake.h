@@ -0,0 +1,110 @@
+#pragma once
+#ifndef HANDSHAKE_H
+#define HANDSHAKE_H
+
+#include <Arduino.h>
+
+// Gear VR stream start-up as a table-driven state machine. Pure logic like
+// ScanScheduler: time comes in as millis(), the handler performs the returned
+// actions (HsAction bits).
+//
+//   Sensor      -> Sensor command sent, waiting for the stream or an LPM request
+//   Vr          -> VR command sent, waiting for the VR-mode request
+//   SensorAgain -> CCCD rewritten + Sensor again after VR mode
+//   Streaming   -> full packets arriving; silence for too long restarts at Sensor
+//   Parked      -> all steps timed out: keepalives only, retry the handshake later
+enum class HsState : uint8_t
+{
+    Idle,
+    Sensor,
+    Vr,
+    SensorAgain,
+    Streaming,
+    Parked,
+};
+
+enum class HsEvent : uint8_t
+{
+    LpmRequest, // controller sent the LPM Enable request frame
+    VrRequest,  // controller sent the VR Mode request frame
+    FullPacket, // 60-byte sensor packet
+};
+
+enum HsAction : uint8_t
+{
+    kHsNone = 0,
+    kHsSendSensor = 0x01,
+    kHsSendVr = 0x02,
+    kHsRewriteCccd = 0x04,
+    kHsKeepalive = 0x08,
+};
+
+struct HandshakeConfig
+{
+    uint32_t keepaliveMs = 5000; // while connected but not streaming
+};
+
+struct HandshakeStats
+{
+    uint32_t handshakes = 0;    // begin() + stall restarts
+    uint32_t streams = 0;       // handshakes that reached Streaming
+    uint32_t lastTtffMs = 0;    // handshake start -> first full packet
+    uint32_t minTtffMs = 0;
+    uint32_t maxTtffMs = 0;
+    uint32_t sumTtffMs = 0;
+    uint32_t retries = 0;       // state re-entered after a timeout
+    uint32_t timeouts = 0;      // states left on timeout
+    uint32_t stalls = 0;        // stream went silent
+    uint32_t parks = 0;
+    uint32_t keepalives = 0;
+
+    uint32_t avgTtffMs() const { return streams ? sumTtffMs / streams : 0; }
+};
+
+class Handshake
+{
+public:
+    HandshakeConfig config;
+
+    // Link up: start at Sensor
+    uint8_t begin(uint32_t now);
+    // Link down
+    void end();
+    uint8_t onEvent(HsEvent ev, uint32_t now);
+    // Timeouts, retries and keepalives due at `now`
+    uint8_t poll(uint32_t now);
+    // Milliseconds until poll() may have something to do (UINT32_MAX = never)
+    uint32_t msUntilNext(uint32_t now) const;
+
+    HsState state() const { return state_; }
+    bool streaming() const { return state_ == HsState::Streaming; }
+    // Bit per state visited since the handshake started (1 << HsState)
+    uint8_t path() const { return path_; }
+    const HandshakeStats &stats() const { return stats_; }
+
+private:
+    struct StateDef
+    {
+        uint16_t timeoutMs;   // 0 = none
+        uint8_t retries;      // re-entries on timeout before moving on
+        uint8_t enter;        // HsAction bits on entry (and on each retry)
+        HsState onTimeout;
+        HsState onLpm;        // next state per event; same state = restart its timer
+        HsState onVr;
+        HsState onPacket;
+    };
+    static const StateDef kStates[];
+
+    HsState state_ = HsState::Idle;
+    uint8_t retriesLeft_ = 0;
+    uint8_t path_ = 0;
+    uint32_t deadline_ = 0;
+    uint32_t keepaliveAt_ = 0;
+    uint32_t started_ = 0;
+    HandshakeStats stats_;
+
+    uint8_t enter(HsState s, uint32_t now);
+    void restart(uint32_t now);
+};
+
+#endif // HANDSHAKE_H
@@ -0,0 +1,68 @@
+#include "HidAbsPointer.h"
+
+namespace
+{
+    const uint8_t kReportDescriptor[] = {
+        0x05, 0x01,                          // Usage Page (Generic Desktop)
+        0x09, 0x02,                          // Usage (Mouse)
+        0xA1, 0x01,                          // Collection (Application)
+        0x85, HidAbsPointer::kReportId,      //   Report ID
+        0x09, 0x01,                          //   Usage (Pointer)
+        0xA1, 0x00,                          //   Collection (Physical)
+        0x05, 0x09,                          //     Usage Page (Button)
+        0x19, 0x01,                          //     Usage Minimum (1)
+        0x29, 0x03,                          //     Usage Maximum (3)
+        0x15, 0x00,                          //     Logical Minimum (0)
+        0x25, 0x01,                          //     Logical Maximum (1)
+        0x95, 0x03,                          //     Report Count (3)
+        0x75, 0x01,                          //     Report Size (1)
+        0x81, 0x02,                          //     Input (Data, Var, Abs)
+        0x95, 0x01,                          //     Report Count (1)
+        0x75, 0x05,                          //     Report Size (5)
+        0x81, 0x03,                          //     Input (Const) padding
+        0x05, 0x01,                          //     Usage Page (Generic Desktop)
+        0x09, 0x30,                          //     Usage (X)
+        0x09, 0x31,                          //     Usage (Y)
+        0x16, 0x00, 0x00,                    //     Logical Minimum (0)
+        0x26, 0xFF, 0x7F,                    //     Logical Maximum (32767)
+        0x75, 0x10,                          //     Report Size (16)
+        0x95, 0x02,                          //     Report Count (2)
+        0x81, 0x02,                          //     Input (Data, Var, Abs)
+        0x09, 0x38,                          //     Usage (Wheel)
+        0x15, 0x81,                          //     Logical Minimum (-127)
+        0x25, 0x7F,                          //     Logical Maximum (127)
+        0x75, 0x08,                          //     Report Size (8)
+        0x95, 0x01,                          //     Report Count (1)
+        0x81, 0x06,                          //     Input (Data, Var, Rel)
+        0xC0,                                //   End Collection
+        0xC0,                                // End Collection
+    };
+}
+
+HidAbsPointer::HidAbsPointer()
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        initialized = true;
+        USBHID::addDevice(this, sizeof(kReportDescriptor));
+    }
+}
+
+uint16_t HidAbsPointer::_onGetDescriptor(uint8_t *buffer)
+{
+    memcpy(buffer, kReportDescriptor, sizeof(kReportDescriptor));
+    return sizeof(kReportDescriptor);
+}
+
+void HidAbsPointer::encode(Report &r, uint16_t x, uint16_t y, uint8_t buttons, int8_t wheel)
+{
+    x = min(x, kMax);
+    y = min(y, kMax);
+    r.buttons = buttons;
+    r.x[0] = (uint8_t)(x & 0xFF);
+    r.x[1] = (uint8_t)(x >> 8);
+    r.y[0] = (uint8_t)(y & 0xFF);
+    r.y[1] = (uint8_t)(y >> 8);
+    r.wheel = wheel;
+}
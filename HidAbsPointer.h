@@ -0,0 +1,35 @@
+#pragma once
+#ifndef HID_ABS_POINTER_H
+#define HID_ABS_POINTER_H
+
+#include <Arduino.h>
+#include <USBHID.h>
+
+// Absolute pointer on the composite HID interface: X/Y are screen positions
+// (0..kMax across the whole desktop), so the host places the cursor exactly
+// instead of integrating deltas. Only registers the report descriptor;
+// reports are sent by HidOutput with the other streams.
+class HidAbsPointer : public USBHIDDevice
+{
+public:
+    // After the ESP32 core's own report IDs (HID_REPORT_ID_VENDOR = 6)
+    static constexpr uint8_t kReportId = 7;
+    static constexpr uint16_t kMax = 32767;
+
+    // Wire layout of one report (after the report ID)
+    struct Report
+    {
+        uint8_t buttons;
+        uint8_t x[2]; // little-endian, 0..kMax
+        uint8_t y[2];
+        int8_t wheel;
+    };
+
+    HidAbsPointer();
+    void begin() {}
+    uint16_t _onGetDescriptor(uint8_t *buffer) override;
+
+    static void encode(Report &r, uint16_t x, uint16_t y, uint8_t buttons = 0, int8_t wheel = 0);
+};
+
+#endif // HID_ABS_POINTER_H
@@ -0,0 +1,369 @@
+#include "HidOutput.h"
+#include "HidAbsPointer.h"
+
+namespace
+{
+    inline int8_t clamp8(int32_t v)
+    {
+        return (int8_t)constrain(v, -127, 127);
+    }
+
+    inline int32_t addClamped(int32_t acc, int v)
+    {
+        return constrain(acc + v, -32767, 32767);
+    }
+
+    inline bool isModifier(uint8_t usage)
+    {
+        return usage >= 0xE0 && usage <= 0xE7;
+    }
+}
+
+template <typename T>
+void HidOutput::States<T>::pop()
+{
+    sent = q[0];
+    for (uint8_t i = 1; i < n; i++)
+        q[i - 1] = q[i];
+    n--;
+}
+
+bool HidOutput::same(const Keys &a, const Keys &b)
+{
+    return memcmp(&a, &b, sizeof(Keys)) == 0;
+}
+
+bool HidOutput::hasKey(const Keys &k, uint8_t usage)
+{
+    for (uint8_t slot : k.keys)
+        if (slot == usage)
+            return true;
+    return false;
+}
+
+template <typename T>
+void HidOutput::change(States<T> &s, const T &next, bool seals, HidStream stream)
+{
+    stats_.calls[stream]++;
+    if (same(next, s.latest()))
+    {
+        stats_.suppressed[stream]++;
+        return;
+    }
+    if (s.n == 0 || (seals && s.n < kDepth))
+    {
+        // a button edge rides along with motion already waiting
+        if (s.n == 0 && stream == kHidStreamMouse && streamPending(kHidStreamMouse))
+            stats_.suppressed[stream]++;
+        s.q[s.n++] = next;
+        return;
+    }
+    if (seals)
+        stats_.dropped++;
+    // merge into the report that is already waiting
+    s.q[s.n - 1] = next;
+    stats_.suppressed[stream]++;
+    if (same(s.q[s.n - 1], s.n >= 2 ? s.q[s.n - 2] : s.sent))
+        s.n--;
+}
+
+// A change seals the latest pending state when it would revert something
+// that state changed: both edges then need a report of their own.
+void HidOutput::setButtons(uint8_t next)
+{
+    const uint8_t changed = buttons_.latest() ^ buttons_.before();
+    change(buttons_, next, ((next ^ buttons_.latest()) & changed) != 0, kHidStreamMouse);
+}
+
+void HidOutput::setKeys(const Keys &next)
+{
+    const Keys &latest = keys_.latest();
+    const Keys &before = keys_.before();
+    bool seals = ((next.modifiers ^ latest.modifiers) & (latest.modifiers ^ before.modifiers)) != 0;
+    for (int i = 0; i < 6 && !seals; i++)
+    {
+        // keys the latest state pressed (released by `next`) or released (pressed again)
+        uint8_t a = latest.keys[i], b = before.keys[i];
+        if (a && !hasKey(before, a) && !hasKey(next, a))
+            seals = true;
+        if (b && !hasKey(latest, b) && hasKey(next, b))
+            seals = true;
+    }
+    change(keys_, next, seals, kHidStreamKeyboard);
+}
+
+void HidOutput::setUsage(uint16_t next)
+{
+    const bool seals = usage_.latest() != usage_.before() && next != usage_.latest();
+    change(usage_, next, seals, kHidStreamConsumer);
+}
+
+void HidOutput::move(int dx, int dy, int wheel)
+{
+    stats_.calls[kHidStreamMouse]++;
+    if (dx == 0 && dy == 0 && wheel == 0)
+    {
+        stats_.suppressed[kHidStreamMouse]++;
+        return;
+    }
+    if (streamPending(kHidStreamMouse))
+        stats_.suppressed[kHidStreamMouse]++;
+    dx_ = addClamped(dx_, dx);
+    dy_ = addClamped(dy_, dy);
+    wheel_ = addClamped(wheel_, wheel);
+}
+
+void HidOutput::setHeldButtons()
+{
+    uint8_t held = 0;
+    for (uint8_t b : buttonsBy_)
+        held |= b;
+    setButtons(held);
+}
+
+void HidOutput::press(uint8_t buttons, uint8_t source)
+{
+    buttonsBy_[source % kSources] |= buttons;
+    setHeldButtons();
+}
+
+void HidOutput::release(uint8_t buttons, uint8_t source)
+{
+    buttonsBy_[source % kSources] &= (uint8_t)~buttons;
+    setHeldButtons();
+}
+
+void HidOutput::keyPress(uint8_t usage, uint8_t source)
+{
+    Keys k = keys_.latest();
+    if (isModifier(usage))
+    {
+        k.modifiers |= (uint8_t)(1 << (usage - 0xE0));
+    }
+    else if (!hasKey(k, usage))
+    {
+        // six-key rollover: a seventh key is ignored
+        bool added = false;
+        for (uint8_t &slot : k.keys)
+            if (slot == 0)
+            {
+                slot = usage;
+                added = true;
+                break;
+            }
+        if (!added)
+            return;
+    }
+    keyHolders_[usage] |= (uint8_t)(1u << (source % kSources));
+    setKeys(k);
+}
+
+void HidOutput::keyRelease(uint8_t usage, uint8_t source)
+{
+    // still held by another source: stays down
+    keyHolders_[usage] &= (uint8_t)~(1u << (source % kSources));
+    if (keyHolders_[usage])
+        return;
+    Keys k = keys_.latest();
+    if (isModifier(usage))
+        k.modifiers &= (uint8_t)~(1 << (usage - 0xE0));
+    else
+        for (uint8_t &slot : k.keys)
+            if (slot == usage)
+                slot = 0;
+    setKeys(k);
+}
+
+void HidOutput::keyReleaseAll(uint8_t source)
+{
+    const uint8_t bit = (uint8_t)(1u << (source % kSources));
+    Keys k = keys_.latest();
+    for (uint8_t m = 0; m < 8; m++)
+    {
+        uint8_t &holders = keyHolders_[0xE0 + m];
+        holders &= (uint8_t)~bit;
+        if (!holders)
+            k.modifiers &= (uint8_t)~(1 << m);
+    }
+    for (uint8_t &slot : k.keys)
+    {
+        if (!slot)
+            continue;
+        keyHolders_[slot] &= (uint8_t)~bit;
+        if (!keyHolders_[slot])
+            slot = 0;
+    }
+    setKeys(k);
+}
+
+void HidOutput::consumerPress(uint16_t usage, uint8_t source)
+{
+    usageBy_ = source;
+    setUsage(usage);
+}
+
+void HidOutput::consumerRelease(uint8_t source)
+{
+    // another source pressed since: its usage stands
+    if (source != usageBy_)
+        return;
+    setUsage(0);
+}
+
+void HidOutput::moveTo(uint16_t x, uint16_t y)
+{
+    stats_.calls[kHidStreamAbsolute]++;
+    bool unchanged = absPending_ ? (x == absX_ && y == absY_) : (absValid_ && x == absSentX_ && y == absSentY_);
+    if (unchanged || absPending_)
+        stats_.suppressed[kHidStreamAbsolute]++;
+    if (unchanged)
+        return;
+    absX_ = x;
+    absY_ = y;
+    // moving back to the position on the wire cancels the pending report
+    absPending_ = !(absValid_ && x == absSentX_ && y == absSentY_);
+}
+
+void HidOutput::releaseAll()
+{
+    dx_ = dy_ = wheel_ = 0;
+    memset(buttonsBy_, 0, sizeof(buttonsBy_));
+    memset(keyHolders_, 0, sizeof(keyHolders_));
+    setButtons(0);
+    setKeys(Keys{});
+    setUsage(0);
+    macros_.clear();
+}
+
+void HidOutput::releaseAll(uint8_t source)
+{
+    macros_.cancelSource(source);
+    buttonsBy_[source % kSources] = 0;
+    setHeldButtons();
+    keyReleaseAll(source);
+    consumerRelease(source);
+}
+
+bool HidOutput::streamPending(uint8_t stream) const
+{
+    switch (stream)
+    {
+    case kHidStreamMouse:
+        return buttons_.n || dx_ || dy_ || wheel_;
+    case kHidStreamKeyboard:
+        return keys_.n != 0;
+    case kHidStreamConsumer:
+        return usage_.n != 0;
+    default:
+        return absPending_;
+    }
+}
+
+bool HidOutput::pending() const
+{
+    for (uint8_t s = 0; s < kHidStreams; s++)
+        if (streamPending(s))
+            return true;
+    return false;
+}
+
+bool HidOutput::send(uint8_t stream)
+{
+    if (stream == kHidStreamMouse)
+    {
+        int8_t x = clamp8(dx_), y = clamp8(dy_), w = clamp8(wheel_);
+        uint8_t r[5] = {buttons_.next(), (uint8_t)x, (uint8_t)y, (uint8_t)w, 0};
+        if (!hid_.SendReport(HID_REPORT_ID_MOUSE, r, sizeof(r), config.sendTimeoutMs))
+            return false;
+        dx_ -= x;
+        dy_ -= y;
+        wheel_ -= w;
+        if (buttons_.n)
+            buttons_.pop();
+        return true;
+    }
+    if (stream == kHidStreamKeyboard)
+    {
+        Keys k = keys_.next();
+        if (!hid_.SendReport(HID_REPORT_ID_KEYBOARD, &k, sizeof(k), config.sendTimeoutMs))
+            return false;
+        keys_.pop();
+        return true;
+    }
+    if (stream == kHidStreamAbsolute)
+    {
+        HidAbsPointer::Report r;
+        HidAbsPointer::encode(r, absX_, absY_);
+        if (!hid_.SendReport(HidAbsPointer::kReportId, &r, sizeof(r), config.sendTimeoutMs))
+            return false;
+        absSentX_ = absX_;
+        absSentY_ = absY_;
+        absValid_ = true;
+        absPending_ = false;
+        return true;
+    }
+    uint16_t usage = usage_.next();
+    if (!hid_.SendReport(HID_REPORT_ID_CONSUMER_CONTROL, &usage, sizeof(usage), config.sendTimeoutMs))
+        return false;
+    usage_.pop();
+    return true;
+}
+
+#if LATENCY_TRACE
+void HidOutput::markOrigin(uint32_t stampUs)
+{
+    // reports still waiting keep the older input's stamp
+    if (!originSet_ || !pending())
+        originUs_ = stampUs;
+    originSet_ = true;
+}
+#endif
+
+MacroId HidOutput::play(const MacroStep *steps, size_t n, uint8_t source)
+{
+    return macros_.start(steps, n, source, micros(), *this);
+}
+
+bool HidOutput::flush(uint32_t nowUs)
+{
+    macros_.poll(nowUs, *this);
+    const uint32_t frame = nowUs / config.frameUs;
+    if (frame == frame_)
+        return pending() || macros_.active();
+    for (uint8_t i = 0; i < kHidStreams; i++)
+    {
+        uint8_t stream = (uint8_t)((turn_ + i) % kHidStreams);
+        if (!streamPending(stream))
+            continue;
+        if (send(stream))
+        {
+#if LATENCY_TRACE
+            if (originSet_)
+                Latency.record(kLatUsb, micros() - originUs_);
+#endif
+            stats_.sent[stream]++;
+            frame_ = frame;
+            turn_ = (uint8_t)((stream + 1) % kHidStreams);
+        }
+        else
+        {
+            stats_.busy++;
+        }
+        break;
+    }
+#if LATENCY_TRACE
+    if (!pending())
+        originSet_ = false;
+#endif
+    return pending() || macros_.active();
+}
+
+uint32_t HidOutput::usUntilNext(uint32_t nowUs) const
+{
+    uint32_t us = macros_.usUntilNext(nowUs);
+    if (!pending())
+        return us;
+    if (nowUs / config.frameUs != frame_)
+        return 0;
+    return min(us, config.frameUs - nowUs % config.frameUs);
+}
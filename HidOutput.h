@@ -0,0 +1,175 @@
+#pragma once
+#ifndef HID_OUTPUT_H
+#define HID_OUTPUT_H
+
+#include <Arduino.h>
+#include <USBHID.h>
+#include "LatencyTrace.h"
+#include "MacroSequencer.h"
+
+// Coalescing USB HID output stage. Handlers describe what changed (motion,
+// button and key edges); flush() turns the accumulated state into at most
+// one report per USB frame. The ESP32 core puts mouse, keyboard, consumer
+// and the absolute pointer on one HID interface (report IDs), so the frame
+// budget is shared: pending streams take turns.
+//
+// Motion is summed and sent clamped to the report range, the remainder
+// carries into the next frame. Button/key/usage states queue up only when a
+// change would undo one not yet sent (press + release inside one frame), so
+// short taps are never lost; every other change merges into the pending
+// report. Reports identical to the last one sent are not sent at all.
+//
+// Several controllers can share the output: each press/release names its
+// source (connection slot), a button or key is down while any source holds
+// it, and a consumer usage is released only by the source that pressed it.
+//
+// Not locked: every call comes from the task that calls flush() (the BLE
+// task). Handlers reach it from update() and onDisconnected(), both run
+// there; the BT stack's callbacks never write to it.
+//
+// Multi-step actions with waits in between (modifier, then key) go through
+// play(): flush() runs their steps as they fall due, so nothing that feeds
+// the output ever has to sleep.
+enum HidStream : uint8_t
+{
+    kHidStreamMouse,
+    kHidStreamKeyboard,
+    kHidStreamConsumer,
+    kHidStreamAbsolute,
+    kHidStreams
+};
+
+struct HidOutputConfig
+{
+    uint32_t frameUs = 1000;     // full-speed USB frame (endpoint polled every frame)
+    uint32_t sendTimeoutMs = 2;  // SendReport wait for a busy endpoint
+};
+
+struct HidOutputStats
+{
+    uint32_t calls[kHidStreams] = {}; // move/press/release: one report each without coalescing
+    uint32_t sent[kHidStreams] = {};
+    uint32_t suppressed[kHidStreams] = {}; // merged into a pending report or no change
+    uint32_t busy = 0;    // SendReport failed; retried next frame
+    uint32_t dropped = 0; // state queue full: an intermediate state was merged away
+
+    uint32_t totalCalls() const { return sum(calls); }
+    uint32_t totalSent() const { return sum(sent); }
+    uint32_t totalSuppressed() const { return sum(suppressed); }
+
+private:
+    static uint32_t sum(const uint32_t (&v)[kHidStreams])
+    {
+        uint32_t n = 0;
+        for (uint32_t c : v)
+            n += c;
+        return n;
+    }
+};
+
+class HidOutput
+{
+public:
+    static constexpr uint8_t kDepth = 4;   // queued states per stream
+    static constexpr uint8_t kSources = 8; // press/release sources (one bit each)
+
+    HidOutputConfig config;
+
+    // Mouse
+    void move(int dx, int dy, int wheel = 0);
+    void press(uint8_t buttons, uint8_t source = 0);
+    void release(uint8_t buttons, uint8_t source = 0);
+    // Keyboard, HID usage IDs (0xE0..0xE7 are the modifiers)
+    void keyPress(uint8_t usage, uint8_t source = 0);
+    void keyRelease(uint8_t usage, uint8_t source = 0);
+    void keyReleaseAll(uint8_t source = 0);
+    // Consumer control, one usage at a time
+    void consumerPress(uint16_t usage, uint8_t source = 0);
+    void consumerRelease(uint8_t source = 0);
+    // Absolute pointer (HidAbsPointer), 0..HidAbsPointer::kMax; the latest
+    // position wins
+    void moveTo(uint16_t x, uint16_t y);
+    // Everything up, motion discarded
+    void releaseAll();
+    // What `source` holds goes up and its macros stop (its link was lost);
+    // the other sources' buttons, keys, macros and pending motion stay
+    void releaseAll(uint8_t source);
+    // Timed sequence (see MacroSequencer); kNoMacro if it cannot be taken.
+    // Steps up to the first wait happen now, the rest from flush()
+    MacroId play(const MacroStep *steps, size_t n, uint8_t source = 0);
+    void stop(MacroId id) { macros_.cancel(id); }
+    const MacroStats &macroStats() const { return macros_.stats(); }
+#if LATENCY_TRACE
+    // Notify stamp of the input behind the next reports (kLatUsb)
+    void markOrigin(uint32_t stampUs);
+#endif
+
+    // Run the macro steps due by `nowUs`, then send the report due in the
+    // frame containing it; true while anything is still waiting for later
+    bool flush(uint32_t nowUs);
+    // Microseconds until flush() has work (0 = now, UINT32_MAX = idle)
+    uint32_t usUntilNext(uint32_t nowUs) const;
+    bool pending() const;
+    const HidOutputStats &stats() const { return stats_; }
+
+private:
+    struct Keys
+    {
+        uint8_t modifiers;
+        uint8_t reserved;
+        uint8_t keys[6];
+    };
+
+    // Last state on the wire plus the states waiting for a frame
+    template <typename T>
+    struct States
+    {
+        T sent{};
+        T q[kDepth];
+        uint8_t n = 0;
+
+        const T &latest() const { return n ? q[n - 1] : sent; }
+        const T &before() const { return n >= 2 ? q[n - 2] : sent; }
+        const T &next() const { return n ? q[0] : sent; }
+        void pop();
+    };
+
+    USBHID hid_;
+    States<uint8_t> buttons_;
+    States<Keys> keys_;
+    States<uint16_t> usage_;
+    int32_t dx_ = 0, dy_ = 0, wheel_ = 0;
+    uint8_t buttonsBy_[kSources] = {};  // mouse buttons held per source
+    uint8_t keyHolders_[256] = {};      // usage -> sources holding it
+    uint8_t usageBy_ = 0;               // source of the pending consumer usage
+    uint16_t absX_ = 0, absY_ = 0;         // latest absolute position
+    uint16_t absSentX_ = 0, absSentY_ = 0;
+    bool absPending_ = false;
+    bool absValid_ = false; // a position went out since start
+    uint32_t frame_ = UINT32_MAX; // frame of the last report
+    uint8_t turn_ = 0;            // stream that goes first next frame
+    HidOutputStats stats_;
+    MacroSequencer macros_;
+#if LATENCY_TRACE
+    uint32_t originUs_ = 0;
+    bool originSet_ = false;
+#endif
+
+    template <typename T>
+    void change(States<T> &s, const T &next, bool seals, HidStream stream);
+    void setButtons(uint8_t next);
+    void setKeys(const Keys &next);
+    void setUsage(uint16_t next);
+    void setHeldButtons();
+    bool streamPending(uint8_t stream) const;
+    bool send(uint8_t stream);
+    static bool same(uint8_t a, uint8_t b) { return a == b; }
+    static bool same(uint16_t a, uint16_t b) { return a == b; }
+    static bool same(const Keys &a, const Keys &b);
+    static bool hasKey(const Keys &k, uint8_t usage);
+};
+
+// Shared by all handlers; defined next to the USB HID devices
+extern HidOutput HidOut;
+
+#endif // HID_OUTPUT_H
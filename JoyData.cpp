@@ -1,5 +1,4 @@
 #include "JoyData.h"
-#include <cstring>
 
 JoyData::JoyData()
 {
@@ -8,30 +7,10 @@ JoyData::JoyData()
 
 void JoyData::Clear()
 {
-    time_stamp = millis();
-    lastUpdated = 0;
-    updateCounts = 0;
+    samples_[0] = JoySample{};
+    samples_[1] = JoySample{};
+    cur_ = 0;
 
-    memset(sensor_time, 0, sizeof(sensor_time));
-    gyro[0] = Axis3{};
-    gyro[1] = Axis3{};
-    gyro[2] = Axis3{};
-    accel[0] = Axis3{};
-    accel[1] = Axis3{};
-    accel[2] = Axis3{};
-
-    magno = Axis3{};
-    touchpad = TouchAxis{};
-
-    temperature = 0;
-    triggerButton = false;
-    homeButton = false;
-    backButton = false;
-    volumeUpButton = false;
-    volumeDownButton = false;
-    battery = 0;
-
-    usePad = true;
-    reference = Orientation();
-    orient = Orientation();
+    state = JoyState{};
+    state.time_stamp = millis();
 }
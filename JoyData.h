@@ -2,18 +2,47 @@
 #include <Arduino.h>
 #include <cstdint>
 
+// Button bits; values match byte 58 of the Gear VR packet
+enum JoyButton : uint8_t
+{
+    kBtnTrigger = 0x01,
+    kBtnHome = 0x02,
+    kBtnBack = 0x04,
+    kBtnTouch = 0x08,
+    kBtnVolumeUp = 0x10,
+    kBtnVolumeDown = 0x20,
+};
+
+// Touch-click gestures, the input bits after the buttons (InputBindings):
+// set while the pad is clicked, by where the thumb was at the click
+enum JoyGesture : uint16_t
+{
+    kGestureCenter = 0x040,
+    kGestureLeft = 0x080,
+    kGestureRight = 0x100,
+    kGestureUp = 0x200,
+    kGestureDown = 0x400,
+};
+
 struct TouchAxis
 {
-    int x = 0;
-    int y = 0;
-    bool button = false;
+    uint16_t x = 0; // 10-bit, 0 = no contact
+    uint16_t y = 0;
+};
+
+// Raw IMU axis in device LSB (scale with ACC_SCALE / GYR_SCALE)
+struct RawAxis3
+{
+    int16_t x = 0;
+    int16_t y = 0;
+    int16_t z = 0;
 };
 
 struct Axis3
 {
-    double x = 0;
-    double y = 0;
-    double z = 0;
+    float x = 0;
+    float y = 0;
+    float z = 0;
 };
 
 struct Orientation
@@ -21,37 +50,57 @@ struct Orientation
     float roll = 0, pitch = 0, yaw = 0;
 };
 
-class JoyData
+// One decoded packet, kept in raw device units
+struct JoySample
 {
-public:
-    JoyData();
-
-    // timestamps / counters
-    uint32_t time_stamp = 0;
-    uint32_t lastUpdated = 0;
-    uint32_t updateCounts = 0;
+    uint32_t lastUpdated = 0; // millis() at decode
 
     // motion
-    uint32_t sensor_time[3];
-    Axis3 gyro[3];
-    Axis3 accel[3];
-
-    Axis3 magno;
+    uint32_t sensor_time[3] = {0, 0, 0};
+    RawAxis3 gyro[3];
+    RawAxis3 accel[3];
+    RawAxis3 magno;
     TouchAxis touchpad;
 
     // inputs
+    uint8_t buttons = 0; // JoyButton bits
     uint8_t temperature = 0;
-    bool triggerButton = false;
-    bool homeButton = false;
-    bool backButton = false;
-    bool volumeUpButton = false;
-    bool volumeDownButton = false;
     uint8_t battery = 0;
 
-    bool usePad;
+    bool pressed(uint8_t mask) const { return (buttons & mask) != 0; }
+};
+
+// Float-only state derived across packets
+struct JoyState
+{
+    uint32_t time_stamp = 0;
+    uint32_t updateCounts = 0;
+
+    bool usePad = true;
     Orientation reference;
     Orientation orient;
+    Orientation aim; // orient, or its prediction when enabled: drives the gyro pointer
+};
+
+// Current/previous samples as a double buffer: advance() flips the index
+// instead of copying, and the new current slot is then overwritten by the
+// decoder.
+class JoyData
+{
+public:
+    JoyData();
+
+    JoySample &now() { return samples_[cur_]; }
+    const JoySample &now() const { return samples_[cur_]; }
+    const JoySample &prev() const { return samples_[cur_ ^ 1]; }
+    void advance() { cur_ ^= 1; }
+
+    JoyState state;
 
     // Device-specific parsing is done by the device handler
     void Clear();
+
+private:
+    JoySample samples_[2];
+    uint8_t cur_ = 0;
 };
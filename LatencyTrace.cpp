@@ -0,0 +1,90 @@
+#include "LatencyTrace.h"
+
+#if LATENCY_TRACE
+LatencyTrace Latency;
+#endif
+
+namespace
+{
+    const char *const kStageNames[kLatStages] = {
+        "air jitter", "queue", "parse", "fusion", "emit", "notify->usb",
+    };
+}
+
+size_t LatencyHistogram::bucketOf(uint32_t us)
+{
+    if (us < 16)
+        return us;
+    uint32_t e = 31 - __builtin_clz(us); // >= 4
+    size_t b = 16 + (e - 4) * 8 + ((us >> (e - 3)) & 7);
+    return b < kBuckets ? b : kBuckets - 1;
+}
+
+uint32_t LatencyHistogram::upperBound(size_t bucket)
+{
+    if (bucket < 16)
+        return (uint32_t)bucket;
+    uint32_t e = (uint32_t)(bucket - 16) / 8 + 4;
+    uint32_t m = (uint32_t)(bucket - 16) % 8;
+    uint32_t lower = (1u << e) + (m << (e - 3));
+    return lower + (1u << (e - 3)) - 1;
+}
+
+void LatencyHistogram::add(uint32_t us)
+{
+    buckets_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t m = max_.load(std::memory_order_relaxed);
+    while (us > m && !max_.compare_exchange_weak(m, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &b : buckets_)
+        b.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::percentile(float p) const
+{
+    uint32_t n = count();
+    if (n == 0)
+        return 0;
+    uint32_t target = (uint32_t)ceilf(p * n);
+    if (target == 0)
+        target = 1;
+    uint32_t seen = 0;
+    for (size_t b = 0; b < kBuckets; b++)
+    {
+        seen += buckets_[b].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return min(upperBound(b), max());
+    }
+    return max();
+}
+
+void LatencyTrace::arrival(uint32_t stampUs, uint32_t sensorUs)
+{
+    record(kLatAir, clock_.excess(stampUs, sensorUs));
+}
+
+void LatencyTrace::reset()
+{
+    for (auto &s : stages_)
+        s.reset();
+    clock_.reset();
+}
+
+void LatencyTrace::dump(Print &out) const
+{
+    out.println("stage           count      p50      p99      max (us)");
+    for (uint8_t s = 0; s < kLatStages; s++)
+    {
+        const LatencyHistogram &h = stages_[s];
+        out.printf("%-12s %8u %8u %8u %8u\n", kStageNames[s], h.count(), h.percentile(0.5f),
+                   h.percentile(0.99f), h.max());
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "ArrivalClock.h"
+
+// Per-stage latency histograms for the notify -> USB path. Off by default:
+// with LATENCY_TRACE 0 the LAT_* macros expand to nothing and no state
+// exists. Enable here (or with -DLATENCY_TRACE=1) and send 'l' over Serial
+// to dump, 'r' to clear.
+#ifndef LATENCY_TRACE
+#define LATENCY_TRACE 0
+#endif
+
+enum LatStage : uint8_t
+{
+    kLatAir,     // sensor_time -> notify, above the fastest packet seen (transport jitter)
+    kLatQueue,   // notify -> BLE task picks the frame up
+    kLatParse,   // packet decode
+    kLatFusion,  // bias + AHRS steps
+    kLatEmit,    // emitUSB: pointer shaping, HID state changes
+    kLatUsb,     // notify -> HID report handed to the USB stack
+    kLatStages
+};
+
+// Log-linear histogram of microsecond samples: exact below 16 us, then 8
+// buckets per power of two (<= 12.5% bucket width) up to ~16 s. Lock-free:
+// relaxed atomic counters, so any task may record or read.
+class LatencyHistogram
+{
+public:
+    static constexpr size_t kBuckets = 176;
+
+    LatencyHistogram() { reset(); }
+    void add(uint32_t us);
+    void reset();
+
+    uint32_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint32_t max() const { return max_.load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding the p-quantile (0..1)
+    uint32_t percentile(float p) const;
+
+private:
+    std::atomic<uint32_t> buckets_[kBuckets];
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> max_;
+
+    static size_t bucketOf(uint32_t us);
+    static uint32_t upperBound(size_t bucket);
+};
+
+class LatencyTrace
+{
+public:
+    void record(LatStage stage, uint32_t us) { stages_[stage].add(us); }
+    // Notify stamp against the device clock: tracks the best-case offset,
+    // records how far this packet is behind it
+    void arrival(uint32_t stampUs, uint32_t sensorUs);
+    // New link: the device clock restarted
+    void relink() { clock_.reset(); }
+
+    const LatencyHistogram &stage(LatStage s) const { return stages_[s]; }
+    void reset();
+    void dump(Print &out) const;
+
+private:
+    LatencyHistogram stages_[kLatStages];
+    ArrivalClock clock_;
+};
+
+#if LATENCY_TRACE
+extern LatencyTrace Latency;
+#define LAT_STAMP(name) const uint32_t name = micros()
+#define LAT_SINCE(stage, name) Latency.record((stage), micros() - (name))
+#define LAT_ARRIVAL(stampUs, sensorUs) Latency.arrival((stampUs), (sensorUs))
+#define LAT_RELINK() Latency.relink()
+#else
+#define LAT_STAMP(name) do {} while (0)
+#define LAT_SINCE(stage, name) do {} while (0)
+#define LAT_ARRIVAL(stampUs, sensorUs) do {} while (0)
+#define LAT_RELINK() do {} while (0)
+#endif
+
+#endif // LATENCY_TRACE_H
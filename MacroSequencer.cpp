@@ -0,0 +1,198 @@
+#include "MacroSequencer.h"
+#include "HidOutput.h"
+
+MacroSequencer::MacroSequencer()
+{
+    memset(wheel_, kEnd, sizeof(wheel_));
+}
+
+uint8_t MacroSequencer::active() const
+{
+    uint8_t n = 0;
+    for (const Macro &m : m_)
+        n += m.live;
+    return n;
+}
+
+MacroId MacroSequencer::start(const MacroStep *steps, size_t n, uint8_t source, uint32_t nowUs, HidOutput &out)
+{
+    uint8_t i = 0;
+    while (i < kMaxMacros && m_[i].live)
+        i++;
+    if (n == 0 || n > kMaxSteps || i == kMaxMacros)
+    {
+        stats_.rejected++;
+        return kNoMacro;
+    }
+    // an idle wheel has no ticks to catch up on
+    if (!active())
+        tick_ = nowUs / kTickUs;
+
+    Macro &m = m_[i];
+    memcpy(m.steps, steps, n * sizeof(MacroStep));
+    m.count = (uint8_t)n;
+    m.at = 0;
+    m.source = source;
+    m.gen++;
+    m.live = true;
+    m.dueUs = nowUs;
+    m.next = kEnd;
+    stats_.started++;
+    const MacroId id = (MacroId)(m.gen << 8 | i);
+    if (run(i, nowUs, out))
+        schedule(i);
+    return id;
+}
+
+bool MacroSequencer::run(uint8_t i, uint32_t nowUs, HidOutput &out)
+{
+    Macro &m = m_[i];
+    while (m.at < m.count)
+    {
+        const MacroStep &s = m.steps[m.at];
+        if (s.op == MacroOp::Wait)
+        {
+            m.dueUs += s.arg * 1000u;
+            m.at++;
+            if ((int32_t)(nowUs - m.dueUs) < 0)
+                return true;
+            continue; // zero wait, or already late: straight on
+        }
+        if (m.at > 0 && m.steps[m.at - 1].op == MacroOp::Wait)
+            recordLate(nowUs - m.dueUs);
+        switch (s.op)
+        {
+        case MacroOp::KeyPress:
+            out.keyPress((uint8_t)s.arg, m.source);
+            break;
+        case MacroOp::KeyRelease:
+            out.keyRelease((uint8_t)s.arg, m.source);
+            break;
+        case MacroOp::ConsumerPress:
+            out.consumerPress(s.arg, m.source);
+            break;
+        case MacroOp::ConsumerRelease:
+            out.consumerRelease(m.source);
+            break;
+        case MacroOp::MousePress:
+            out.press((uint8_t)s.arg, m.source);
+            break;
+        case MacroOp::MouseRelease:
+            out.release((uint8_t)s.arg, m.source);
+            break;
+        default:
+            break;
+        }
+        m.at++;
+    }
+    m.live = false;
+    stats_.finished++;
+    return false;
+}
+
+void MacroSequencer::schedule(uint8_t i)
+{
+    Macro &m = m_[i];
+    uint8_t slot = (uint8_t)((m.dueUs / kTickUs) % kWheelSlots);
+    m.next = wheel_[slot];
+    wheel_[slot] = i;
+}
+
+void MacroSequencer::unlink(uint8_t i)
+{
+    uint8_t *p = &wheel_[(m_[i].dueUs / kTickUs) % kWheelSlots];
+    while (*p != kEnd && *p != i)
+        p = &m_[*p].next;
+    if (*p == i)
+        *p = m_[i].next;
+    m_[i].next = kEnd;
+}
+
+void MacroSequencer::poll(uint32_t nowUs, HidOutput &out)
+{
+    const uint32_t nowTick = nowUs / kTickUs;
+    if (!active())
+    {
+        tick_ = nowTick;
+        return;
+    }
+    // Buckets from the last pass's tick to this one; a full turn (or the
+    // clock wrapping) visits every bucket once
+    uint32_t ticks = nowTick - tick_;
+    if (nowTick < tick_ || ticks >= kWheelSlots)
+        ticks = kWheelSlots - 1;
+    for (uint32_t k = 0; k <= ticks; k++)
+    {
+        const uint8_t slot = (uint8_t)((tick_ + k) % kWheelSlots);
+        uint8_t i = wheel_[slot];
+        wheel_[slot] = kEnd;
+        while (i != kEnd)
+        {
+            Macro &m = m_[i];
+            const uint8_t next = m.next;
+            m.next = kEnd;
+            if ((int32_t)(nowUs - m.dueUs) < 0)
+            {
+                // a later turn of the wheel
+                m.next = wheel_[slot];
+                wheel_[slot] = i;
+            }
+            else if (run(i, nowUs, out))
+                schedule(i);
+            i = next;
+        }
+    }
+    tick_ = nowTick;
+}
+
+uint32_t MacroSequencer::usUntilNext(uint32_t nowUs) const
+{
+    uint32_t next = UINT32_MAX;
+    for (const Macro &m : m_)
+    {
+        if (!m.live)
+            continue;
+        int32_t d = (int32_t)(m.dueUs - nowUs);
+        next = min(next, d > 0 ? (uint32_t)d : 0u);
+    }
+    return next;
+}
+
+void MacroSequencer::cancel(MacroId id)
+{
+    const uint8_t i = (uint8_t)(id & 0xFF);
+    if (i >= kMaxMacros || !m_[i].live || m_[i].gen != (uint8_t)(id >> 8))
+        return;
+    unlink(i);
+    m_[i].live = false;
+    stats_.cancelled++;
+}
+
+void MacroSequencer::cancelSource(uint8_t source)
+{
+    for (uint8_t i = 0; i < kMaxMacros; i++)
+        if (m_[i].live && m_[i].source == source)
+            cancel((MacroId)(m_[i].gen << 8 | i));
+}
+
+void MacroSequencer::clear()
+{
+    for (Macro &m : m_)
+    {
+        m.live = false;
+        m.next = kEnd;
+    }
+    memset(wheel_, kEnd, sizeof(wheel_));
+}
+
+void MacroSequencer::recordLate(uint32_t lateUs)
+{
+    static const uint32_t kBounds[MacroStats::kLateBuckets - 1] = {250, 500, 1000, 2000, 4000, 8000};
+    uint8_t b = 0;
+    while (b < MacroStats::kLateBuckets - 1 && lateUs >= kBounds[b])
+        b++;
+    stats_.late[b]++;
+    stats_.timedSteps++;
+    stats_.lateSumUs += lateUs;
+    stats_.lateMaxUs = max(stats_.lateMaxUs, lateUs);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef MACRO_SEQUENCER_H
+#define MACRO_SEQUENCER_H
+
+#include <Arduino.h>
+
+class HidOutput;
+
+// Timed multi-step HID actions (Alt, 10 ms, Tab) without blocking the
+// caller. start() runs the steps up to the first wait at once; the rest run
+// from poll(), which HidOutput::flush() calls on every service pass. Waiting
+// macros sit on a timer wheel of 1 ms ticks: a pass looks only at the
+// buckets of the ticks since the last pass (the current one included, so a
+// step runs at its due time, not at the next tick), not at every macro.
+//
+// A step runs at the first pass at or after its due time; due times follow
+// from the previous due time, not from when the step actually ran, so
+// lateness does not add up along a macro. stats() keeps how late the timed
+// steps ran.
+//
+// Not locked, like HidOutput: start(), cancel() and poll() all run on the
+// task that flushes HidOut. A lost link cancels its source's macros from
+// HidOutput::releaseAll(source), which onDisconnected() calls there too.
+
+enum class MacroOp : uint8_t
+{
+    KeyPress,        // arg: keyboard usage ID
+    KeyRelease,
+    ConsumerPress,   // arg: consumer usage
+    ConsumerRelease,
+    MousePress,      // arg: mouse button bits
+    MouseRelease,
+    Wait,            // arg: ms
+};
+
+struct MacroStep
+{
+    MacroOp op;
+    uint16_t arg;
+};
+
+typedef uint16_t MacroId;
+
+struct MacroStats
+{
+    static constexpr uint8_t kLateBuckets = 7; // < 0.25, 0.5, 1, 2, 4, 8 ms, more
+
+    uint32_t started = 0;
+    uint32_t finished = 0;
+    uint32_t cancelled = 0;
+    uint32_t rejected = 0;   // no free slot, or too many steps
+    uint32_t timedSteps = 0; // steps that ran after a wait
+    uint32_t lateMaxUs = 0;
+    uint64_t lateSumUs = 0;
+    uint32_t late[kLateBuckets] = {};
+
+    uint32_t lateMeanUs() const { return timedSteps ? (uint32_t)(lateSumUs / timedSteps) : 0; }
+};
+
+class MacroSequencer
+{
+public:
+    static constexpr uint8_t kMaxMacros = 8;  // in flight at once
+    static constexpr uint8_t kMaxSteps = 20;
+    static constexpr uint32_t kTickUs = 1000;
+    static constexpr uint8_t kWheelSlots = 64; // ticks per wheel turn; longer waits go round again
+    static constexpr MacroId kNoMacro = 0xFFFF;
+
+    MacroSequencer();
+
+    // Copies the steps; kNoMacro if none are free or the macro is too long
+    MacroId start(const MacroStep *steps, size_t n, uint8_t source, uint32_t nowUs, HidOutput &out);
+    // Drop the rest of a macro (a no-op once it has finished)
+    void cancel(MacroId id);
+    void cancelSource(uint8_t source);
+    void clear();
+
+    // Run the steps due by nowUs
+    void poll(uint32_t nowUs, HidOutput &out);
+    // Microseconds until a step is due (UINT32_MAX = nothing waiting)
+    uint32_t usUntilNext(uint32_t nowUs) const;
+    uint8_t active() const;
+    const MacroStats &stats() const { return stats_; }
+
+private:
+    static constexpr uint8_t kEnd = 0xFF;
+
+    struct Macro
+    {
+        MacroStep steps[kMaxSteps];
+        uint8_t count = 0;
+        uint8_t at = 0;        // next step
+        uint8_t source = 0;
+        uint8_t gen = 0;       // MacroId high byte: stale ids are ignored
+        bool live = false;
+        uint32_t dueUs = 0;    // when steps[at] is due
+        uint8_t next = kEnd;   // wheel bucket chain
+    };
+
+    Macro m_[kMaxMacros];
+    uint8_t wheel_[kWheelSlots];
+    uint32_t tick_ = 0; // last tick polled
+    MacroStats stats_;
+
+    // Steps from `at` until a wait that is not due yet; false once finished
+    bool run(uint8_t i, uint32_t nowUs, HidOutput &out);
+    void schedule(uint8_t i);
+    void unlink(uint8_t i);
+    void recordLate(uint32_t lateUs);
+};
+
+#endif // MACRO_SEQUENCER_H
@@ -0,0 +1,166 @@
+#include "PacketCapture.h"
+#include "GearVR.h"
+
+namespace
+{
+    const uint8_t kMagic[4] = {'G', 'V', 'C', 'P'};
+}
+
+void PacketCapture::begin(Print &out, bool task)
+{
+    out_ = &out;
+    lastUs_ = 0;
+    records_ = 0;
+    bytes_ = 0;
+    const uint8_t header[8] = {kMagic[0], kMagic[1], kMagic[2], kMagic[3], kVersion, CaptureRecord::kMaxFrame, 0, 0};
+    write(header, sizeof(header));
+    if (task && !task_)
+        xTaskCreatePinnedToCore(captureTask, "CaptureTask", 3072, this, 1, &task_, 0);
+    active_.store(true, std::memory_order_release);
+}
+
+void PacketCapture::end()
+{
+    active_.store(false, std::memory_order_release);
+    if (task_)
+        xTaskNotifyGive(task_);
+}
+
+void PacketCapture::push(bool tx, const uint8_t *data, size_t len, uint32_t stampUs)
+{
+    if (!active_.load(std::memory_order_acquire))
+        return;
+    uint8_t buf[CaptureRecord::kMaxFrame + 1];
+    if (len > CaptureRecord::kMaxFrame)
+        len = CaptureRecord::kMaxFrame;
+    buf[0] = tx;
+    memcpy(buf + 1, data, len);
+    ring_.push(buf, len + 1, stampUs);
+}
+
+void PacketCapture::write(const uint8_t *data, size_t len)
+{
+    out_->write(data, len);
+    bytes_ += len;
+}
+
+size_t PacketCapture::drain()
+{
+    size_t done = 0;
+    while (const Ring::Frame *f = ring_.peek())
+    {
+        // varint delta (LEB128) + direction/length byte + frame
+        uint8_t rec[5 + 1 + CaptureRecord::kMaxFrame];
+        size_t n = 0;
+        uint32_t delta = f->stampUs - lastUs_;
+        lastUs_ = f->stampUs;
+        do
+        {
+            uint8_t b = delta & 0x7F;
+            delta >>= 7;
+            rec[n++] = delta ? b | 0x80 : b;
+        } while (delta);
+        uint8_t len = f->len - 1;
+        rec[n++] = (uint8_t)(f->data[0] << 7 | len);
+        memcpy(rec + n, f->data + 1, len);
+        n += len;
+        ring_.pop();
+        write(rec, n);
+        records_++;
+        done++;
+    }
+    return done;
+}
+
+void PacketCapture::captureTask(void *arg)
+{
+    PacketCapture *self = static_cast<PacketCapture *>(arg);
+    for (;;)
+    {
+        if (self->out_)
+            self->drain();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(kDrainMs));
+    }
+}
+
+bool CaptureReader::begin()
+{
+    uint8_t header[8];
+    for (uint8_t &b : header)
+    {
+        int c = in_.read();
+        if (c < 0)
+            return false;
+        b = (uint8_t)c;
+    }
+    lastUs_ = 0;
+    return memcmp(header, kMagic, 4) == 0 && header[4] == PacketCapture::kVersion &&
+           header[5] <= CaptureRecord::kMaxFrame;
+}
+
+bool CaptureReader::next(CaptureRecord &r)
+{
+    uint32_t delta = 0;
+    for (uint8_t shift = 0;; shift += 7)
+    {
+        int c = in_.read();
+        if (c < 0 || shift > 28)
+            return false;
+        delta |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+            break;
+    }
+    int lenByte = in_.read();
+    if (lenByte < 0)
+        return false;
+    r.tx = lenByte & 0x80;
+    r.len = lenByte & 0x7F;
+    if (r.len > CaptureRecord::kMaxFrame)
+        return false;
+    for (uint8_t i = 0; i < r.len; i++)
+    {
+        int c = in_.read();
+        if (c < 0)
+            return false;
+        r.data[i] = (uint8_t)c;
+    }
+    lastUs_ += delta;
+    r.stampUs = lastUs_;
+    return true;
+}
+
+ReplayStats replayCapture(CaptureReader &in, GearVR &gear, ReplaySpeed speed)
+{
+    ReplayStats stats;
+    CaptureRecord r;
+    const uint32_t start = micros();
+    bool first = true;
+    uint32_t firstUs = 0;
+    while (in.next(r))
+    {
+        if (r.tx)
+        {
+            stats.commands++;
+            continue;
+        }
+        if (first)
+        {
+            first = false;
+            firstUs = r.stampUs;
+        }
+        if (speed == ReplaySpeed::Original)
+        {
+            int32_t wait = (int32_t)(start + (r.stampUs - firstUs) - micros());
+            if (wait > 2000)
+                delay((uint32_t)wait / 1000); // let other tasks run through long gaps
+            wait = (int32_t)(start + (r.stampUs - firstUs) - micros());
+            if (wait > 0)
+                delayMicroseconds((uint32_t)wait);
+        }
+        gear.feedNotify(r.data, r.len);
+        gear.update(0);
+        stats.frames++;
+    }
+    stats.elapsedUs = micros() - start;
+    return stats;
+}
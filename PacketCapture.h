@@ -0,0 +1,111 @@
+#pragma once
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "FrameRing.h"
+
+// Session capture of the raw GearVR link: every notification frame (60-byte
+// packets and short command requests) and every command written back, with
+// its receive/send stamp. The BLE task only copies frames into a ring; a
+// low-priority task writes them to any Print (a LittleFS File, or Serial
+// for a PC-side capture). The firmware console is behind PACKET_CAPTURE.
+//
+// File format (little-endian):
+//   "GVCP", u8 version, u8 max frame size, u16 reserved
+//   per record: varint delta us from the previous record (first: from 0),
+//               u8 (tx << 7 | len), len bytes
+#ifndef PACKET_CAPTURE
+#define PACKET_CAPTURE 0
+#endif
+
+class GearVR;
+
+struct CaptureRecord
+{
+    static constexpr size_t kMaxFrame = 60;
+    uint32_t stampUs;
+    bool tx; // command written to the controller, not a notification
+    uint8_t len;
+    uint8_t data[kMaxFrame];
+};
+
+class PacketCapture
+{
+public:
+    static constexpr uint8_t kVersion = 1;
+    static constexpr size_t kRingFrames = 64; // ~1 s of stream
+    static constexpr uint32_t kDrainMs = 20;  // writer task period
+
+    // Starts a session (the previous one fully written: pending() == 0):
+    // writes the header and records from now on. With `task` the writer
+    // task drains the ring, otherwise call drain().
+    void begin(Print &out, bool task = true);
+    // Stops recording. Queued records are still written: wait for pending()
+    // to reach 0 before closing the file.
+    void end();
+    bool active() const { return active_.load(std::memory_order_acquire); }
+
+    // BLE task (single producer)
+    void rx(const uint8_t *data, size_t len, uint32_t stampUs) { push(false, data, len, stampUs); }
+    void tx(const uint8_t *data, size_t len, uint32_t stampUs) { push(true, data, len, stampUs); }
+
+    // Writes queued records; returns how many
+    size_t drain();
+    size_t pending() const { return ring_.size(); }
+    uint32_t records() const { return records_; }
+    uint32_t bytes() const { return bytes_; }
+    uint32_t dropped() const { return ring_.overflows(); }
+
+private:
+    // data[0] carries the direction, the frame follows
+    typedef FrameRing<CaptureRecord::kMaxFrame + 1, kRingFrames> Ring;
+    Ring ring_;
+    std::atomic<bool> active_{false};
+    Print *out_ = nullptr;
+    uint32_t lastUs_ = 0;
+    uint32_t records_ = 0;
+    uint32_t bytes_ = 0;
+    TaskHandle_t task_ = nullptr;
+
+    void push(bool tx, const uint8_t *data, size_t len, uint32_t stampUs);
+    void write(const uint8_t *data, size_t len);
+    static void captureTask(void *arg);
+};
+
+// Reads a capture back, record by record
+class CaptureReader
+{
+public:
+    explicit CaptureReader(Stream &in) : in_(in) {}
+    // Checks the header; false if this is not a capture we can read
+    bool begin();
+    // Next record; false at the end (or on a truncated record)
+    bool next(CaptureRecord &r);
+
+private:
+    Stream &in_;
+    uint32_t lastUs_ = 0;
+};
+
+enum class ReplaySpeed : uint8_t
+{
+    Original, // paced by the recorded stamps (delayMicroseconds)
+    Max,      // back to back: pipeline throughput
+};
+
+struct ReplayStats
+{
+    uint32_t frames = 0;   // notifications fed to the handler
+    uint32_t commands = 0; // recorded commands (not replayed)
+    uint32_t elapsedUs = 0;
+};
+
+// Feeds the recorded notifications through GearVR::feedNotify(), the
+// callback's own entry, and runs gear.update() after each one as the BLE
+// task would. Run it with the controller disconnected: the BLE task only
+// drives the handler while a link is up.
+ReplayStats replayCapture(CaptureReader &in, GearVR &gear, ReplaySpeed speed);
+
+#endif // PACKET_CAPTURE_H
@@ -0,0 +1,111 @@
+#pragma once
+#ifndef PACKET_LAYOUT_H
+#define PACKET_LAYOUT_H
+
+#include <Arduino.h>
+#include <utility>
+
+// Declarative packet layouts. A PacketField says where a value sits in a
+// notification: first byte, how many bytes form the word and in which order,
+// the bit range within that word, signedness and the unit scale. Fields are
+// constexpr, and readField<F>() expands into the same shifts and masks one
+// would write by hand, with no table lookups or loops at run time:
+//
+//   static constexpr PacketField kTouchX = be16(54).bitRange(2, 10);
+//   out.touchpad.x = readField<kTouchX>(p);
+//
+// Fields repeated at a fixed stride (IMU subsamples) are read with an index:
+// readField<kAccelX, 2>(p).
+enum class Endian : uint8_t
+{
+    Little,
+    Big,
+};
+
+struct PacketField
+{
+    uint8_t offset = 0;             // first byte of the word
+    uint8_t bytes = 1;              // 1..4 bytes assembled into the word
+    Endian endian = Endian::Little; // byte order of the word
+    uint8_t lsb = 0;                // lowest bit of the value in the word
+    uint8_t bits = 8;               // value width
+    bool isSigned = false;          // two's complement, sign-extended from `bits`
+    float scale = 1.0f;             // SI units per LSB, for readScaled()
+    uint8_t stride = 0;             // bytes between repeats
+
+    constexpr PacketField bitRange(uint8_t from, uint8_t width) const
+    {
+        PacketField f = *this;
+        f.lsb = from;
+        f.bits = width;
+        return f;
+    }
+    constexpr PacketField asSigned() const
+    {
+        PacketField f = *this;
+        f.isSigned = true;
+        return f;
+    }
+    constexpr PacketField scaledBy(float s) const
+    {
+        PacketField f = *this;
+        f.scale = s;
+        return f;
+    }
+    constexpr PacketField repeated(uint8_t every) const
+    {
+        PacketField f = *this;
+        f.stride = every;
+        return f;
+    }
+
+    // One past the last byte of repeat `count - 1`
+    constexpr size_t end(size_t count = 1) const { return offset + (count - 1) * stride + bytes; }
+    constexpr bool valid() const { return bytes >= 1 && bytes <= 4 && bits >= 1 && lsb + bits <= bytes * 8; }
+};
+
+constexpr PacketField u8(uint8_t offset) { return {offset, 1, Endian::Little, 0, 8}; }
+constexpr PacketField le16(uint8_t offset) { return {offset, 2, Endian::Little, 0, 16}; }
+constexpr PacketField be16(uint8_t offset) { return {offset, 2, Endian::Big, 0, 16}; }
+constexpr PacketField le32(uint8_t offset) { return {offset, 4, Endian::Little, 0, 32}; }
+constexpr PacketField be32(uint8_t offset) { return {offset, 4, Endian::Big, 0, 32}; }
+
+namespace packet_layout
+{
+    template <const PacketField &F, size_t I, size_t... B>
+    inline uint32_t word(const uint8_t *p, std::index_sequence<B...>)
+    {
+        constexpr size_t at = F.offset + I * F.stride;
+        return (((uint32_t)p[at + B] << (F.endian == Endian::Little ? 8 * B : 8 * (F.bytes - 1 - B))) | ...);
+    }
+}
+
+// Value of field F (repeat I) in packet p: uint32_t, or int32_t if signed.
+// The caller checks the length (PacketField::end()).
+template <const PacketField &F, size_t I = 0>
+inline auto readField(const uint8_t *p)
+{
+    static_assert(F.valid(), "field must fit in 1..4 bytes");
+    constexpr uint32_t mask = F.bits >= 32 ? 0xFFFFFFFFu : (1u << F.bits) - 1;
+    uint32_t v = packet_layout::word<F, I>(p, std::make_index_sequence<F.bytes>());
+    if constexpr (F.lsb != 0)
+        v >>= F.lsb;
+    if constexpr (F.bits < F.bytes * 8u)
+        v &= mask;
+    if constexpr (F.isSigned)
+    {
+        constexpr unsigned pad = 32 - F.bits;
+        return (int32_t)(v << pad) >> pad;
+    }
+    else
+        return v;
+}
+
+// Field F in its SI unit
+template <const PacketField &F, size_t I = 0>
+inline float readScaled(const uint8_t *p)
+{
+    return readField<F, I>(p) * F.scale;
+}
+
+#endif // PACKET_LAYOUT_H
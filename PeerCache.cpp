@@ -0,0 +1,121 @@
+#include "PeerCache.h"
+#include <Preferences.h>
+
+namespace
+{
+    const char *kNamespace = "blepeers";
+    const char *kKey = "peers";
+}
+
+void PeerCache::load()
+{
+    Preferences prefs;
+    prefs.begin(kNamespace, true);
+    Blob b;
+    // layout changed or nothing stored yet: start empty
+    if (prefs.getBytes(kKey, &b, sizeof(b)) == sizeof(b) && b.version == kVersion)
+        blob_ = b;
+    else
+        blob_ = Blob();
+    prefs.end();
+    blob_.version = kVersion;
+    dirty_ = false;
+}
+
+void PeerCache::save()
+{
+    if (!dirty_)
+        return;
+    Preferences prefs;
+    prefs.begin(kNamespace, false);
+    prefs.putBytes(kKey, &blob_, sizeof(blob_));
+    prefs.end();
+    dirty_ = false;
+}
+
+void PeerCache::clear()
+{
+    blob_ = Blob();
+    blob_.version = kVersion;
+    dirty_ = true;
+}
+
+PeerEntry *PeerCache::find(const uint8_t addr[6])
+{
+    for (PeerEntry &e : blob_.entries)
+        if (e.seq && memcmp(e.addr, addr, 6) == 0)
+            return &e;
+    return nullptr;
+}
+
+void PeerCache::remember(const uint8_t addr[6], uint8_t addrType, uint8_t handler, const PeerHandles &handles)
+{
+    PeerEntry *e = find(addr);
+    bool changed = !e;
+    if (!e)
+    {
+        // free slot first, else the least recently used one
+        e = &blob_.entries[0];
+        for (PeerEntry &c : blob_.entries)
+            if (c.seq < e->seq)
+                e = &c;
+        memcpy(e->addr, addr, 6);
+    }
+    changed = changed || e->addrType != addrType || e->handler != handler || e->failures ||
+              memcmp(&e->handles, &handles, sizeof(handles)) != 0;
+    e->addrType = addrType;
+    e->handler = handler;
+    e->handles = handles;
+    e->failures = 0;
+    // recency alone goes to NVS with the next real change: a plain
+    // reconnect costs no flash write
+    e->seq = ++blob_.seq;
+    if (changed)
+        dirty_ = true;
+}
+
+bool PeerCache::failed(const uint8_t addr[6])
+{
+    PeerEntry *e = find(addr);
+    if (!e)
+        return false;
+    dirty_ = true;
+    if (++e->failures < kMaxFailures)
+        return true;
+    *e = PeerEntry();
+    return false;
+}
+
+void PeerCache::forget(const uint8_t addr[6])
+{
+    if (PeerEntry *e = find(addr))
+    {
+        *e = PeerEntry();
+        dirty_ = true;
+    }
+}
+
+size_t PeerCache::ordered(const PeerEntry *out[kEntries]) const
+{
+    size_t n = 0;
+    for (const PeerEntry &e : blob_.entries)
+    {
+        if (!e.seq)
+            continue;
+        // insertion sort by seq, newest first (kEntries is tiny)
+        size_t i = n++;
+        for (; i > 0 && out[i - 1]->seq < e.seq; i--)
+            out[i] = out[i - 1];
+        out[i] = &e;
+    }
+    return n;
+}
+
+size_t PeerCache::size() const
+{
+    size_t n = 0;
+    for (const PeerEntry &e : blob_.entries)
+        if (e.seq)
+            n++;
+    return n;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef PEER_CACHE_H
+#define PEER_CACHE_H
+
+#include <Arduino.h>
+#include "BLEDeviceHandler.h"
+
+// Bonded peers seen before, persisted in NVS: enough to connect straight to
+// the address and start the link without scanning or GATT discovery.
+struct PeerEntry
+{
+    uint8_t addr[6];
+    uint8_t addrType;
+    uint8_t handler;   // BLEManager registration index
+    PeerHandles handles;
+    uint8_t failures;  // consecutive failed direct connects
+    uint32_t seq;      // last successful use; 0 = empty slot
+};
+
+class PeerCache
+{
+public:
+    static constexpr size_t kEntries = 4;
+    static constexpr uint8_t kMaxFailures = 3; // then the entry is dropped
+
+    void load();
+    void save();   // writes NVS only if something changed
+    void clear();
+
+    // Successful connect: insert or refresh, evicting the least recently used.
+    // NVS is dirtied only by a new or changed entry, not by recency
+    void remember(const uint8_t addr[6], uint8_t addrType, uint8_t handler, const PeerHandles &handles);
+    // Direct connect failed; returns false once the entry got dropped
+    bool failed(const uint8_t addr[6]);
+    void forget(const uint8_t addr[6]);
+
+    // Valid entries, most recently used first; returns the count
+    size_t ordered(const PeerEntry *out[kEntries]) const;
+    size_t size() const;
+
+private:
+    static constexpr uint8_t kVersion = 1;
+    struct Blob
+    {
+        uint8_t version;
+        uint32_t seq;
+        PeerEntry entries[kEntries];
+    };
+
+    Blob blob_ = {};
+    bool dirty_ = false;
+
+    PeerEntry *find(const uint8_t addr[6]);
+};
+
+#endif // PEER_CACHE_H
@@ -0,0 +1,94 @@
+#include "Pointer.h"
+
+namespace
+{
+    constexpr float kTwoPi = 6.28318530718f;
+
+    inline float smoothingFactor(float cutoff, float dt)
+    {
+        float r = kTwoPi * cutoff * dt;
+        return r / (r + 1.0f);
+    }
+}
+
+float OneEuroFilter::filter(float x, float dt, const OneEuroConfig &cfg)
+{
+    if (cfg.minCutoff <= 0 || dt <= 0)
+    {
+        x_ = x;
+        return x;
+    }
+    if (!primed_)
+    {
+        primed_ = true;
+        x_ = x;
+        dx_ = 0;
+        return x;
+    }
+    float dx = (x - x_) / dt;
+    dx_ += smoothingFactor(cfg.dCutoff, dt) * (dx - dx_);
+    float cutoff = cfg.minCutoff + cfg.beta * fabsf(dx_);
+    x_ += smoothingFactor(cutoff, dt) * (x - x_);
+    return x_;
+}
+
+float AccelCurve::gain(float speed) const
+{
+    if (accel <= 0 || speed <= thresholdCps)
+        return sensitivity;
+    float factor = 1.0f + accel * (speed - thresholdCps) / thresholdCps;
+    return sensitivity * min(factor, maxFactor);
+}
+
+void PointerPath::reset()
+{
+    fx_.reset();
+    fy_.reset();
+    primed_ = false;
+    carryX_ = carryY_ = 0;
+}
+
+void PointerPath::emit(float dx, float dy, float dt, const AccelCurve &curve, int &outX, int &outY)
+{
+    float speed = dt > 0 ? sqrtf(dx * dx + dy * dy) / dt : 0;
+    float g = curve.gain(speed);
+    float x = carryX_ + dx * g;
+    float y = carryY_ + dy * g;
+    // whole counts go out, the fraction waits for the next report
+    outX = (int)x;
+    outY = (int)y;
+    carryX_ = x - outX;
+    carryY_ = y - outY;
+}
+
+bool PointerPath::track(float x, float y, float dt, const PointerTuning &t, int &outX, int &outY)
+{
+    x = fx_.filter(x, dt, t.filter);
+    y = fy_.filter(y, dt, t.filter);
+    outX = outY = 0;
+    if (!primed_)
+    {
+        primed_ = true;
+        lastX_ = x;
+        lastY_ = y;
+        return false;
+    }
+    float dx = x - lastX_, dy = y - lastY_;
+    lastX_ = x;
+    lastY_ = y;
+    emit(dx, dy, dt, t.curve, outX, outY);
+    return true;
+}
+
+void PointerPath::smooth(float &x, float &y, float dt, const OneEuroConfig &f)
+{
+    x = fx_.filter(x, dt, f);
+    y = fy_.filter(y, dt, f);
+}
+
+void PointerPath::rate(float x, float y, float countsPerSec, float dt, const PointerTuning &t, int &outX, int &outY)
+{
+    x = fx_.filter(x, dt, t.filter);
+    y = fy_.filter(y, dt, t.filter);
+    emit(x * countsPerSec * dt, y * countsPerSec * dt, dt, t.curve, outX, outY);
+}
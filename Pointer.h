@@ -0,0 +1,83 @@
+#pragma once
+#ifndef POINTER_H
+#define POINTER_H
+
+#include <Arduino.h>
+
+// Pointer shaping between the decoded controller sample and HidOutput:
+// One Euro smoothing of the tracked position, an acceleration curve on the
+// resulting speed and a sub-count accumulator, so slow motion adds up
+// instead of being truncated away packet by packet.
+
+// One Euro filter (Casiez et al. 2012): a low-pass whose cutoff rises with
+// speed. Slow or resting input is smoothed hard (jitter gone), fast input
+// passes with little lag.
+struct OneEuroConfig
+{
+    float minCutoff = 1.0f; // Hz at rest; <= 0 disables the filter
+    float beta = 0.0f;      // cutoff increase per unit/s of speed
+    float dCutoff = 1.0f;   // Hz, smoothing of the speed estimate
+};
+
+class OneEuroFilter
+{
+public:
+    float filter(float x, float dt, const OneEuroConfig &cfg);
+    void reset() { primed_ = false; }
+
+private:
+    bool primed_ = false;
+    float x_ = 0;
+    float dx_ = 0;
+};
+
+// Speed-dependent gain: flat `sensitivity` below the threshold, rising by
+// `accel` per threshold of extra speed above it, capped at maxFactor.
+struct AccelCurve
+{
+    float sensitivity = 1.0f;  // output counts per input unit
+    float accel = 0.0f;        // 0 = linear
+    float thresholdCps = 400;  // input speed where acceleration starts, units/s
+    float maxFactor = 3.0f;    // cap on the acceleration multiplier
+
+    float gain(float speed) const;
+};
+
+struct PointerTuning
+{
+    OneEuroConfig filter;
+    AccelCurve curve;
+};
+
+class PointerPath
+{
+public:
+    // New contact / reference / mode: forget filter state and carry
+    void reset();
+
+    // Position tracking (touchpad): smooths (x, y) and returns the motion
+    // since the previous call in whole counts. false on the first sample
+    // after reset(), which only sets the baseline.
+    bool track(float x, float y, float dt, const PointerTuning &t, int &outX, int &outY);
+
+    // Absolute placement (gyro pointer): smooths (x, y) in place
+    void smooth(float &x, float &y, float dt, const OneEuroConfig &f);
+
+    // Rate control (gyro pointer): the smoothed deflection (x, y) moves the
+    // pointer at `countsPerSec` per unit deflection
+    void rate(float x, float y, float countsPerSec, float dt, const PointerTuning &t, int &outX, int &outY);
+
+    // Carry not yet sent, in counts
+    float carryX() const { return carryX_; }
+    float carryY() const { return carryY_; }
+
+private:
+    OneEuroFilter fx_, fy_;
+    bool primed_ = false;
+    float lastX_ = 0, lastY_ = 0;
+    float carryX_ = 0, carryY_ = 0;
+
+    void emit(float dx, float dy, float dt, const AccelCurve &curve, int &outX, int &outY);
+};
+
+#endif // POINTER_H
@@ -0,0 +1,64 @@
+#include "Predictor.h"
+
+void OrientationPredictor::reset()
+{
+    primed_ = false;
+    rate_ = Axis3();
+    accel_ = Axis3();
+    clock_.reset();
+}
+
+void OrientationPredictor::update(const Quaternion &q, const Axis3 &rate, uint32_t sensorUs,
+                                  const PredictionConfig &cfg)
+{
+    uint32_t dtUs = sensorUs - sensorUs_;
+    if (primed_ && dtUs > 0 && dtUs < 100000)
+    {
+        // Finite difference of the rate, smoothed: the raw one is mostly noise
+        float inv = 1.0f / (dtUs * 1e-6f), a = cfg.accelSmoothing;
+        accel_.x += a * ((rate.x - rate_.x) * inv - accel_.x);
+        accel_.y += a * ((rate.y - rate_.y) * inv - accel_.y);
+        accel_.z += a * ((rate.z - rate_.z) * inv - accel_.z);
+    }
+    else
+        accel_ = Axis3();
+    primed_ = true;
+    q_ = q;
+    rate_ = rate;
+    sensorUs_ = sensorUs;
+}
+
+Quaternion OrientationPredictor::predict(float horizonS, const PredictionConfig &cfg) const
+{
+    if (!primed_ || horizonS <= 0)
+        return q_;
+
+    // Body-frame rotation vector over the horizon
+    float h = horizonS, h2 = cfg.useAccel ? 0.5f * horizonS * horizonS : 0.0f;
+    float tx = rate_.x * h + accel_.x * h2;
+    float ty = rate_.y * h + accel_.y * h2;
+    float tz = rate_.z * h + accel_.z * h2;
+    float angle = sqrtf(tx * tx + ty * ty + tz * tz);
+    if (angle < 1e-9f)
+        return q_;
+    float s = sinf(0.5f * angle) / angle;
+    float dw = cosf(0.5f * angle), dx = tx * s, dy = ty * s, dz = tz * s;
+
+    // q * dq (body-frame increment, as the filter integrates)
+    Quaternion p;
+    p.w = q_.w * dw - q_.x * dx - q_.y * dy - q_.z * dz;
+    p.x = q_.w * dx + q_.x * dw + q_.y * dz - q_.z * dy;
+    p.y = q_.w * dy - q_.x * dz + q_.y * dw + q_.z * dx;
+    p.z = q_.w * dz + q_.x * dy - q_.y * dx + q_.z * dw;
+    return p;
+}
+
+float OrientationPredictor::horizonMs(uint32_t stampUs, uint32_t nowUs, uint32_t sensorUs,
+                                      const PredictionConfig &cfg)
+{
+    float ms = cfg.horizonMs;
+    if (ms < 0)
+        ms = cfg.baseMs + (clock_.excess(stampUs, sensorUs) + (nowUs - stampUs)) * 1e-3f;
+    lastHorizonMs_ = ms < cfg.maxHorizonMs ? ms : cfg.maxHorizonMs;
+    return lastHorizonMs_;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <Arduino.h>
+#include "Ahrs.h"
+#include "ArrivalClock.h"
+
+// Latency-compensating orientation prediction: the fused attitude is rotated
+// forward by the body rate (and optionally its change) over the time the
+// sample spent reaching the host, so the gyro pointer lands where the
+// controller is now rather than where it was.
+struct PredictionConfig
+{
+    bool enabled = false;
+    // Horizon in ms; < 0 measures it per packet (see horizonMs())
+    float horizonMs = -1.0f;
+    // Auto: delay of the fastest packet (radio + connection event), which
+    // one side alone cannot observe; about half a 15 ms connection interval
+    float baseMs = 7.5f;
+    float maxHorizonMs = 50.0f;
+    // Second-order term from the rate's change; worth it for smooth motion,
+    // amplifies gyro noise otherwise
+    bool useAccel = false;
+    float accelSmoothing = 0.3f; // EMA weight of each new angular acceleration
+};
+
+class OrientationPredictor
+{
+public:
+    // New link or mode: forget the rate history and the clock offset
+    void reset();
+
+    // Latest fused attitude and body rate (rad/s) at device time sensorUs
+    void update(const Quaternion &q, const Axis3 &rate, uint32_t sensorUs, const PredictionConfig &cfg);
+
+    // Attitude `horizonS` after the last update
+    Quaternion predict(float horizonS, const PredictionConfig &cfg) const;
+
+    // Horizon for the packet received at stampUs, emitted at nowUs: the
+    // configured one, or base + this packet's delay over the fastest one +
+    // time already spent in the pipeline
+    float horizonMs(uint32_t stampUs, uint32_t nowUs, uint32_t sensorUs, const PredictionConfig &cfg);
+
+    const Axis3 &rate() const { return rate_; }
+    const Axis3 &accel() const { return accel_; }
+    float lastHorizonMs() const { return lastHorizonMs_; }
+
+private:
+    Quaternion q_;
+    Axis3 rate_;
+    Axis3 accel_;
+    uint32_t sensorUs_ = 0;
+    bool primed_ = false;
+    float lastHorizonMs_ = 0;
+    ArrivalClock clock_;
+};
+
+#endif // PREDICTOR_H
@@ -0,0 +1,116 @@
+#include "ScanScheduler.h"
+
+namespace
+{
+    // Grace period before a window the stack never reported as ended is
+    // considered over anyway
+    constexpr uint32_t kEndGraceMs = 1000;
+}
+
+void ScanScheduler::begin(uint32_t now, bool burst)
+{
+    if (!active())
+        sessionStart_ = now;
+    phase_ = burst ? ScanPhase::Burst : ScanPhase::Window;
+    backoffMs_ = config.backoffMinMs;
+    // a running window is replaced by the new phase on the next poll
+    scanning_ = false;
+}
+
+void ScanScheduler::onMatch(uint32_t now)
+{
+    if (!active())
+        return;
+    uint32_t latency = now - sessionStart_;
+    stats_.lastLatencyMs = latency;
+    stats_.sumLatencyMs += latency;
+    if (stats_.matches == 0 || latency < stats_.minLatencyMs)
+        stats_.minLatencyMs = latency;
+    if (latency > stats_.maxLatencyMs)
+        stats_.maxLatencyMs = latency;
+    stats_.matches++;
+    phase_ = ScanPhase::Off;
+    scanning_ = false;
+}
+
+void ScanScheduler::onScanEnd(uint32_t now)
+{
+    scanning_ = false;
+    if (phase_ != ScanPhase::Burst && phase_ != ScanPhase::Window)
+        return;
+    // Nothing matched: radio off for a while, doubling up to the cap
+    phase_ = ScanPhase::Backoff;
+    backoffUntil_ = now + backoffMs_;
+    backoffMs_ = min(backoffMs_ * 2, config.backoffMaxMs);
+}
+
+void ScanScheduler::cancel()
+{
+    phase_ = ScanPhase::Off;
+    scanning_ = false;
+}
+
+ScanScheduler::Action ScanScheduler::poll(uint32_t now, Params &params)
+{
+    if (!active())
+        return Action::None;
+
+    if (now - sessionStart_ >= config.timeoutMs)
+    {
+        phase_ = ScanPhase::TimedOut;
+        stats_.timeouts++;
+        bool wasScanning = scanning_;
+        scanning_ = false;
+        return wasScanning ? Action::Stop : Action::None;
+    }
+
+    if (scanning_)
+    {
+        if (now - scanStart_ < scanDuration_ + kEndGraceMs)
+            return Action::None;
+        // Window overran: the end callback got lost, close it ourselves
+        onScanEnd(now);
+        if (phase_ == ScanPhase::Backoff)
+            return Action::Stop;
+    }
+
+    if (phase_ == ScanPhase::Backoff)
+    {
+        if ((int32_t)(now - backoffUntil_) < 0)
+            return Action::None;
+        phase_ = ScanPhase::Window;
+    }
+
+    bool burst = phase_ == ScanPhase::Burst;
+    params.durationMs = burst ? config.burstMs : config.windowMs;
+    params.interval = burst ? config.burstInterval : config.interval;
+    params.window = burst ? config.burstWindow : config.window;
+    scanning_ = true;
+    scanStart_ = now;
+    scanDuration_ = params.durationMs;
+    stats_.windows++;
+    return Action::Start;
+}
+
+uint32_t ScanScheduler::msUntilNext(uint32_t now) const
+{
+    if (!active())
+        return UINT32_MAX;
+    uint32_t untilTimeout = config.timeoutMs - min(now - sessionStart_, config.timeoutMs);
+    uint32_t next = untilTimeout;
+    if (scanning_)
+    {
+        uint32_t end = scanDuration_ + kEndGraceMs;
+        next = min(next, end - min(now - scanStart_, end));
+    }
+    else if (phase_ == ScanPhase::Backoff)
+    {
+        int32_t wait = (int32_t)(backoffUntil_ - now);
+        next = min(next, wait > 0 ? (uint32_t)wait : 0u);
+    }
+    else
+    {
+        next = 0;
+    }
+    return next;
+}
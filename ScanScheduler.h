@@ -0,0 +1,97 @@
+#pragma once
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Decides when BLEManager scans and with which radio duty cycle. Pure logic:
+// time comes in as millis(), the manager performs the returned action.
+//
+//   Burst   -> aggressive continuous scan right after a disconnect
+//   Window  -> one duty-cycled scan window
+//   Backoff -> radio off, exponentially growing pause after an empty window
+//   TimedOut-> hard stop once the session exceeds timeoutMs (rescan() to retry)
+enum class ScanPhase : uint8_t
+{
+    Off,
+    Burst,
+    Window,
+    Backoff,
+    TimedOut,
+};
+
+struct ScanConfig
+{
+    uint32_t burstMs = 10000;
+    uint16_t burstInterval = 96; // 0.625 ms units: 60 ms interval,
+    uint16_t burstWindow = 96;   // 60 ms window (100% duty)
+    uint32_t windowMs = 5000;
+    uint16_t interval = 1349; // ~843 ms interval,
+    uint16_t window = 449;    // ~281 ms window (33% duty)
+    uint32_t backoffMinMs = 1000;
+    uint32_t backoffMaxMs = 30000;
+    uint32_t timeoutMs = 300000; // 5 minutes
+};
+
+struct ScanStats
+{
+    uint32_t windows = 0;      // scan windows started
+    uint32_t matches = 0;      // sessions that ended in a match
+    uint32_t lastLatencyMs = 0; // session start -> match
+    uint32_t minLatencyMs = 0;
+    uint32_t maxLatencyMs = 0;
+    uint32_t sumLatencyMs = 0;
+    uint32_t timeouts = 0;
+
+    uint32_t avgLatencyMs() const { return matches ? sumLatencyMs / matches : 0; }
+};
+
+class ScanScheduler
+{
+public:
+    enum class Action : uint8_t
+    {
+        None,
+        Start, // start a scan with the returned parameters
+        Stop,  // stop the running scan
+    };
+
+    struct Params
+    {
+        uint32_t durationMs;
+        uint16_t interval;
+        uint16_t window;
+    };
+
+    ScanConfig config;
+
+    // Open a scan session (burst = disconnect recovery)
+    void begin(uint32_t now, bool burst);
+    // Match found at `now`: close the session and record latency
+    void onMatch(uint32_t now);
+    // The stack finished a scan window without a match
+    void onScanEnd(uint32_t now);
+    // Connected or shutting down: no more scanning
+    void cancel();
+
+    // What to do now; fills `params` for Action::Start
+    Action poll(uint32_t now, Params &params);
+    // Milliseconds until poll() may have something to do (UINT32_MAX = never)
+    uint32_t msUntilNext(uint32_t now) const;
+
+    ScanPhase phase() const { return phase_; }
+    bool active() const { return phase_ == ScanPhase::Burst || phase_ == ScanPhase::Window || phase_ == ScanPhase::Backoff; }
+    const ScanStats &stats() const { return stats_; }
+
+private:
+    ScanPhase phase_ = ScanPhase::Off;
+    bool scanning_ = false;
+    uint32_t sessionStart_ = 0;
+    uint32_t scanStart_ = 0;
+    uint32_t scanDuration_ = 0;
+    uint32_t backoffUntil_ = 0;
+    uint32_t backoffMs_ = 0;
+    ScanStats stats_;
+};
+
+#endif // SCAN_SCHEDULER_H
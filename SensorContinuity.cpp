@@ -0,0 +1,69 @@
+#include "SensorContinuity.h"
+
+void SensorContinuity::clear()
+{
+    primed_ = false;
+    stepUs_ = kNominalStepUs;
+    stats_ = ContinuityStats();
+}
+
+FrameCheck SensorContinuity::check(const uint32_t time[3])
+{
+    FrameCheck c;
+    if (!primed_)
+    {
+        primed_ = true;
+        last_ = time[2];
+        stats_.packets++;
+        c.stepUs = stepUs_;
+        return c;
+    }
+
+    // Not newer than what we have: a repeat (or a stale frame), drop it
+    int32_t progress = (int32_t)(time[2] - last_);
+    if (progress <= 0 && progress > -(int32_t)kMaxLossUs)
+    {
+        stats_.duplicates++;
+        c.order = FrameOrder::Duplicate;
+        c.stepUs = stepUs_;
+        return c;
+    }
+
+    // Track the device's subsample step from inside the packet
+    uint32_t span = time[2] - time[0];
+    if (span >= kNominalStepUs && span <= 4 * kNominalStepUs) // step within 1/2..2x nominal
+        stepUs_ += ((int32_t)(span / 2) - (int32_t)stepUs_) / 8;
+    c.stepUs = stepUs_;
+
+    uint32_t gap = time[0] - last_;
+    last_ = time[2];
+    stats_.packets++;
+    if ((int32_t)gap <= 0 && progress > 0)
+    {
+        c.order = FrameOrder::InOrder; // overlapping stamps: nothing lost
+        return c;
+    }
+    // Steps between the two packets, rounded: 1 when nothing is missing
+    uint32_t steps = (gap + stepUs_ / 2) / stepUs_;
+    if (progress < 0 || gap > kMaxBridgeUs)
+    {
+        if (progress > 0 && gap <= kMaxLossUs && steps > 1)
+            stats_.lost += steps / 3;
+        stats_.resyncs++;
+        c.order = FrameOrder::Resync;
+        return c;
+    }
+    if (steps <= 1)
+    {
+        c.order = FrameOrder::InOrder;
+        return c;
+    }
+    c.order = FrameOrder::Gap;
+    c.missing = (uint16_t)(steps - 1);
+    c.gapUs = gap;
+    stats_.gaps++;
+    stats_.lost += steps / 3; // 3 subsamples per packet, rounded
+    if (gap > stats_.maxGapUs)
+        stats_.maxGapUs = gap;
+    return c;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef SENSOR_CONTINUITY_H
+#define SENSOR_CONTINUITY_H
+
+#include <Arduino.h>
+
+// Packet continuity from the controller's own clock. Each packet carries
+// three IMU subsamples one step (~4.75 ms) apart and stamped with
+// sensor_time, so consecutive packets are one step apart end to start:
+// a lost notification shows up as a gap of 3k + 1 steps, a repeated one as
+// no progress at all. Pure logic, one instance per handler.
+struct ContinuityStats
+{
+    uint32_t packets = 0;     // accepted (in order, after a gap or a resync)
+    uint32_t lost = 0;        // packets missing, estimated from gap lengths
+    uint32_t gaps = 0;        // loss events short enough to bridge
+    uint32_t duplicates = 0;  // repeated or stale packets, dropped
+    uint32_t resyncs = 0;     // gaps too long to bridge, clock jumps
+    uint32_t maxGapUs = 0;    // longest bridged gap
+};
+
+enum class FrameOrder : uint8_t
+{
+    First,     // first packet since reset(): nothing to compare against
+    InOrder,   // one step after the previous packet
+    Gap,       // `missing` subsamples lost, short enough to bridge
+    Duplicate, // not newer than the previous packet
+    Resync,    // gap too long (or clock jumped): start over from here
+};
+
+struct FrameCheck
+{
+    FrameOrder order = FrameOrder::First;
+    uint16_t missing = 0; // Gap: subsamples lost between the two packets
+    uint32_t gapUs = 0;   // Gap: previous packet's last subsample -> this one's first
+    uint32_t stepUs = 0;  // current subsample step estimate
+};
+
+class SensorContinuity
+{
+public:
+    static constexpr uint32_t kNominalStepUs = 4750;
+    static constexpr uint32_t kMaxBridgeUs = 100000; // ~6 packets
+    static constexpr uint32_t kMaxLossUs = 2000000;  // beyond: unknown, not counted as loss
+
+    // New connection: the device clock may have restarted
+    void reset() { primed_ = false; }
+    // Stats restart too (per connection)
+    void clear();
+
+    // Classify a packet by its three subsample stamps
+    FrameCheck check(const uint32_t time[3]);
+
+    const ContinuityStats &stats() const { return stats_; }
+    uint32_t stepUs() const { return stepUs_; }
+
+private:
+    bool primed_ = false;
+    uint32_t last_ = 0; // last subsample stamp of the newest packet
+    uint32_t stepUs_ = kNominalStepUs;
+    ContinuityStats stats_;
+};
+
+#endif // SENSOR_CONTINUITY_H
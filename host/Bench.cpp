@@ -0,0 +1,42 @@
+#include "Bench.h"
+#include <atomic>
+#include <new>
+
+// Count every heap allocation so benches can prove a path allocation-free
+namespace
+{
+    std::atomic<uint64_t> gAllocs(0);
+}
+
+void *operator new(size_t n)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// operator new above is malloc-backed, so free() is the matching release
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+uint64_t benchAllocs() { return gAllocs.load(std::memory_order_relaxed); }
+
+void BenchStats::report(const char *label, const char *unit)
+{
+    if (v_.empty())
+    {
+        printf("%-28s (no samples)\n", label);
+        return;
+    }
+    std::vector<uint32_t> s = v_;
+    std::sort(s.begin(), s.end());
+    double sum = 0;
+    for (uint32_t x : s)
+        sum += x;
+    printf("%-28s n=%-8zu mean=%-9.1f p50=%-8u p99=%-8u max=%-8u %s\n", label, s.size(),
+           sum / s.size(), s[s.size() / 2], s[(s.size() * 99) / 100], s.back(), unit);
+}
@@ -0,0 +1,83 @@
+#pragma once
+// Small helpers shared by the host benchmarks.
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+
+class BenchStats
+{
+public:
+    void reserve(size_t n) { v_.reserve(n); }
+    void add(uint32_t sample) { v_.push_back(sample); }
+    size_t count() const { return v_.size(); }
+    // Prints count, mean, p50, p99 and max of the collected samples
+    void report(const char *label, const char *unit);
+
+private:
+    std::vector<uint32_t> v_;
+};
+
+inline uint64_t benchNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Print into memory (capture files in the replay benches)
+class MemorySink : public Print
+{
+public:
+    std::vector<uint8_t> bytes;
+    size_t write(uint8_t c) override
+    {
+        bytes.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        bytes.insert(bytes.end(), buf, buf + len);
+        return len;
+    }
+};
+
+// Read back from memory
+class MemoryStream : public Stream
+{
+public:
+    explicit MemoryStream(const std::vector<uint8_t> &b) : b_(b) {}
+    int available() override { return (int)(b_.size() - at_); }
+    int read() override { return at_ < b_.size() ? b_[at_++] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    const std::vector<uint8_t> &b_;
+    size_t at_ = 0;
+};
+
+// Heap allocations (global operator new) since start
+uint64_t benchAllocs();
+
+// Benchmark entry points (one per host/bench_*.cpp)
+int benchPipeline(int argc, char **argv);
+int benchAhrs(int argc, char **argv);
+int benchGyroBias(int argc, char **argv);
+int benchScan(int argc, char **argv);
+int benchReconnect(int argc, char **argv);
+int benchAdvFlood(int argc, char **argv);
+int benchCmdQueue(int argc, char **argv);
+int benchHandshake(int argc, char **argv);
+int benchWake(int argc, char **argv);
+int benchHidOut(int argc, char **argv);
+int benchPointer(int argc, char **argv);
+int benchLatency(int argc, char **argv);
+int benchLog(int argc, char **argv);
+int benchReplay(int argc, char **argv);
+int benchLinkLoss(int argc, char **argv);
+int benchPredict(int argc, char **argv);
+int benchMulti(int argc, char **argv);
+int benchRegistry(int argc, char **argv);
+int benchLayout(int argc, char **argv);
+int benchBindings(int argc, char **argv);
+int benchMacro(int argc, char **argv);
+int benchConnect(int argc, char **argv);
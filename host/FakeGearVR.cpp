@@ -0,0 +1,205 @@
+#include "FakeGearVR.h"
+
+namespace
+{
+    const float kAccLsb = 2048.0f / 9.80665f;           // LSB per m/s²
+    const float kGyrLsb = 14.285f / 0.017453292519943f; // LSB per rad/s
+    const float kMagLsb = 1.0f / 0.06f;                  // LSB per µT
+    const float kGravity[3] = {0.0f, 0.0f, 9.80665f};
+
+    int16_t sat16(float v)
+    {
+        if (v > 32767.0f)
+            return 32767;
+        if (v < -32768.0f)
+            return -32768;
+        return (int16_t)lrintf(v);
+    }
+
+    void putLe16(uint8_t *p, int16_t v)
+    {
+        p[0] = (uint8_t)(v & 0xFF);
+        p[1] = (uint8_t)((uint16_t)v >> 8);
+    }
+
+    void putBe16(uint8_t *p, int16_t v)
+    {
+        p[0] = (uint8_t)((uint16_t)v >> 8);
+        p[1] = (uint8_t)(v & 0xFF);
+    }
+}
+
+FakeGearVR::FakeGearVR()
+{
+    BLERemoteService *svc = client_.addService(BLEUUID("4f63756c-7573-2054-6872-65656d6f7465"));
+    write_ = svc->addCharacteristic(BLEUUID("c8c51726-81bc-483b-a052-f7a14ea3d282"), true, false);
+    notify_ = svc->addCharacteristic(BLEUUID("c8c51726-81bc-483b-a052-f7a14ea3d281"), false, true);
+    notify_->addDescriptor(BLEUUID("00002902-0000-1000-8000-00805f9b34fb"));
+    client_.connect(BLEAddress());
+}
+
+void FakeGearVR::integrate(float dt)
+{
+    const float gx = motion.gyro[0], gy = motion.gyro[1], gz = motion.gyro[2];
+    float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    float hw = 0.5f * (-x * gx - y * gy - z * gz);
+    float hx = 0.5f * (w * gx + y * gz - z * gy);
+    float hy = 0.5f * (w * gy - x * gz + z * gx);
+    float hz = 0.5f * (w * gz + x * gy - y * gx);
+    w += hw * dt;
+    x += hx * dt;
+    y += hy * dt;
+    z += hz * dt;
+    float n = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+    q_[0] = w * n;
+    q_[1] = x * n;
+    q_[2] = y * n;
+    q_[3] = z * n;
+}
+
+float FakeGearVR::noise(float amplitude)
+{
+    if (amplitude <= 0)
+        return 0;
+    rng_ = rng_ * 1664525u + 1013904223u; // deterministic LCG
+    return amplitude * ((rng_ >> 8) * (2.0f / 16777216.0f) - 1.0f);
+}
+
+void FakeGearVR::toBody(const float v[3], float out[3]) const
+{
+    // out = R(q)^T v
+    const float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    out[0] = (1 - 2 * (y * y + z * z)) * v[0] + 2 * (x * y + w * z) * v[1] + 2 * (x * z - w * y) * v[2];
+    out[1] = 2 * (x * y - w * z) * v[0] + (1 - 2 * (x * x + z * z)) * v[1] + 2 * (y * z + w * x) * v[2];
+    out[2] = 2 * (x * z + w * y) * v[0] + 2 * (y * z - w * x) * v[1] + (1 - 2 * (x * x + y * y)) * v[2];
+}
+
+void FakeGearVR::truthEuler(float &roll, float &pitch, float &yaw) const
+{
+    const float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    roll = atan2f(w * x + y * z, 0.5f - x * x - y * y);
+    float s = 2.0f * (w * y - x * z);
+    pitch = asinf(s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s));
+    yaw = atan2f(w * z + x * y, 0.5f - y * y - z * z);
+}
+
+void FakeGearVR::makePacket(uint8_t out[60])
+{
+    memset(out, 0, 60);
+    for (int t = 0; t < 3; t++)
+    {
+        integrate(subsampleUs * 1e-6f);
+        float accel[3];
+        toBody(kGravity, accel);
+
+        uint8_t *b = out + t * 16;
+        b[0] = (uint8_t)(sensorTime_);
+        b[1] = (uint8_t)(sensorTime_ >> 8);
+        b[2] = (uint8_t)(sensorTime_ >> 16);
+        b[3] = (uint8_t)(sensorTime_ >> 24);
+        for (int a = 0; a < 3; a++)
+        {
+            putLe16(b + 4 + a * 2, sat16((accel[a] + motion.linearAccel[a]) * kAccLsb + noise(motion.accelNoise)));
+            putLe16(b + 10 + a * 2, sat16((motion.gyro[a] + motion.gyroBias[a]) * kGyrLsb + noise(motion.gyroNoise)));
+        }
+        sensorTime_ += subsampleUs;
+    }
+    float mag[3];
+    toBody(earthField, mag);
+    for (int a = 0; a < 3; a++)
+        putBe16(out + 48 + a * 2, sat16(mag[a] * kMagLsb));
+
+    uint16_t x = motion.touchX & 0x3FF, y = motion.touchY & 0x3FF;
+    out[54] = (uint8_t)((x >> 6) & 0x0F);
+    out[55] = (uint8_t)(((x & 0x3F) << 2) | ((y >> 8) & 0x03));
+    out[56] = (uint8_t)(y & 0xFF);
+    out[57] = 0x20;
+    out[58] = motion.buttons;
+    out[59] = motion.battery;
+}
+
+void FakeGearVR::sendPacket()
+{
+    uint8_t frame[60];
+    makePacket(frame);
+    notify_->notify(frame, sizeof(frame));
+}
+
+void FakeGearVR::sendRequest(uint8_t cmd)
+{
+    uint8_t frame[4] = {cmd, 0x00, 0x00, 0x00};
+    notify_->notify(frame, sizeof(frame));
+}
+
+void FakeGearVR::enableProtocol()
+{
+    write_->onWrite([this](const uint8_t *data, size_t len, bool) { onCommand(data, len); });
+}
+
+void FakeGearVR::onCommand(const uint8_t *data, size_t len)
+{
+    if (len < 1)
+        return;
+    commands_[data[0] & 0x0F]++;
+    if (protocol.dropWrites && (protocol.dropOnly < 0 || protocol.dropOnly == data[0]))
+    {
+        protocol.dropWrites--;
+        return;
+    }
+    if (protocol.silent)
+        return;
+
+    const uint32_t now = millis();
+    switch (data[0])
+    {
+    case 0x00: // Off
+        streaming_ = false;
+        vrMode_ = false;
+        break;
+    case 0x01: // Sensor
+        if (vrMode_ || !protocol.needsVr)
+        {
+            if (!streaming_)
+            {
+                streamPending_ = true;
+                streamAt_ = now + protocol.replyMs;
+            }
+        }
+        else
+        {
+            replyPending_ = true;
+            reply_ = 0x06; // LPM Enable request
+            replyAt_ = now + protocol.replyMs;
+        }
+        break;
+    case 0x08: // VR
+        vrMode_ = true;
+        replyPending_ = true;
+        reply_ = 0x08; // VR Mode request
+        replyAt_ = now + protocol.replyMs;
+        break;
+    default:
+        break;
+    }
+}
+
+void FakeGearVR::poll()
+{
+    const uint32_t now = millis();
+    if (replyPending_ && (int32_t)(now - replyAt_) >= 0)
+    {
+        replyPending_ = false;
+        sendRequest(reply_);
+    }
+    if (streamPending_ && (int32_t)(now - streamAt_) >= 0)
+    {
+        streamPending_ = false;
+        streaming_ = true;
+        nextPacket_ = now;
+    }
+    if (streaming_ && (int32_t)(now - nextPacket_) >= 0)
+    {
+        sendPacket();
+        nextPacket_ += protocol.packetMs;
+    }
+}
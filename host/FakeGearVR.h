@@ -0,0 +1,92 @@
+#pragma once
+// Host-side fake Gear VR controller: owns a BLEClient exposing the controller's
+// GATT layout and synthesises 60-byte notification frames.
+#include <Arduino.h>
+#include "BLEDevice.h"
+
+class FakeGearVR
+{
+public:
+    // Synthetic motion/input driving the next frames. The fake integrates its
+    // own true attitude from `gyro`; accel and magno frames are gravity and a
+    // fixed Earth field rotated into the body frame, plus `linearAccel`.
+    struct Motion
+    {
+        float gyro[3] = {0, 0, 0};        // rad/s, body frame
+        float gyroBias[3] = {0, 0, 0};    // rad/s, added to reported gyro only
+        float gyroNoise = 0;              // LSB, uniform +/- on reported gyro
+        float accelNoise = 0;             // LSB, uniform +/- on reported accel
+        float linearAccel[3] = {0, 0, 0}; // m/s², body frame
+        uint16_t touchX = 0, touchY = 0;  // 0 = no contact
+        uint8_t buttons = 0;               // byte 58 bitmask
+        uint8_t battery = 90;
+    };
+
+    FakeGearVR();
+
+    BLEClient *client() { return &client_; }
+    BLERemoteCharacteristic *notifyChar() { return notify_; }
+    BLERemoteCharacteristic *writeChar() { return write_; }
+
+    Motion motion;
+    uint32_t subsampleUs = 4750; // device sensor_time step per IMU subsample
+    float earthField[3] = {20.0f, 0.0f, -40.0f}; // µT, world frame
+
+    // True attitude (body -> world), w x y z
+    const float *truth() const { return q_; }
+    // True yaw/pitch/roll (rad), ZYX
+    void truthEuler(float &roll, float &pitch, float &yaw) const;
+
+    // Encode the next frame from `motion` and advance sensor_time
+    void makePacket(uint8_t out[60]);
+    // makePacket() + deliver through the notify characteristic
+    void sendPacket();
+    // Deliver a short command-request frame
+    void sendRequest(uint8_t cmd);
+
+    // Controller-side command protocol, as observed on hardware: Sensor
+    // outside VR mode is answered with the LPM Enable request, VR with the
+    // VR Mode request, Sensor in VR mode starts the 60-byte stream.
+    struct Protocol
+    {
+        bool needsVr = true;     // false: streams straight after Sensor
+        uint32_t replyMs = 20;   // command -> request frame / first packet
+        uint32_t packetMs = 15;  // stream frame spacing
+        uint32_t dropWrites = 0; // next N commands are lost on air,
+        int dropOnly = -1;       // or only the next N of this command
+        bool silent = false;     // accepts writes, never answers
+    };
+    Protocol protocol;
+    // Route write-characteristic writes into the protocol model
+    void enableProtocol();
+    // Deliver request frames and stream packets due at millis()
+    void poll();
+    // Controller stops streaming (until the next Sensor command)
+    void stopStream() { streaming_ = false; }
+    bool streaming() const { return streaming_; }
+    uint32_t commands(uint8_t cmd) const { return cmd < 16 ? commands_[cmd] : 0; }
+
+private:
+    BLEClient client_;
+    BLERemoteCharacteristic *write_ = nullptr;
+    BLERemoteCharacteristic *notify_ = nullptr;
+    uint32_t sensorTime_ = 6516700;
+    float q_[4] = {1, 0, 0, 0};
+    uint32_t rng_ = 0x12345678;
+
+    bool vrMode_ = false;
+    bool streaming_ = false;
+    bool replyPending_ = false;
+    uint8_t reply_ = 0;
+    uint32_t replyAt_ = 0;
+    bool streamPending_ = false;
+    uint32_t streamAt_ = 0;
+    uint32_t nextPacket_ = 0;
+    uint32_t commands_[16] = {};
+
+    float noise(float amplitude);
+    void onCommand(const uint8_t *data, size_t len);
+
+    void integrate(float dt);
+    void toBody(const float world[3], float body[3]) const;
+};
@@ -0,0 +1,144 @@
+// Advertisement flood: per-advertisement cost of handler matching on a
+// crowded-office mix, the old per-handler matchesAdvertisement() (String per
+// call) against the AdvIndex pass over the raw payload.
+#include "Bench.h"
+#include "AdvFilter.h"
+#include "GearVR.h"
+
+namespace
+{
+    void addAd(std::vector<uint8_t> &p, uint8_t type, const void *data, size_t len)
+    {
+        p.push_back((uint8_t)(len + 1));
+        p.push_back(type);
+        const uint8_t *d = (const uint8_t *)data;
+        p.insert(p.end(), d, d + len);
+    }
+
+    // Deterministic traffic mix; every 100th advertisement is the controller
+    BLEAdvertisedDevice makeAdvert(int i)
+    {
+        static const char *kNames[] = {"LE-Bose QC35 II", "Mi Smart Band 4", "[TV] Samsung 7 Series",
+                                       "Jabra Elite 75t", "Gear VR Cam", "HP LaserJet M404"};
+        const uint8_t flags = 0x06;
+        std::vector<uint8_t> p;
+        addAd(p, 0x01, &flags, 1);
+        switch (i % 7)
+        {
+        case 0: // iBeacon
+        {
+            uint8_t m[25] = {0x4C, 0x00, 0x02, 0x15};
+            for (int k = 4; k < 25; k++)
+                m[k] = (uint8_t)(i * 7 + k);
+            addAd(p, 0xFF, m, sizeof(m));
+            break;
+        }
+        case 1: // Apple continuity, no name
+        {
+            uint8_t m[10] = {0x4C, 0x00, 0x10, 0x05, 0x01, 0x18, (uint8_t)i};
+            addAd(p, 0xFF, m, sizeof(m));
+            break;
+        }
+        case 2: // Eddystone
+        {
+            uint8_t u[2] = {0xAA, 0xFE};
+            uint8_t sd[14] = {0xAA, 0xFE, 0x10, 0x00, 0x03};
+            addAd(p, 0x03, u, 2);
+            addAd(p, 0x16, sd, sizeof(sd));
+            break;
+        }
+        case 3: // Microsoft Swift Pair
+        {
+            uint8_t m[8] = {0x06, 0x00, 0x03, 0x00, 0x80};
+            addAd(p, 0xFF, m, sizeof(m));
+            break;
+        }
+        default: // named gadgets, some with a HID service
+        {
+            const char *name = kNames[(i / 7) % 6];
+            addAd(p, 0x09, name, strlen(name));
+            if (i % 3 == 0)
+            {
+                uint8_t u[2] = {0x12, 0x18};
+                addAd(p, 0x03, u, 2);
+            }
+            break;
+        }
+        }
+        if (i % 100 == 99)
+        {
+            p.resize(3);
+            const char *name = "Gear VR Controller(1A2B)";
+            addAd(p, 0x09, name, strlen(name));
+        }
+        BLEAdvertisedDevice adv;
+        adv.setPayload(p.data(), p.size());
+        return adv;
+    }
+}
+
+int benchAdvFlood(int argc, char **argv)
+{
+    int adverts = argc > 0 ? atoi(argv[0]) : 200000;
+    if (adverts <= 0)
+        adverts = 200000;
+
+    std::vector<BLEAdvertisedDevice> traffic;
+    traffic.reserve(adverts);
+    for (int i = 0; i < adverts; i++)
+        traffic.push_back(makeAdvert(i));
+
+    printf("== advertisement flood (%d adverts, 1%% controller) ==\n", adverts);
+    for (size_t handlers : {(size_t)1, (size_t)4})
+    {
+        // kMaxHandlers controllers registered, as the manager would see them
+        GearVR gears[4];
+        AdvIndex index;
+        for (size_t h = 0; h < handlers; h++)
+        {
+            AdvCriteria c;
+            gears[h].advertisementCriteria(c);
+            index.add((uint8_t)h, c);
+        }
+
+        BenchStats legacy, indexed;
+        legacy.reserve(adverts);
+        indexed.reserve(adverts);
+        uint32_t legacyHits = 0, indexHits = 0, disagree = 0;
+        uint64_t allocs = benchAllocs();
+        for (BLEAdvertisedDevice &adv : traffic)
+        {
+            uint32_t t0 = ESP.getCycleCount();
+            int hit = -1;
+            for (size_t h = 0; h < handlers && hit < 0; h++)
+                if (gears[h].matchesAdvertisement(adv))
+                    hit = (int)h;
+            legacy.add(ESP.getCycleCount() - t0);
+            legacyHits += hit >= 0;
+
+            uint8_t slot = index.match(adv.getPayload(), adv.getPayloadLength());
+            disagree += (slot == AdvIndex::kNoMatch ? -1 : (int)slot) != hit;
+        }
+        uint64_t legacyAllocs = benchAllocs() - allocs;
+
+        allocs = benchAllocs();
+        for (BLEAdvertisedDevice &adv : traffic)
+        {
+            uint32_t t0 = ESP.getCycleCount();
+            uint8_t slot = index.match(adv.getPayload(), adv.getPayloadLength());
+            indexed.add(ESP.getCycleCount() - t0);
+            indexHits += slot != AdvIndex::kNoMatch;
+        }
+        uint64_t indexAllocs = benchAllocs() - allocs;
+
+        char label[48];
+        printf("-- %zu handler(s)\n", handlers);
+        snprintf(label, sizeof(label), "matchesAdvertisement x%zu", handlers);
+        legacy.report(label, "cycles");
+        indexed.report("AdvIndex::match", "cycles");
+        printf("matches: legacy=%u index=%u disagreements=%u; heap allocations: legacy=%llu index=%llu\n",
+               legacyHits, indexHits, disagree, (unsigned long long)legacyAllocs,
+               (unsigned long long)indexAllocs);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Cycle cost of one Ahrs::update per filter/sensor combination, and yaw drift
+// of a still controller with a biased gyro (IMU-only vs. magnetometer fusion).
+#include "Ahrs.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    struct Variant
+    {
+        const char *name;
+        AhrsFilter filter;
+        bool useMag;
+    };
+
+    const Variant kVariants[] = {
+        {"madgwick imu", AhrsFilter::Madgwick, false},
+        {"madgwick marg", AhrsFilter::Madgwick, true},
+        {"mahony imu", AhrsFilter::Mahony, false},
+        {"mahony marg", AhrsFilter::Mahony, true},
+    };
+
+    // Decode one subsample of a fake frame into SI axes
+    void decode(const uint8_t *p, int t, Axis3 &gyro, Axis3 &accel, Axis3 &mag)
+    {
+        const uint8_t *b = p + t * 16;
+        accel.x = (int16_t)(b[4] | (b[5] << 8)) * ACC_SCALE;
+        accel.y = (int16_t)(b[6] | (b[7] << 8)) * ACC_SCALE;
+        accel.z = (int16_t)(b[8] | (b[9] << 8)) * ACC_SCALE;
+        gyro.x = (int16_t)(b[10] | (b[11] << 8)) * GYR_SCALE;
+        gyro.y = (int16_t)(b[12] | (b[13] << 8)) * GYR_SCALE;
+        gyro.z = (int16_t)(b[14] | (b[15] << 8)) * GYR_SCALE;
+        mag.x = (int16_t)((p[48] << 8) | p[49]) * 0.06f;
+        mag.y = (int16_t)((p[50] << 8) | p[51]) * 0.06f;
+        mag.z = (int16_t)((p[52] << 8) | p[53]) * 0.06f;
+    }
+}
+
+int benchAhrs(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 100000;
+    if (packets <= 0)
+        packets = 100000;
+    const float dt = 4750e-6f;
+
+    // Pre-generate frames so only the filter is timed
+    FakeGearVR dev;
+    std::vector<uint8_t> frames((size_t)packets * 60);
+    for (int i = 0; i < packets; i++)
+    {
+        dev.motion.gyro[0] = 0.4f * sinf(i * 0.013f);
+        dev.motion.gyro[1] = 0.9f * sinf(i * 0.021f);
+        dev.motion.gyro[2] = 1.5f * sinf(i * 0.017f);
+        dev.makePacket(&frames[(size_t)i * 60]);
+    }
+
+    printf("== ahrs: %d packets x 3 subsamples ==\n", packets);
+    for (const Variant &v : kVariants)
+    {
+        Ahrs ahrs;
+        ahrs.config.filter = v.filter;
+        ahrs.config.useMag = v.useMag;
+        BenchStats cycles;
+        cycles.reserve((size_t)packets * 3);
+        for (int i = 0; i < packets; i++)
+            for (int t = 0; t < 3; t++)
+            {
+                Axis3 g, a, m;
+                decode(&frames[(size_t)i * 60], t, g, a, m);
+                uint32_t c0 = ESP.getCycleCount();
+                ahrs.update(g, a, m, dt);
+                uint32_t c1 = ESP.getCycleCount();
+                cycles.add(c1 - c0);
+            }
+        cycles.report(v.name, "cycles/update");
+    }
+
+    // Still controller, 0.01 rad/s gyro bias on yaw, 5 simulated minutes
+    printf("-- yaw drift after 300 s, still, 0.01 rad/s gyro z bias --\n");
+    const int still = (int)(300.0f / (3 * dt));
+    for (const Variant &v : kVariants)
+    {
+        FakeGearVR rest;
+        rest.motion.gyroBias[2] = 0.01f;
+        Ahrs ahrs;
+        ahrs.config.filter = v.filter;
+        ahrs.config.useMag = v.useMag;
+        uint8_t frame[60];
+        for (int i = 0; i < still; i++)
+        {
+            rest.makePacket(frame);
+            for (int t = 0; t < 3; t++)
+            {
+                Axis3 g, a, m;
+                decode(frame, t, g, a, m);
+                ahrs.update(g, a, m, dt);
+            }
+        }
+        Orientation o;
+        ahrs.toEuler(o);
+        printf("%-28s yaw error %.3f rad\n", v.name, o.yaw);
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Input -> HID mapping: the binding table (InputBindings, edges by XOR, only
+// set edge bits looked up) against the per-button if cascade it replaced.
+//  - equivalence: a random button / pad-click script through both, HID
+//    reports on the wire compared one by one. Not their timestamps: the
+//    cascade's Alt+Tab slept 10 ms inside the mapping (moving the clock on),
+//    the table's runs as a macro (see the macro bench)
+//  - cost of the mapping stage per packet, quiet packets (no edge) and all,
+//    with 1 to 16 bindings in the table
+//
+//   universal_host bindings [packets]   (default 200000)
+#include "Bench.h"
+#include "GearVR.h"
+#include "HID.h"
+#include "HidOutput.h"
+#include "USBHID.h"
+#include "USBHIDMouse.h"
+
+namespace
+{
+    constexpr uint32_t kPacketUs = 15000;
+
+    // The emitUSB button section before the binding table
+    struct Cascade
+    {
+        bool usePad = true;
+        uint32_t toggles = 0;
+
+        void map(const JoySample &now, const JoySample &prev, uint8_t slot)
+        {
+            const uint8_t pressed = now.buttons & ~prev.buttons;
+            const uint8_t released = prev.buttons & ~now.buttons;
+
+            if (pressed & kBtnTrigger)
+                HidOut.press(MOUSE_LEFT, slot);
+            if (released & kBtnTrigger)
+                HidOut.release(MOUSE_LEFT, slot);
+
+            if ((pressed & kBtnTouch) && !now.pressed(kBtnTrigger))
+            {
+                int dx = now.touchpad.x - 160;
+                int dy = now.touchpad.y - 160;
+                if (abs(dx) < 60 && abs(dy) < 60)
+                {
+                    usePad = !usePad;
+                    toggles++;
+                }
+                else if (abs(dx) > abs(dy))
+                    HidOut.consumerPress(dx > 0 ? MEDIA_FORWARD : MEDIA_BACKWARD, slot);
+                else if (dy > 0)
+                    HidOut.consumerPress(MEDIA_PLAY_PAUSE, slot);
+                else
+                {
+                    HidOut.keyPress(KEYUSAGE_LEFT_ALT, slot);
+                    HidOut.flush(micros());
+                    delay(10);
+                    HidOut.keyPress(KEYUSAGE_TAB, slot);
+                }
+            }
+            if (released & kBtnTouch)
+            {
+                HidOut.consumerRelease(slot);
+                HidOut.keyReleaseAll(slot);
+            }
+
+            if (pressed & kBtnVolumeUp)
+                HidOut.consumerPress(MEDIA_VOLUME_UP, slot);
+            if (released & kBtnVolumeUp)
+                HidOut.consumerRelease(slot);
+            if (pressed & kBtnVolumeDown)
+                HidOut.consumerPress(MEDIA_VOLUME_DOWN, slot);
+            if (released & kBtnVolumeDown)
+                HidOut.consumerRelease(slot);
+            if (pressed & kBtnHome)
+                HidOut.consumerPress(MEDIA_HOME, slot);
+            if (released & kBtnHome)
+                HidOut.consumerRelease(slot);
+            if (pressed & kBtnBack)
+                HidOut.consumerPress(MEDIA_BACK, slot);
+            if (released & kBtnBack)
+                HidOut.consumerRelease(slot);
+        }
+    };
+
+    // Nothing mapped: the cost of the timing itself
+    struct Floor
+    {
+        uint32_t toggles = 0;
+        void map(const JoySample &, const JoySample &, uint8_t) {}
+    };
+
+    // The table, fed the way emitUSB does
+    struct Table
+    {
+        InputBindings b;
+        uint16_t gesture = 0;
+        bool usePad = true;
+        uint32_t toggles = 0;
+
+        explicit Table(size_t bindings)
+        {
+            std::vector<Binding> t(GearVR::kDefaultBindings, GearVR::kDefaultBindings + GearVR::kDefaultBindingCount);
+            // inputs the controller never sets: bindings that only cost table space
+            for (uint8_t in = 11; in < InputBindings::kInputs; in++)
+                t.push_back({in, BindAction::Consumer, BindMode::Hold, 0, MEDIA_MUTE});
+            t.resize(bindings);
+            b.set(t.data(), t.size());
+            b.setLocalHook(
+                [](void *ctx, uint16_t code, bool down) {
+                    Table *self = static_cast<Table *>(ctx);
+                    if (code == GearVR::kLocalTogglePointer && down)
+                    {
+                        self->usePad = !self->usePad;
+                        self->toggles++;
+                    }
+                },
+                this);
+        }
+
+        void map(const JoySample &now, const JoySample &prev, uint8_t slot)
+        {
+            if (!now.pressed(kBtnTouch))
+                gesture = 0;
+            else if (!prev.pressed(kBtnTouch) && !now.pressed(kBtnTrigger))
+            {
+                int dx = now.touchpad.x - 160, dy = now.touchpad.y - 160;
+                if (abs(dx) < 60 && abs(dy) < 60)
+                    gesture = kGestureCenter;
+                else if (abs(dx) > abs(dy))
+                    gesture = dx > 0 ? kGestureRight : kGestureLeft;
+                else
+                    gesture = dy > 0 ? kGestureDown : kGestureUp;
+            }
+            b.setSource(slot);
+            b.process(now.buttons | gesture);
+        }
+    };
+
+    // Buttons held for a few packets at a time, pad clicks anywhere on the
+    // pad, now and then with the trigger down. One button besides the
+    // trigger at a time: the cascade let go of every media key and key when
+    // the pad click ended, the table only of what the click pressed
+    std::vector<JoySample> script(int packets)
+    {
+        std::vector<JoySample> v(packets);
+        uint32_t rng = 0xb1d5;
+        auto next = [&rng](uint32_t n) {
+            rng = rng * 1664525u + 1013904223u;
+            return (rng >> 8) % n;
+        };
+        uint8_t held = 0;
+        for (int i = 0; i < packets; i++)
+        {
+            JoySample &s = v[i];
+            if (next(8) == 0)
+            {
+                uint8_t b = (uint8_t)(1u << next(6));
+                if (b == kBtnTrigger || (held & ~kBtnTrigger) == 0 || (held & b))
+                    held ^= b;
+            }
+            s.buttons = held;
+            if (held & kBtnTouch)
+            {
+                s.touchpad.x = (uint16_t)(i > 0 && (v[i - 1].buttons & kBtnTouch) ? v[i - 1].touchpad.x : 1 + next(315));
+                s.touchpad.y = (uint16_t)(i > 0 && (v[i - 1].buttons & kBtnTouch) ? v[i - 1].touchpad.y : 1 + next(315));
+            }
+        }
+        return v;
+    }
+
+    struct Run
+    {
+        std::vector<hal::HidReport> log;
+        BenchStats quiet, all;
+        uint32_t toggles = 0;
+    };
+
+    template <typename Mapper>
+    void run(Mapper &m, const std::vector<JoySample> &in, Run &r)
+    {
+        hal::setTimeUs(1000000);
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        JoySample none;
+        for (size_t i = 0; i < in.size(); i++)
+        {
+            const JoySample &prev = i ? in[i - 1] : none;
+            uint32_t t0 = ESP.getCycleCount();
+            m.map(in[i], prev, 0);
+            uint32_t c = ESP.getCycleCount() - t0;
+            r.all.add(c);
+            if (in[i].buttons == prev.buttons)
+                r.quiet.add(c);
+            for (uint32_t us = 0; us < kPacketUs; us += 1000)
+            {
+                HidOut.flush(micros());
+                hal::advanceUs(1000);
+            }
+        }
+        r.log = hal::hid.snapshot();
+        hal::hid.keep = false;
+        r.toggles = m.toggles;
+    }
+
+    bool sameReports(const std::vector<hal::HidReport> &a, const std::vector<hal::HidReport> &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (a[i].iface != b[i].iface || a[i].len != b[i].len || memcmp(a[i].data, b[i].data, a[i].len) != 0)
+                return false;
+        return true;
+    }
+}
+
+int benchBindings(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 200000;
+    if (packets <= 0)
+        packets = 200000;
+    std::vector<JoySample> in = script(packets);
+    printf("== bindings: %d packets, random buttons and pad clicks ==\n", packets);
+
+    Floor floor;
+    Run none;
+    run(floor, in, none);
+    none.all.report("timer floor", "cyc");
+
+    Cascade cascade;
+    Run ref;
+    run(cascade, in, ref);
+
+    bool ok = true;
+    for (size_t n : {(size_t)GearVR::kDefaultBindingCount, (size_t)1, (size_t)InputBindings::kInputs})
+    {
+        Table table(n);
+        Run r;
+        run(table, in, r);
+        if (n == GearVR::kDefaultBindingCount)
+        {
+            bool same = sameReports(ref.log, r.log) && ref.toggles == r.toggles;
+            printf("default table vs cascade: %zu vs %zu HID reports, %u vs %u pointer toggles -> %s\n",
+                   r.log.size(), ref.log.size(), r.toggles, ref.toggles, same ? "identical" : "DIFFERENT");
+            ok = ok && same;
+            ref.quiet.report("cascade, quiet packets", "cyc");
+            ref.all.report("cascade, all packets", "cyc");
+        }
+        char label[48];
+        snprintf(label, sizeof(label), "table %2zu, quiet packets", n);
+        r.quiet.report(label, "cyc");
+        snprintf(label, sizeof(label), "table %2zu, all packets", n);
+        r.all.report(label, "cyc");
+    }
+
+    // Profile round trip and a reload mid-stream
+    Table table(GearVR::kDefaultBindingCount);
+    uint8_t profile[InputBindings::kMaxProfile];
+    size_t len = table.b.save(profile, sizeof(profile));
+    InputBindings copy;
+    bool loaded = copy.load(profile, len);
+    copy.process(0); // takes the staged table
+    uint8_t again[InputBindings::kMaxProfile];
+    bool roundTrip = loaded && copy.save(again, sizeof(again)) == len && memcmp(profile, again, len) == 0;
+    profile[len - 1] ^= 0xFF; // corrupt: must be refused, table kept
+    bool refused = !copy.load(profile, len - 1);
+    printf("profile: %zu bytes for %zu bindings, round trip %s, truncated profile %s\n", len, copy.count(),
+           roundTrip ? "ok" : "FAILED", refused ? "refused" : "ACCEPTED");
+    return ok && roundTrip && refused ? 0 : 1;
+}
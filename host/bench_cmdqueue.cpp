@@ -0,0 +1,116 @@
+// GearVR command queue: cost of the queue operations, what reaches the
+// controller when requests arrive in bursts, and retry timing on failed
+// writes (virtual time).
+#include "Bench.h"
+#include "CmdQueue.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    struct Write
+    {
+        uint32_t ms;
+        uint8_t cmd;
+        bool response;
+    };
+
+    const char *cmdName(uint8_t c)
+    {
+        static const char *kNames[] = {"Off", "Sensor", "FwUp", "Cal", "Keep", "Unk", "LpmEn", "LpmDis", "VR"};
+        return c < 9 ? kNames[c] : "?";
+    }
+
+    void printWrites(const char *label, const std::vector<Write> &w, uint32_t t0)
+    {
+        printf("%-18s", label);
+        for (const Write &x : w)
+            printf(" %s%s@%u", cmdName(x.cmd), x.response ? "(rsp)" : "", x.ms - t0);
+        printf("\n");
+    }
+}
+
+int benchCmdQueue(int argc, char **argv)
+{
+    printf("== command queue ==\n");
+
+    // Queue operations on their own
+    {
+        CmdQueue q;
+        const uint8_t sensor[2] = {0x01, 0}, vr[2] = {0x08, 0}, keep[2] = {0x04, 0};
+        const CmdPolicy rsp = {true, 3, 100, 2000}, norsp = {false, 1, 0, 1000};
+        BenchStats cost;
+        const int rounds = 100000;
+        cost.reserve(rounds);
+        for (int i = 0; i < rounds; i++)
+        {
+            uint32_t t0 = ESP.getCycleCount();
+            q.push(keep, CmdPriority::Background, norsp, i);
+            q.push(vr, CmdPriority::Urgent, norsp, i);
+            q.push(sensor, CmdPriority::Urgent, rsp, i);
+            q.push(sensor, CmdPriority::Urgent, rsp, i); // deduped
+            while (CmdQueue::Cmd *c = q.next(i))
+                q.sent(c);
+            cost.add(ESP.getCycleCount() - t0);
+        }
+        cost.report("4 push + drain", "cycles");
+
+        // Full of keepalives: an urgent command evicts one, another keepalive is refused
+        CmdQueue full;
+        for (uint8_t k = 0; k < CmdQueue::kCapacity; k++)
+        {
+            uint8_t c[2] = {0x04, k};
+            full.push(c, CmdPriority::Background, norsp, 0);
+        }
+        bool urgent = full.push(sensor, CmdPriority::Urgent, rsp, 0);
+        uint8_t extra[2] = {0x04, 0x80};
+        bool background = full.push(extra, CmdPriority::Background, norsp, 0);
+        CmdQueue::Cmd *first = full.next(0);
+        printf("full queue: urgent %s (evicted=%u), keepalive %s, first out=%s\n",
+               urgent ? "accepted" : "refused", full.stats().evicted, background ? "accepted" : "refused",
+               first ? cmdName(first->data[0]) : "-");
+    }
+
+    hal::setTimeUs(1000000);
+    FakeGearVR dev;
+    GearVR gear;
+    std::vector<Write> writes;
+    dev.writeChar()->onWrite([&](const uint8_t *d, size_t len, bool response) {
+        writes.push_back({millis(), d[0], response});
+    });
+    auto run = [&](uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++)
+        {
+            gear.update(1);
+            hal::advanceUs(1000);
+        }
+    };
+
+    uint32_t t0 = millis();
+    gear.onConnected(dev.client());
+    run(5);
+    printWrites("connect:", writes, t0);
+
+    // LPM Enable and VR Mode requests drained in the same update(): the
+    // single command slot used to keep only the last command (Sensor)
+    writes.clear();
+    t0 = millis();
+    dev.sendRequest(0x06);
+    dev.sendRequest(0x08);
+    run(5);
+    printWrites("LPM+VR burst:", writes, t0);
+
+    // Two failed VR writes (LPM request again): retried after 100 ms each,
+    // inside the handshake's 300 ms step timeout
+    writes.clear();
+    t0 = millis();
+    dev.writeChar()->failWrites = 2;
+    dev.sendRequest(0x06);
+    run(250);
+    printWrites("2 failed writes:", writes, t0);
+
+    const CmdQueueStats &st = gear.cmdStats();
+    printf("stats: queued=%u deduped=%u sent=%u retries=%u gaveUp=%u expired=%u evicted=%u rejected=%u\n",
+           st.queued, st.deduped, st.sent, st.retries, st.gaveUp, st.expired, st.evicted, st.rejected);
+    return 0;
+}
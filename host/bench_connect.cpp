@@ -0,0 +1,206 @@
+// A second controller coming up while the first one streams. Controller A
+// links from the peer cache and sends a frame every 15 ms; then B
+// advertises, with a connect and a GATT discovery as slow as on hardware.
+// What A's input saw until B was linked (and a while after): the longest
+// silence between its mouse reports, ring overflows, frames not handled.
+//  - inline: connects run inside update() on the task serving the links
+//    (the manager without its connect task: how every connect used to run)
+//  - connect task: connects and discovery on their own task
+// Real time and real threads. The connect task never exits, so that mode
+// runs last and the process leaves through _exit().
+//
+//   universal_host connect [discovery ms]   (default 1500)
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint32_t kPacketMs = 15;   // controller frame spacing
+    constexpr uint32_t kConnectMs = 300; // B's connect, before discovery
+    constexpr uint32_t kLeadMs = 500;    // A alone before B shows up
+    constexpr uint32_t kTailMs = 300;    // after B is linked
+    constexpr uint32_t kAdvertiseMs = 50;
+    const uint8_t kMacA[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x01};
+    const uint8_t kMacB[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x02};
+
+    struct Result
+    {
+        bool linked = false;
+        uint32_t linkMs = 0;   // B's first advertisement -> B live
+        uint32_t maxGapMs = 0; // longest silence between A's mouse reports
+        uint32_t sent = 0, handled = 0, overflows = 0;
+    };
+
+    // A bonded in NVS for slot 0, so init() connects it without a scan
+    void seedCache(FakeGearVR &dev)
+    {
+        GearVR probe;
+        probe.onConnected(dev.client());
+        PeerHandles handles;
+        probe.exportHandles(handles);
+        dev.client()->disconnect();
+
+        Preferences::eraseAll();
+        PeerCache cache;
+        cache.load();
+        cache.remember(kMacA, 0, 0, handles);
+        cache.save();
+    }
+
+    void prepare(FakeGearVR &a, FakeGearVR &b, uint32_t discoveryMs)
+    {
+        seedCache(a);
+        b.client()->connectMs = kConnectMs;
+        b.client()->discoveryMs = discoveryMs;
+        // slot i is created i-th: A is slot 0, B slot 1
+        BLEDevice::setClientFactory([&a, &b, n = 0]() mutable { return (n++ == 0 ? a : b).client(); });
+    }
+
+    bool waitConnected(BLEManagerBase &mgr, size_t slot)
+    {
+        for (int i = 0; i < 2000 && !mgr.connected(slot); i++)
+            delay(1);
+        return mgr.connected(slot);
+    }
+
+    void run(BLEManagerBase &mgr, FakeGearVR &a, GearVR &gearA, Result &r)
+    {
+        if (!waitConnected(mgr, 0))
+            return;
+        hal::hid.clear();
+        hal::hid.keep = true;
+        std::atomic<bool> streaming{true};
+        std::atomic<uint32_t> sent{0};
+        std::thread producer([&]() {
+            auto next = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; streaming; i++)
+            {
+                next += std::chrono::milliseconds(kPacketMs);
+                std::this_thread::sleep_until(next);
+                a.motion.touchX = (uint16_t)(160 + 80 * cosf(i * 0.2f));
+                a.motion.touchY = (uint16_t)(160 + 80 * sinf(i * 0.2f));
+                a.sendPacket();
+                sent++;
+            }
+        });
+        delay(kLeadMs);
+
+        const uint32_t sent0 = sent, handled0 = gearA.joy.state.updateCounts, over0 = gearA.rx().overflows();
+        const uint32_t t0 = micros();
+        BLEScan *scan = BLEDevice::getScan();
+        while (!mgr.connected(1) && micros() - t0 < 10000000)
+        {
+            if (!scan->isScanning())
+                mgr.rescan();
+            else
+            {
+                BLEAdvertisedDevice adv;
+                adv.setName("Gear VR Controller(B)");
+                adv.setAddress(BLEAddress(kMacB));
+                scan->deliver(adv);
+            }
+            delay(kAdvertiseMs);
+        }
+        r.linked = mgr.connected(1);
+        r.linkMs = (micros() - t0) / 1000;
+        delay(kTailMs);
+        streaming = false;
+        producer.join();
+        delay(20); // let the last frame drain
+        r.sent = sent - sent0;
+        r.handled = gearA.joy.state.updateCounts - handled0;
+        r.overflows = gearA.rx().overflows() - over0;
+
+        uint32_t last = t0;
+        for (const hal::HidReport &rep : hal::hid.snapshot())
+        {
+            if (rep.iface != hal::kHidMouse || (int32_t)(rep.us - t0) < 0)
+                continue;
+            r.maxGapMs = max(r.maxGapMs, (rep.us - last) / 1000);
+            last = rep.us;
+        }
+        hal::hid.keep = false;
+    }
+
+    void print(const char *label, const Result &r)
+    {
+        if (!r.linked)
+        {
+            printf("%-14s B never linked\n", label);
+            return;
+        }
+        printf("%-14s B linked in %4u ms; A meanwhile: longest report gap %4u ms, %u frames sent, %u handled, "
+               "%u ring overflows\n",
+               label, r.linkMs, r.maxGapMs, r.sent, r.handled, r.overflows);
+    }
+}
+
+int benchConnect(int argc, char **argv)
+{
+    uint32_t discoveryMs = argc > 0 ? (uint32_t)atoi(argv[0]) : 1500;
+    printf("== connect: B comes up (connect %u ms, discovery %u ms) while A streams every %u ms ==\n", kConnectMs,
+           discoveryMs, kPacketMs);
+    hal::useRealTime();
+    HidOut = HidOutput();
+
+    // No tasks: a service thread runs update() and every connect with it
+    Result inlined;
+    {
+        FakeGearVR a, b;
+        prepare(a, b, discoveryMs);
+        GearVR gearA, gearB;
+        std::unique_ptr<BLEManager<>> mgr(new BLEManager<>());
+        mgr->registerHandler(&gearA);
+        mgr->registerHandler(&gearB);
+        hal::enableTasks(false);
+        mgr->init();
+        std::atomic<bool> serve{true};
+        std::thread service([&]() {
+            uint32_t last = millis();
+            while (serve)
+            {
+                uint32_t now = millis();
+                if (mgr->msUntilNext(now) != 0)
+                {
+                    delay(1);
+                    continue;
+                }
+                mgr->update(now - last);
+                last = now;
+            }
+        });
+        run(*mgr, a, gearA, inlined);
+        serve = false;
+        service.join();
+        a.client()->disconnect();
+        b.client()->disconnect();
+        mgr->update(0);
+    }
+    print("inline", inlined);
+
+    // BLE task + connect task
+    Result tasked;
+    static FakeGearVR a, b;
+    prepare(a, b, discoveryMs);
+    static GearVR gearA, gearB;
+    static BLEManager<> mgr;
+    mgr.registerHandler(&gearA);
+    mgr.registerHandler(&gearB);
+    hal::enableTasks(true);
+    mgr.init();
+    if (!mgr.taskRunning())
+        printf("connect task: tasks not running\n");
+    run(mgr, a, gearA, tasked);
+    print("connect task", tasked);
+
+    fflush(stdout);
+    _exit(tasked.linked && tasked.overflows == 0 ? 0 : 1);
+}
@@ -0,0 +1,113 @@
+// Online gyro bias estimation: convergence while still, stability while
+// moving, cost per subsample, and IMU-only yaw drift with/without it.
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    const float kBias[3] = {0.02f, -0.015f, 0.01f}; // rad/s
+
+    void decodeRaw(const uint8_t *p, int t, RawAxis3 &g, RawAxis3 &a)
+    {
+        const uint8_t *b = p + t * 16;
+        a.x = (int16_t)(b[4] | (b[5] << 8));
+        a.y = (int16_t)(b[6] | (b[7] << 8));
+        a.z = (int16_t)(b[8] | (b[9] << 8));
+        g.x = (int16_t)(b[10] | (b[11] << 8));
+        g.y = (int16_t)(b[12] | (b[13] << 8));
+        g.z = (int16_t)(b[14] | (b[15] << 8));
+    }
+
+    float biasError(const GyroBias &est)
+    {
+        const Axis3 &b = est.bias();
+        float e = 0;
+        e = max(e, fabsf(b.x * GYR_SCALE - kBias[0]));
+        e = max(e, fabsf(b.y * GYR_SCALE - kBias[1]));
+        e = max(e, fabsf(b.z * GYR_SCALE - kBias[2]));
+        return e;
+    }
+
+    void setNoisyBiased(FakeGearVR &dev)
+    {
+        for (int a = 0; a < 3; a++)
+            dev.motion.gyroBias[a] = kBias[a];
+        dev.motion.gyroNoise = 3;
+        dev.motion.accelNoise = 12;
+    }
+
+    // Yaw drift of the full GearVR pipeline, IMU-only, after `seconds` still
+    float pipelineDrift(bool estimate, float seconds)
+    {
+        FakeGearVR dev;
+        setNoisyBiased(dev);
+        GearVR gear;
+        gear.ahrs.config.useMag = false;
+        gear.onConnected(dev.client());
+        int packets = (int)(seconds / (3 * dev.subsampleUs * 1e-6f));
+        for (int i = 0; i < packets; i++)
+        {
+            if (!estimate)
+                gear.gyroBias.clear();
+            dev.sendPacket();
+            gear.update(0);
+        }
+        return gear.joy.state.orient.yaw;
+    }
+}
+
+int benchGyroBias(int argc, char **argv)
+{
+    FakeGearVR dev;
+    setNoisyBiased(dev);
+    GyroBias est;
+    uint8_t frame[60];
+    const float sub = dev.subsampleUs * 1e-6f;
+
+    printf("== gyrobias: bias (%.3f, %.3f, %.3f) rad/s, noise +/-3 LSB gyro, +/-12 LSB accel ==\n",
+           kBias[0], kBias[1], kBias[2]);
+
+    // 1) Still: time to converge within 0.002 rad/s on every axis
+    BenchStats cycles;
+    int converged = -1;
+    for (int n = 0; n < 3 * 70 * 30; n += 3)
+    {
+        dev.makePacket(frame);
+        for (int t = 0; t < 3; t++)
+        {
+            RawAxis3 g, a;
+            decodeRaw(frame, t, g, a);
+            uint32_t c0 = ESP.getCycleCount();
+            est.add(g, a);
+            cycles.add(ESP.getCycleCount() - c0);
+        }
+        if (converged < 0 && biasError(est) < 0.002f)
+            converged = n;
+    }
+    printf("still: converged in %.2f s, residual %.4f rad/s\n", converged * sub, biasError(est));
+
+    // 2) Moving (wrist waving) for 30 s: bias must not be dragged by motion
+    float before = biasError(est);
+    uint32_t stillBefore = est.stillSamples();
+    for (int i = 0; i < 70 * 30; i++)
+    {
+        dev.motion.gyro[0] = 0.6f * sinf(i * 0.05f);
+        dev.motion.gyro[2] = 1.2f * sinf(i * 0.031f);
+        dev.motion.linearAccel[1] = 1.5f * sinf(i * 0.07f);
+        dev.makePacket(frame);
+        for (int t = 0; t < 3; t++)
+        {
+            RawAxis3 g, a;
+            decodeRaw(frame, t, g, a);
+            est.add(g, a);
+        }
+    }
+    printf("moving: residual %.4f -> %.4f rad/s, still windows during motion: %u\n", before,
+           biasError(est), est.stillSamples() - stillBefore);
+    cycles.report("GyroBias::add", "cycles");
+
+    printf("IMU-only yaw drift after 120 s still: %.3f rad without estimator, %.3f rad with\n",
+           pipelineDrift(false, 120), pipelineDrift(true, 120));
+    return 0;
+}
@@ -0,0 +1,84 @@
+// GearVR handshake against the fake controller's protocol model, virtual
+// time at a 1 ms loop: time to first full packet, the states walked, and
+// recovery from lost commands, a silent controller and a stalled stream.
+#include <functional>
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    const char *kStateNames[] = {"Idle", "Sensor", "Vr", "SensorAgain", "Streaming", "Parked"};
+
+    void printPath(uint8_t path)
+    {
+        const char *sep = "";
+        for (uint8_t s = 1; s < 6; s++)
+            if (path & (1u << s))
+            {
+                printf("%s%s", sep, kStateNames[s]);
+                sep = ",";
+            }
+    }
+
+    struct HandshakeSim
+    {
+        FakeGearVR dev;
+        GearVR gear;
+
+        HandshakeSim() { dev.enableProtocol(); }
+
+        void run(uint32_t ms)
+        {
+            for (uint32_t i = 0; i < ms; i++)
+            {
+                dev.poll();
+                gear.update(1);
+                hal::advanceUs(1000);
+            }
+        }
+
+        void report(const char *label)
+        {
+            const HandshakeStats &st = gear.handshake().stats();
+            printf("%-22s ttff %4u ms  state=%-9s path=", label, st.lastTtffMs,
+                   kStateNames[(uint8_t)gear.handshake().state()]);
+            printPath(gear.handshake().path());
+            printf("  retries=%u timeouts=%u stalls=%u parks=%u keepalives=%u  cmds S=%u VR=%u KA=%u\n",
+                   st.retries, st.timeouts, st.stalls, st.parks, st.keepalives, dev.commands(0x01),
+                   dev.commands(0x08), dev.commands(0x04));
+        }
+    };
+
+    void scenario(const char *label, uint32_t ms, std::function<void(HandshakeSim &)> setup,
+                  std::function<void(HandshakeSim &)> during = nullptr)
+    {
+        HandshakeSim sim;
+        setup(sim);
+        sim.gear.onConnected(sim.dev.client());
+        sim.run(ms);
+        if (during)
+        {
+            during(sim);
+            sim.run(ms);
+        }
+        sim.report(label);
+    }
+}
+
+int benchHandshake(int argc, char **argv)
+{
+    hal::setTimeUs(1000000);
+    printf("== handshake (virtual time, controller replies after 20 ms) ==\n");
+
+    scenario("observed (needs VR)", 2000, [](HandshakeSim &) {});
+    scenario("already streams", 2000, [](HandshakeSim &s) { s.dev.protocol.needsVr = false; });
+    scenario("first Sensor lost", 2000, [](HandshakeSim &s) { s.dev.protocol.dropWrites = 1; });
+    scenario("VR lost twice", 2000, [](HandshakeSim &s) {
+        s.dev.protocol.dropWrites = 2;
+        s.dev.protocol.dropOnly = 0x08;
+    });
+    scenario("silent 30 s", 30000, [](HandshakeSim &s) { s.dev.protocol.silent = true; });
+    scenario("stream stall", 2000, [](HandshakeSim &) {}, [](HandshakeSim &s) { s.dev.stopStream(); });
+    return 0;
+}
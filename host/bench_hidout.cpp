@@ -0,0 +1,184 @@
+// HID output coalescing: reports on the wire versus the one-report-per-call
+// emission it replaced (every move/press/release was a report), and whether
+// button edges survive when several frames land in one USB frame. Virtual
+// time, BLE task modelled as a 1 ms service loop.
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "HID.h"
+#include "HidOutput.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint32_t kPacketMs = 15;
+
+    struct Scenario
+    {
+        const char *label;
+        bool usePad;
+        uint32_t perEvent; // frames delivered back to back per connection event
+        void (*script)(FakeGearVR::Motion &m, int i);
+        GyroPointer gyroMode;
+    };
+
+    void still(FakeGearVR::Motion &m, int)
+    {
+        m = FakeGearVR::Motion();
+    }
+
+    void sweep(FakeGearVR::Motion &m, int i)
+    {
+        m = FakeGearVR::Motion();
+        m.gyro[2] = 1.5f * sinf(i * 0.02f);
+        m.gyro[1] = 0.5f * sinf(i * 0.03f);
+    }
+
+    // Turn ~12 degrees right over the first 10 frames, then hold
+    void offCentre(FakeGearVR::Motion &m, int i)
+    {
+        m = FakeGearVR::Motion();
+        if (i < 10)
+            m.gyro[2] = -1.5f;
+    }
+
+    void touchClicks(FakeGearVR::Motion &m, int i)
+    {
+        m = FakeGearVR::Motion();
+        m.touchX = (uint16_t)(160 + 80 * cosf(i * 0.05f));
+        m.touchY = (uint16_t)(160 + 80 * sinf(i * 0.05f));
+        if ((i / 2) % 2)
+            m.buttons = 0x01; // trigger
+    }
+
+    void tapEveryFrame(FakeGearVR::Motion &m, int i)
+    {
+        touchClicks(m, i);
+        m.buttons = (i % 2) ? 0x01 : 0x00;
+        if (i % 40 == 5)
+            m.buttons |= 0x10; // volume up, released next frame
+    }
+
+    int bitEdges(uint8_t prev, uint8_t now, uint8_t mask)
+    {
+        return ((prev ^ now) & mask) ? 1 : 0;
+    }
+
+    void run(const Scenario &sc, int packets)
+    {
+        FakeGearVR dev;
+        GearVR gear;
+        gear.onConnected(dev.client());
+        gear.update(0);
+        gear.joy.state.usePad = sc.usePad;
+        gear.config.gyroMode = sc.gyroMode;
+        for (int i = 0; i < 100; i++) // settle AHRS and handshake
+        {
+            dev.sendPacket();
+            gear.update(0);
+            hal::advanceUs(kPacketMs * 1000);
+        }
+        for (int i = 0; i < 20; i++)
+        {
+            gear.update(1);
+            hal::advanceUs(1000);
+        }
+
+        hal::hid.clear();
+        hal::hid.keep = true;
+        HidOutputStats s0 = HidOut.stats();
+        BenchStats flushCycles;
+        int triggerEdges = 0, volumeEdges = 0;
+        uint8_t lastButtons = 0;
+        for (int i = 0; i < packets; i += sc.perEvent)
+        {
+            for (uint32_t k = 0; k < sc.perEvent; k++)
+            {
+                sc.script(dev.motion, i + (int)k);
+                triggerEdges += bitEdges(lastButtons, dev.motion.buttons, 0x01);
+                volumeEdges += bitEdges(lastButtons, dev.motion.buttons, 0x10);
+                lastButtons = dev.motion.buttons;
+                dev.sendPacket();
+            }
+            for (uint32_t ms = 0; ms < kPacketMs * sc.perEvent; ms++)
+            {
+                uint32_t c0 = ESP.getCycleCount();
+                gear.update(1);
+                flushCycles.add(ESP.getCycleCount() - c0);
+                hal::advanceUs(1000);
+            }
+        }
+        hal::hid.keep = false;
+
+        // Edges that made it onto the wire, and reports sharing a USB frame
+        int wireTrigger = 0, wireVolume = 0, sameFrame = 0;
+        long relTravel = 0;
+        uint32_t absReports = 0;
+        unsigned absX = 0, absY = 0;
+        uint8_t mouseButtons = 0;
+        uint16_t usage = 0;
+        uint32_t lastFrame = UINT32_MAX;
+        for (const hal::HidReport &r : hal::hid.log)
+        {
+            uint32_t frame = r.us / 1000;
+            sameFrame += frame == lastFrame;
+            lastFrame = frame;
+            if (r.iface == hal::kHidMouse)
+            {
+                wireTrigger += bitEdges(mouseButtons, r.data[0], 0x01);
+                mouseButtons = r.data[0];
+                relTravel += abs((int8_t)r.data[1]) + abs((int8_t)r.data[2]);
+            }
+            else if (r.iface == hal::kHidAbsolute)
+            {
+                absReports++;
+                absX = r.data[1] | r.data[2] << 8;
+                absY = r.data[3] | r.data[4] << 8;
+            }
+            else if (r.iface == hal::kHidConsumer)
+            {
+                uint16_t u = (uint16_t)(r.data[0] | r.data[1] << 8);
+                wireVolume += (u == MEDIA_VOLUME_UP) != (usage == MEDIA_VOLUME_UP);
+                usage = u;
+            }
+        }
+
+        const HidOutputStats &s1 = HidOut.stats();
+        uint32_t calls = s1.totalCalls() - s0.totalCalls();
+        uint32_t sent = s1.totalSent() - s0.totalSent();
+        uint32_t suppressed = s1.totalSuppressed() - s0.totalSuppressed();
+        printf("-- %s: %d packets --\n", sc.label, packets);
+        printf("   direct emission %6u reports (%.2f/packet)  coalesced %6u (%.2f/packet)  suppressed %u\n",
+               calls, calls / (double)packets, sent, sent / (double)packets, suppressed);
+        printf("   trigger edges %d -> %d on the wire, volume edges %d -> %d, reports sharing a USB frame %d\n",
+               triggerEdges, wireTrigger, volumeEdges, wireVolume, sameFrame);
+        if (!sc.usePad)
+            printf("   cursor: relative travel %ld counts, %u absolute reports, last at (%u, %u)\n", relTravel,
+                   absReports, absX, absY);
+        flushCycles.report("   update() per 1 ms pass", "cycles");
+        HidOut.releaseAll();
+        gear.update(1);
+    }
+}
+
+int benchHidOut(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 4000;
+    if (packets <= 0)
+        packets = 4000;
+    hal::setTimeUs(1000000);
+
+    const Scenario scenarios[] = {
+        {"gyro rate, controller still", false, 1, still, GyroPointer::Rate},
+        {"gyro rate, sweeping", false, 1, sweep, GyroPointer::Rate},
+        {"gyro rate, held off-centre", false, 1, offCentre, GyroPointer::Rate},
+        {"gyro absolute, sweeping", false, 1, sweep, GyroPointer::Absolute},
+        {"gyro absolute, held off-centre", false, 1, offCentre, GyroPointer::Absolute},
+        {"touchpad + trigger every 2 frames", true, 1, touchClicks, GyroPointer::Absolute},
+        {"3 frames per connection event, tap every frame", true, 3, tapEveryFrame, GyroPointer::Absolute},
+    };
+    printf("== hidout (virtual time; frame every %u ms, 1 ms USB frames) ==\n", kPacketMs);
+    for (const Scenario &sc : scenarios)
+        run(sc, packets);
+    return 0;
+}
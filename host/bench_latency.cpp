@@ -0,0 +1,83 @@
+// Per-stage latency histograms (LATENCY_TRACE) over a real-time stream: the
+// bench thread plays the Bluedroid callback, the BLE task drains frames and
+// flushes HID. Dumps the same table the firmware prints for 'l' on Serial.
+#include <thread>
+#include <unistd.h>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "LatencyTrace.h"
+
+#if LATENCY_TRACE
+namespace
+{
+    constexpr uint32_t kPacketMs = 15;
+
+    // Wrist motion, a circling thumb and trigger presses
+    void stream(FakeGearVR &dev, uint32_t packets)
+    {
+        auto next = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < packets; i++)
+        {
+            next += std::chrono::milliseconds(kPacketMs);
+            std::this_thread::sleep_until(next);
+            FakeGearVR::Motion &m = dev.motion;
+            m.gyro[2] = 1.2f * sinf(i * 0.05f);
+            m.gyro[1] = 0.4f * sinf(i * 0.07f);
+            m.touchX = (uint16_t)(160 + 80 * cosf(i * 0.2f));
+            m.touchY = (uint16_t)(160 + 80 * sinf(i * 0.2f));
+            m.buttons = (i / 8) % 2 ? 0x01 : 0x00;
+            dev.sendPacket();
+        }
+        delay(20);
+    }
+}
+#endif
+
+int benchLatency(int argc, char **argv)
+{
+#if LATENCY_TRACE
+    uint32_t packets = argc > 0 ? (uint32_t)atoi(argv[0]) : 1000;
+    if (packets == 0)
+        packets = 1000;
+    hal::useRealTime();
+
+    static FakeGearVR dev;
+    dev.subsampleUs = kPacketMs * 1000 / 3; // device clock matches the send rate
+    {
+        // bonded controller in NVS: init() connects directly
+        GearVR probe;
+        probe.onConnected(dev.client());
+        PeerHandles handles;
+        probe.exportHandles(handles);
+        dev.client()->disconnect();
+        const uint8_t mac[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x01};
+        Preferences::eraseAll();
+        PeerCache cache;
+        cache.load();
+        cache.remember(mac, 0, 0, handles);
+        cache.save();
+    }
+    BLEDevice::setClientFactory([]() { return dev.client(); });
+    static GearVR gear;
+    static BLEManager<> mgr;
+    mgr.registerHandler(&gear);
+    hal::enableTasks(true);
+    mgr.init();
+    for (int i = 0; i < 2000 && !mgr.connected(); i++)
+        delay(1);
+
+    printf("== latency (real time, BLE task; %u packets, frame every %u ms) ==\n", packets, kPacketMs);
+    stream(dev, 50); // handshake and filters settle
+    Latency.reset();
+    stream(dev, packets);
+    Latency.dump(Serial);
+    fflush(stdout);
+    _exit(0);
+#else
+    printf("latency: built without LATENCY_TRACE (cmake -DHOST_LATENCY_TRACE=ON)\n");
+    return 0;
+#endif
+}
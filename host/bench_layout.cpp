@@ -0,0 +1,162 @@
+// Packet decoding: the Gear VR layout as PacketField descriptors
+// (GearVRPacket::decode) against the hand-written byte shuffling it replaced.
+// Both decode the same packets: recorded-style ones from the fake controller
+// and random bytes (every sign bit and touchpad bit pattern); any field that
+// differs is reported. Cost per packet in cycles.
+//
+//   universal_host layout [packets]   (default 200000)
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    // The parser as it was written before the layout descriptors
+    void handParse(const uint8_t *p, JoySample &cur)
+    {
+        for (int t = 0; t < 3; t++)
+        {
+            int base = t * 16;
+
+            cur.sensor_time[t] = ((uint32_t)p[base + 3] << 24) |
+                                 ((uint32_t)p[base + 2] << 16) |
+                                 ((uint32_t)p[base + 1] << 8) |
+                                 ((uint32_t)p[base + 0]);
+
+            cur.accel[t].x = (int16_t)(p[base + 4] | (p[base + 5] << 8));
+            cur.accel[t].y = (int16_t)(p[base + 6] | (p[base + 7] << 8));
+            cur.accel[t].z = (int16_t)(p[base + 8] | (p[base + 9] << 8));
+
+            cur.gyro[t].x = (int16_t)(p[base + 10] | (p[base + 11] << 8));
+            cur.gyro[t].y = (int16_t)(p[base + 12] | (p[base + 13] << 8));
+            cur.gyro[t].z = (int16_t)(p[base + 14] | (p[base + 15] << 8));
+        }
+
+        cur.magno.x = (int16_t)((p[48] << 8) | p[49]);
+        cur.magno.y = (int16_t)((p[50] << 8) | p[51]);
+        cur.magno.z = (int16_t)((p[52] << 8) | p[53]);
+
+        cur.touchpad.x = (((p[54] & 0xF) << 6) | ((p[55] & 0xFC) >> 2)) & 0x3FF;
+        cur.touchpad.y = (((p[55] & 0x3) << 8) | ((p[56] & 0xFF) >> 0)) & 0x3FF;
+
+        cur.temperature = p[57];
+        cur.buttons = p[58] & (kBtnTrigger | kBtnHome | kBtnBack | kBtnTouch | kBtnVolumeUp | kBtnVolumeDown);
+        cur.battery = p[59];
+    }
+
+    bool same(const RawAxis3 &a, const RawAxis3 &b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+    // Names of the fields that differ, empty if none
+    std::string diff(const JoySample &a, const JoySample &b)
+    {
+        std::string d;
+        for (int t = 0; t < 3; t++)
+        {
+            if (a.sensor_time[t] != b.sensor_time[t])
+                d += " time";
+            if (!same(a.accel[t], b.accel[t]))
+                d += " accel";
+            if (!same(a.gyro[t], b.gyro[t]))
+                d += " gyro";
+        }
+        if (!same(a.magno, b.magno))
+            d += " magno";
+        if (a.touchpad.x != b.touchpad.x || a.touchpad.y != b.touchpad.y)
+            d += " touchpad";
+        if (a.temperature != b.temperature || a.buttons != b.buttons || a.battery != b.battery)
+            d += " status";
+        return d;
+    }
+}
+
+int benchLayout(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 200000;
+    if (packets <= 0)
+        packets = 200000;
+
+    // Half from the fake controller in motion, half random bytes
+    hal::setTimeUs(1000000);
+    FakeGearVR dev;
+    std::vector<uint8_t> traffic((size_t)packets * GearVRPacket::kLength);
+    uint32_t rng = 0x1a7e0u;
+    for (int i = 0; i < packets; i++)
+    {
+        uint8_t *p = &traffic[(size_t)i * GearVRPacket::kLength];
+        if (i & 1)
+        {
+            for (size_t k = 0; k < GearVRPacket::kLength; k++)
+            {
+                rng = rng * 1664525u + 1013904223u;
+                p[k] = (uint8_t)(rng >> 24);
+            }
+            continue;
+        }
+        dev.motion.gyro[2] = 2.0f * sinf(i * 0.017f);
+        dev.motion.touchX = (uint16_t)(160 + 150 * cosf(i * 0.05f));
+        dev.motion.touchY = (uint16_t)(160 + 150 * sinf(i * 0.05f));
+        dev.motion.buttons = (uint8_t)((i / 64) & 0x3F);
+        hal::advanceUs(15000);
+        dev.makePacket(p);
+    }
+
+    printf("== layout: %d packets of %zu bytes, PacketField decoder vs hand-written ==\n", packets,
+           GearVRPacket::kLength);
+    uint32_t mismatches = 0;
+    for (int i = 0; i < packets; i++)
+    {
+        const uint8_t *p = &traffic[(size_t)i * GearVRPacket::kLength];
+        JoySample a, b;
+        handParse(p, a);
+        GearVRPacket::decode(p, b);
+        std::string d = diff(a, b);
+        if (!d.empty() && mismatches++ < 5)
+            printf("packet %d differs:%s\n", i, d.c_str());
+    }
+    printf("fields identical on %d/%d packets\n", packets - (int)mismatches, packets);
+
+    // Cost: each decode into a fresh slot of a small ring, as the double
+    // buffer does, so neither is reduced to dead stores
+    JoySample out[2];
+    BenchStats hand, layout;
+    hand.reserve(packets);
+    layout.reserve(packets);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < packets; i++)
+        {
+            const uint8_t *p = &traffic[(size_t)i * GearVRPacket::kLength];
+            uint32_t t0 = ESP.getCycleCount();
+            handParse(p, out[i & 1]);
+            uint32_t t1 = ESP.getCycleCount();
+            GearVRPacket::decode(p, out[i & 1]);
+            uint32_t t2 = ESP.getCycleCount();
+            if (pass) // the first pass warms caches and predictors
+            {
+                hand.add(t1 - t0);
+                layout.add(t2 - t1);
+            }
+        }
+    }
+    hand.report("hand-written", "cyc");
+    layout.report("PacketField", "cyc");
+
+    // Whole-array throughput, no per-call timer in the loop
+    uint32_t sink = 0;
+    uint64_t n0 = benchNowNs();
+    for (int i = 0; i < packets; i++)
+    {
+        handParse(&traffic[(size_t)i * GearVRPacket::kLength], out[i & 1]);
+        sink += out[i & 1].touchpad.x;
+    }
+    uint64_t n1 = benchNowNs();
+    for (int i = 0; i < packets; i++)
+    {
+        GearVRPacket::decode(&traffic[(size_t)i * GearVRPacket::kLength], out[i & 1]);
+        sink += out[i & 1].touchpad.x;
+    }
+    uint64_t n2 = benchNowNs();
+    printf("throughput: hand-written %.1f ns/packet, PacketField %.1f ns/packet (checksum %u)\n",
+           (double)(n1 - n0) / packets, (double)(n2 - n1) / packets, sink);
+    return mismatches ? 1 : 0;
+}
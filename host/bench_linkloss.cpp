@@ -0,0 +1,129 @@
+// Packet loss on the BLE link: does the sensor_time continuity check count
+// what was dropped (and repeated), and how far does the orientation drift
+// from a loss-free run when gaps are bridged vs taken as one big step.
+#include <memory>
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    struct Scenario
+    {
+        const char *name;
+        float lossRate; // chance a loss burst starts at a packet
+        int burst;      // packets per loss burst
+        float dupRate;  // chance a delivered packet arrives twice
+    };
+
+    const Scenario kScenarios[] = {
+        {"no loss", 0.0f, 1, 0.0f},
+        {"2% single", 0.02f, 1, 0.0f},
+        {"5% single", 0.05f, 1, 0.0f},
+        {"3% bursts of 3", 0.03f, 3, 0.0f},
+        {"2% bursts of 6", 0.02f, 6, 0.0f},
+        {"2% duplicated", 0.0f, 1, 0.02f},
+    };
+
+    struct Run
+    {
+        std::vector<Quaternion> q; // after each packet; w = 2 marks "not delivered"
+        ContinuityStats stats;
+        uint32_t injectedLost = 0;
+        uint32_t injectedDup = 0;
+    };
+
+    Run run(const Scenario &sc, int packets, bool bridge)
+    {
+        hal::setTimeUs(1000000);
+        FakeGearVR dev;
+        dev.subsampleUs = 5000; // 3 subsamples per 15 ms packet
+        std::unique_ptr<GearVR> gear(new GearVR());
+        gear->config.bridgeGaps = bridge;
+        gear->onConnected(dev.client());
+        gear->update(0);
+
+        Run r;
+        r.q.resize(packets);
+        uint32_t rng = 0x2468ace1;
+        auto chance = [&rng](float p) {
+            rng = rng * 1664525u + 1013904223u;
+            return (rng >> 8) * (1.0f / 16777216.0f) < p;
+        };
+        int dropLeft = 0;
+        uint8_t frame[60];
+        for (int i = 0; i < packets; i++)
+        {
+            float t = i * 0.015f;
+            dev.motion.gyro[0] = 1.0f * sinf(6.2832f * 0.7f * t);
+            dev.motion.gyro[1] = 2.5f * sinf(6.2832f * 1.1f * t);
+            dev.motion.gyro[2] = 4.0f * sinf(6.2832f * 1.6f * t);
+            hal::advanceUs(15000);
+            dev.makePacket(frame);
+            // the first second is never dropped: the filter settles first
+            if (dropLeft == 0 && i > 66 && chance(sc.lossRate))
+                dropLeft = sc.burst;
+            if (dropLeft > 0)
+            {
+                dropLeft--;
+                r.injectedLost++;
+                r.q[i].w = 2;
+                continue;
+            }
+            dev.notifyChar()->notify(frame, sizeof(frame));
+            if (i > 66 && chance(sc.dupRate))
+            {
+                dev.notifyChar()->notify(frame, sizeof(frame));
+                r.injectedDup++;
+            }
+            gear->update(0);
+            r.q[i] = gear->ahrs.quaternion();
+        }
+        r.stats = gear->linkStats();
+        return r;
+    }
+
+    void compare(const Run &ref, const Run &r, BenchStats &err)
+    {
+        for (size_t i = 0; i < r.q.size(); i++)
+        {
+            if (r.q[i].w > 1.5f || ref.q[i].w > 1.5f)
+                continue;
+            // angle of conj(a) * b; atan2 keeps small angles exact (acos of the dot does not)
+            const Quaternion &a = ref.q[i], &b = r.q[i];
+            float w = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+            float x = a.w * b.x - a.x * b.w - a.y * b.z + a.z * b.y;
+            float y = a.w * b.y + a.x * b.z - a.y * b.w - a.z * b.x;
+            float z = a.w * b.z - a.x * b.y + a.y * b.x - a.z * b.w;
+            float deg = 2.0f * atan2f(sqrtf(x * x + y * y + z * z), fabsf(w)) * 57.29578f;
+            err.add((uint32_t)(deg * 1000)); // millidegrees
+        }
+    }
+}
+
+int benchLinkLoss(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 4000;
+    if (packets <= 0)
+        packets = 4000;
+    printf("== link loss: %d packets (%.0f s), fast wrist motion; error vs the loss-free run ==\n", packets,
+           packets * 0.015f);
+    Run ref = run(kScenarios[0], packets, true);
+    for (const Scenario &sc : kScenarios)
+    {
+        Run legacy = run(sc, packets, false);
+        Run bridged = run(sc, packets, true);
+        const ContinuityStats &st = bridged.stats;
+        printf("%s: dropped %u, counted %u in %u gaps (max %u ms); repeated %u, counted %u; resyncs %u\n", sc.name,
+               bridged.injectedLost, st.lost, st.gaps, st.maxGapUs / 1000, bridged.injectedDup, st.duplicates,
+               st.resyncs);
+        if (&sc == &kScenarios[0])
+            continue;
+        BenchStats e0, e1;
+        compare(ref, legacy, e0);
+        compare(ref, bridged, e1);
+        e0.report("  gap as one step", "mdeg");
+        e1.report("  gap bridged", "mdeg");
+    }
+    return 0;
+}
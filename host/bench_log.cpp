@@ -0,0 +1,208 @@
+// Deferred logging: does the formatter reproduce printf, what a log line
+// costs at the call site (direct printf vs DLOG record), what the formatter
+// task pays per record, and whether the ring holds up with several tasks
+// logging at once.
+#include <string>
+#include <thread>
+#include "Bench.h"
+#include "DeferredLog.h"
+
+namespace
+{
+    // Print that keeps (or just counts) what it is given
+    class CaptureSink : public Print
+    {
+    public:
+        bool keep = true;
+        std::string text;
+        size_t bytes = 0;
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *buf, size_t len) override
+        {
+            bytes += len;
+            if (keep)
+                text.append((const char *)buf, len);
+            return len;
+        }
+    };
+
+    int gMismatches = 0;
+
+    template <typename... A>
+    void expectSame(DeferredLog &log, const char *fmt, A... a)
+    {
+        char ref[DeferredLog::kLineMax];
+        snprintf(ref, sizeof(ref), fmt, a...);
+        log.record(fmt, a...);
+        CaptureSink sink;
+        log.drain(sink);
+        if (sink.text != ref)
+        {
+            gMismatches++;
+            printf("  mismatch: \"%s\" vs printf \"%s\"\n", sink.text.c_str(), ref);
+        }
+    }
+
+    const char *const kMac = "c0:ff:ee:00:00:01";
+}
+
+int benchLog(int argc, char **argv)
+{
+    printf("== deferred log (ring %zu x %zu-byte payload) ==\n", DeferredLog::kCapacity,
+           DeferredLog::kPayload);
+
+    // Formatter fidelity on the formats the firmware uses, plus edge cases
+    {
+        static DeferredLog log;
+        expectSame(log, "Tick: %u\n", 123456789u);
+        expectSame(log, "Receiving controller stream (len=%u) at %u ms\n", 60u, 4242u);
+        expectSame(log, "Connecting to %s\n", kMac);
+        expectSame(log, "GearVR: sent cmd 0x%02X 0x%02X%s\n", 0x08, 0x00, " (rsp)");
+        expectSame(log, "Pairing Failed, Reason: %d\n", -3);
+        expectSame(log, "MTU set to %i\n", 517);
+        expectSame(log, "Matched after %u ms (avg %u, max %u)\n", 12u, 40u, 310u);
+        expectSame(log, "%-8s|%8s|%.3s|\n", "ab", "cd", "efghij");
+        expectSame(log, "%+05d %x %o %c %lu %lld\n", 42, 255u, 8u, 'Z', 123456ul, -9000000000ll);
+        expectSame(log, "%.2f %8.3e %g %%\n", 3.14159, 0.000123, 2.5f);
+        expectSame(log, "%u\n", -1); // int reinterpreted like printf does
+        printf("formatter vs printf: %d mismatches over 11 formats\n", gMismatches);
+    }
+
+    // Call-site cost: formatting inline (what Serial.printf does before it
+    // even reaches the UART/CDC) against a DLOG record
+    {
+        const int rounds = 200000;
+        static DeferredLog log;
+        CaptureSink sink;
+        sink.keep = false;
+        BenchStats direct, deferred, drain;
+        direct.reserve(rounds);
+        deferred.reserve(rounds);
+        drain.reserve(rounds / 16);
+        struct Line
+        {
+            const char *label;
+            int kind;
+        };
+        const Line lines[] = {{"Tick: %u", 0}, {"stream (len, ms)", 1}, {"Connecting to %s", 2}};
+        for (const Line &l : lines)
+        {
+            direct = BenchStats();
+            deferred = BenchStats();
+            drain = BenchStats();
+            for (int i = 0; i < rounds; i++)
+            {
+                uint32_t t0 = ESP.getCycleCount();
+                if (l.kind == 0)
+                    sink.printf("Tick: %u\n", (unsigned)i);
+                else if (l.kind == 1)
+                    sink.printf("Receiving controller stream (len=%u) at %u ms\n", 60u, (unsigned)i);
+                else
+                    sink.printf("Connecting to %s\n", kMac);
+                uint32_t t1 = ESP.getCycleCount();
+                if (l.kind == 0)
+                    log.record("Tick: %u\n", (unsigned)i);
+                else if (l.kind == 1)
+                    log.record("Receiving controller stream (len=%u) at %u ms\n", 60u, (unsigned)i);
+                else
+                    log.record("Connecting to %s\n", kMac);
+                uint32_t t2 = ESP.getCycleCount();
+                direct.add(t1 - t0);
+                deferred.add(t2 - t1);
+                if ((i & 15) == 15)
+                {
+                    uint32_t t3 = ESP.getCycleCount();
+                    log.drain(sink);
+                    drain.add((ESP.getCycleCount() - t3) / 16);
+                }
+            }
+            printf("%s\n", l.label);
+            direct.report("  printf (call site)", "cycles");
+            deferred.report("  DLOG record (call site)", "cycles");
+            drain.report("  formatter, per record", "cycles");
+        }
+        printf("dropped while benchmarking: %u\n", log.dropped());
+    }
+
+    // Burst with nobody draining: the ring keeps the oldest, counts the rest
+    {
+        static DeferredLog log;
+        for (unsigned i = 0; i < 200; i++)
+            log.record("burst %u\n", i);
+        CaptureSink sink;
+        log.drain(sink);
+        log.record("after\n");
+        log.drain(sink);
+        size_t firstDrop = sink.text.find("[log]");
+        printf("burst of 200: kept %zu, dropped %u, reported as \"%s\"\n",
+               DeferredLog::kCapacity, log.dropped(),
+               firstDrop == std::string::npos
+                   ? "-"
+                   : sink.text.substr(firstDrop, sink.text.find('\n', firstDrop) - firstDrop).c_str());
+    }
+
+    // Four producers and a consumer running concurrently: nothing torn,
+    // nothing duplicated, per-producer order kept. The producers retry on a
+    // full ring (firmware call sites just drop) so every record is checked.
+    {
+        static DeferredLog log;
+        const unsigned producers = 4, each = argc > 0 ? (unsigned)atoi(argv[0]) : 200000;
+        std::atomic<bool> done(false);
+        unsigned last[producers] = {};
+        bool ordered = true;
+        uint64_t lines = 0;
+        class Check : public Print
+        {
+        public:
+            unsigned *last;
+            bool *ordered;
+            uint64_t *lines;
+            size_t write(uint8_t) override { return 1; }
+            size_t write(const uint8_t *buf, size_t len) override
+            {
+                unsigned p, seq;
+                char tmp[64];
+                size_t n = len < sizeof(tmp) - 1 ? len : sizeof(tmp) - 1;
+                memcpy(tmp, buf, n);
+                tmp[n] = 0;
+                if (sscanf(tmp, "p%u #%u", &p, &seq) == 2 && p < 4)
+                {
+                    if (seq <= last[p] && last[p] != 0)
+                        *ordered = false;
+                    last[p] = seq;
+                    (*lines)++;
+                }
+                return len;
+            }
+        } check;
+        check.last = last;
+        check.ordered = &ordered;
+        check.lines = &lines;
+
+        std::thread consumer([&]() {
+            while (!done.load())
+                if (!log.drain(check))
+                    std::this_thread::yield();
+            while (log.drain(check))
+            {
+            }
+        });
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; p++)
+            threads.emplace_back([p, each]() {
+                for (unsigned i = 1; i <= each; i++)
+                    while (!log.record("p%u #%u %s\n", p, i, kMac))
+                        std::this_thread::yield();
+            });
+        for (auto &t : threads)
+            t.join();
+        done = true;
+        consumer.join();
+        printf("%u producers x %u: recorded %u, ring full %u times, formatted %llu, order %s, total %s\n",
+               producers, each, log.recorded(), log.dropped(), (unsigned long long)lines,
+               ordered ? "kept" : "BROKEN",
+               log.recorded() == producers * each && lines == log.recorded() ? "ok" : "MISMATCH");
+    }
+    return gMismatches ? 1 : 0;
+}
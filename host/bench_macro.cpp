@@ -0,0 +1,288 @@
+// Timed multi-key actions (MacroSequencer behind HidOut.play()):
+//  - input path: time spent in the binding stage on a Touch Up (Alt+Tab)
+//    edge, the old flush + delay(10) against the macro, wall clock
+//  - timeline: reports and timestamps of the Alt+Tab chord, virtual time
+//  - many in flight: kMaxMacros macros at once, one more refused, waits
+//    longer than a wheel turn
+//  - link lost: one source's macros cancelled (releaseAll(source)) between
+//    service passes, the other sources' still on time
+//  - accuracy: random macros served by a loop that sleeps on
+//    HidOut.usUntilNext(), as the BLE task does; how late the timed steps ran
+//
+//   universal_host macro [macros]   (default 2000)
+#include <thread>
+#include "Bench.h"
+#include "Bindings.h"
+#include "GearVR.h"
+#include "HID.h"
+#include "HidOutput.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint16_t kUsageA = 0x04; // keyboard page: a..z are 0x04..0x1D
+    constexpr uint16_t kUsageZ = 0x1D;
+    constexpr uint16_t kUsageLeftShift = 0xE1;
+
+    // The Key branch of InputBindings::fire() before the sequencer
+    void legacyChord(uint8_t modifiers, uint8_t key)
+    {
+        for (uint8_t m = 0; m < 8; m++)
+            if (modifiers & (1u << m))
+                HidOut.keyPress((uint8_t)(0xE0 + m));
+        HidOut.flush(micros());
+        delay(10);
+        HidOut.keyPress(key);
+    }
+
+    void useDefaults(InputBindings &b)
+    {
+        b.set(GearVR::kDefaultBindings, GearVR::kDefaultBindingCount);
+    }
+
+    std::vector<hal::HidReport> keyboardReports()
+    {
+        std::vector<hal::HidReport> v;
+        for (const hal::HidReport &r : hal::hid.snapshot())
+            if (r.iface == hal::kHidKeyboard)
+                v.push_back(r);
+        return v;
+    }
+
+    void printLate(const MacroStats &s)
+    {
+        static const char *kBucket[MacroStats::kLateBuckets] = {"<0.25", "<0.5", "<1", "<2", "<4", "<8", ">=8"};
+        printf("  %u timed steps late by mean %u us, max %u us\n  ms:", s.timedSteps, s.lateMeanUs(), s.lateMaxUs);
+        for (uint8_t b = 0; b < MacroStats::kLateBuckets; b++)
+            printf(" %s:%u", kBucket[b], s.late[b]);
+        printf("\n");
+    }
+
+    bool inputPath()
+    {
+        printf("-- input path: Touch Up edge (Alt+Tab), wall clock --\n");
+        hal::useRealTime();
+        const uint8_t alt = 1u << (KEYUSAGE_LEFT_ALT - 0xE0);
+        BenchStats legacy, macro;
+        for (int i = 0; i < 20; i++)
+        {
+            HidOut = HidOutput();
+            uint64_t t0 = benchNowNs();
+            legacyChord(alt, KEYUSAGE_TAB);
+            legacy.add((uint32_t)((benchNowNs() - t0) / 1000));
+            HidOut.keyReleaseAll();
+
+            HidOut = HidOutput();
+            InputBindings b;
+            useDefaults(b);
+            t0 = benchNowNs();
+            b.process(kGestureUp);
+            macro.add((uint32_t)((benchNowNs() - t0) / 1000));
+        }
+        legacy.report("flush + delay(10)", "us");
+        macro.report("macro", "us");
+        return true;
+    }
+
+    bool timeline()
+    {
+        printf("-- timeline: Touch Up held 40 ms, service pass every 250 us --\n");
+        const uint32_t t0 = 1000000;
+        hal::setTimeUs(t0);
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        InputBindings b;
+        useDefaults(b);
+        for (uint32_t us = 0; us < 60000; us += 250)
+        {
+            if (us == 0)
+                b.process(kGestureUp);
+            if (us == 40000)
+                b.process(0);
+            HidOut.flush(micros());
+            hal::advanceUs(250);
+        }
+        std::vector<hal::HidReport> v = keyboardReports();
+        hal::hid.keep = false;
+        for (const hal::HidReport &r : v)
+            printf("  +%5.2f ms  modifiers %02x  key %02x\n", (r.us - t0) / 1000.0f, r.data[0], r.data[2]);
+        bool ok = v.size() == 3 && v[0].us == t0 && v[0].data[0] == 0x04 && v[0].data[2] == 0 &&
+                  v[1].us == t0 + InputBindings::kModifierLeadMs * 1000 && v[1].data[0] == 0x04 &&
+                  v[1].data[2] == KEYUSAGE_TAB && v[2].us == t0 + 40000 && v[2].data[0] == 0 && v[2].data[2] == 0;
+
+        // Released before the key went out: the key never goes out
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        b.reset();
+        b.process(kGestureUp);
+        for (uint32_t us = 0; us < 20000; us += 250)
+        {
+            if (us == 5000)
+                b.process(0);
+            HidOut.flush(micros());
+            hal::advanceUs(250);
+        }
+        v = keyboardReports();
+        hal::hid.keep = false;
+        bool early = v.size() == 2 && v[0].data[0] == 0x04 && v[1].data[0] == 0 && v[1].data[2] == 0 &&
+                     HidOut.macroStats().cancelled == 1;
+        printf("  %s; released after 5 ms: %zu reports, Tab %s\n", ok ? "as expected" : "UNEXPECTED", v.size(),
+               early ? "never sent" : "SENT");
+        return ok && early;
+    }
+
+    bool inFlight()
+    {
+        printf("-- %u macros in flight, service pass every 1 ms --\n", MacroSequencer::kMaxMacros);
+        const uint32_t t0 = 2000000;
+        hal::setTimeUs(t0);
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        MacroId ids[MacroSequencer::kMaxMacros];
+        for (uint8_t i = 0; i < MacroSequencer::kMaxMacros; i++)
+        {
+            // staggered key presses, the last one waits three wheel turns
+            const uint16_t wait = i + 1 == MacroSequencer::kMaxMacros ? 3 * MacroSequencer::kWheelSlots + 5 : 7 * (i + 1);
+            const MacroStep steps[] = {
+                {MacroOp::Wait, wait},
+                {MacroOp::KeyPress, (uint16_t)(kUsageA + i)},
+                {MacroOp::Wait, 3},
+                {MacroOp::KeyRelease, (uint16_t)(kUsageA + i)},
+            };
+            ids[i] = HidOut.play(steps, 4, i);
+        }
+        const MacroStep one[] = {{MacroOp::KeyPress, kUsageZ}};
+        bool refused = HidOut.play(one, 1) == MacroSequencer::kNoMacro;
+        for (uint32_t ms = 0; ms < 300; ms++)
+        {
+            HidOut.flush(micros());
+            hal::advanceUs(1000);
+        }
+        std::vector<hal::HidReport> v = keyboardReports();
+        hal::hid.keep = false;
+
+        // each key down at t0 + its wait, up 3 ms later
+        bool ok = v.size() == 2u * MacroSequencer::kMaxMacros && ids[0] != MacroSequencer::kNoMacro;
+        for (size_t k = 0; ok && k < v.size(); k++)
+        {
+            const uint8_t i = (uint8_t)(k / 2);
+            const uint32_t wait = i + 1 == MacroSequencer::kMaxMacros ? 3 * MacroSequencer::kWheelSlots + 5 : 7 * (i + 1);
+            const uint32_t at = t0 + (wait + (k % 2 ? 3 : 0)) * 1000;
+            const uint8_t key = k % 2 ? 0 : (uint8_t)(kUsageA + i);
+            ok = v[k].us == at && v[k].data[2] == key;
+        }
+        const MacroStats &s = HidOut.macroStats();
+        printf("  started %u, finished %u, refused %u; %zu keyboard reports %s, late max %u us; ninth %s\n",
+               s.started, s.finished, s.rejected, v.size(), ok ? "on time" : "WRONG", s.lateMaxUs,
+               refused ? "refused" : "ACCEPTED");
+        return ok && refused && s.finished == MacroSequencer::kMaxMacros && s.lateMaxUs == 0;
+    }
+
+    bool linkLost()
+    {
+        printf("-- link lost: source 1 released while 4 sources have macros waiting --\n");
+        const uint32_t t0 = 3000000;
+        hal::setTimeUs(t0);
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            const MacroStep steps[] = {
+                {MacroOp::Wait, (uint16_t)(5 + 5 * i)},
+                {MacroOp::KeyPress, (uint16_t)(kUsageA + i)},
+                {MacroOp::Wait, 10},
+                {MacroOp::KeyRelease, (uint16_t)(kUsageA + i)},
+            };
+            HidOut.play(steps, 4, i);
+        }
+        for (uint32_t ms = 0; ms < 60; ms++)
+        {
+            // what GearVR::onDisconnected() does for slot 1, on the flushing task
+            if (ms == 7)
+                HidOut.releaseAll(1);
+            HidOut.flush(micros());
+            hal::advanceUs(1000);
+        }
+        std::vector<hal::HidReport> v = keyboardReports();
+        hal::hid.keep = false;
+        uint8_t seen = 0;
+        for (const hal::HidReport &r : v)
+            for (uint8_t k = 2; k < 8; k++)
+                if (r.data[k] >= kUsageA && r.data[k] < kUsageA + 4)
+                    seen |= (uint8_t)(1u << (r.data[k] - kUsageA));
+        const MacroStats &s = HidOut.macroStats();
+        bool ok = seen == 0x0D && s.finished == 3 && s.cancelled == 1 && HidOut.usUntilNext(micros()) == UINT32_MAX &&
+                  !v.empty() && v.back().data[2] == 0;
+        printf("  keys on the wire %c%c%c%c, finished %u, cancelled %u, wheel %s -> %s\n", seen & 1 ? 'a' : '-',
+               seen & 2 ? 'b' : '-', seen & 4 ? 'c' : '-', seen & 8 ? 'd' : '-', s.finished, s.cancelled,
+               HidOut.usUntilNext(micros()) == UINT32_MAX ? "empty" : "NOT EMPTY", ok ? "ok" : "WRONG");
+        return ok;
+    }
+
+    bool accuracy(int macros)
+    {
+        printf("-- accuracy: %d random macros, wall clock, loop sleeping on usUntilNext() --\n", macros);
+        hal::useRealTime();
+        HidOut = HidOutput();
+        uint32_t rng = 0x5eed;
+        auto next = [&rng](uint32_t n) {
+            rng = rng * 1664525u + 1013904223u;
+            return (rng >> 8) % n;
+        };
+        int started = 0;
+        uint32_t nextStart = micros();
+        BenchStats sleeps;
+        while (started < macros || HidOut.macroStats().finished + HidOut.macroStats().cancelled < (uint32_t)started)
+        {
+            uint32_t now = micros();
+            if (started < macros && (int32_t)(now - nextStart) >= 0)
+            {
+                const uint16_t key = (uint16_t)(kUsageA + next(26));
+                const MacroStep steps[] = {
+                    {MacroOp::KeyPress, kUsageLeftShift},
+                    {MacroOp::Wait, (uint16_t)(1 + next(20))},
+                    {MacroOp::KeyPress, key},
+                    {MacroOp::Wait, (uint16_t)(1 + next(5))},
+                    {MacroOp::KeyRelease, key},
+                    {MacroOp::KeyRelease, kUsageLeftShift},
+                };
+                if (HidOut.play(steps, 6, (uint8_t)(started % HidOutput::kSources)) != MacroSequencer::kNoMacro)
+                    started++;
+                nextStart = now + 500 + next(4000);
+            }
+            HidOut.flush(micros());
+            now = micros();
+            uint32_t wait = min(HidOut.usUntilNext(now), (uint32_t)(nextStart - now));
+            if (started == macros)
+                wait = HidOut.usUntilNext(now);
+            if (wait && wait != UINT32_MAX)
+            {
+                sleeps.add(wait);
+                std::this_thread::sleep_for(std::chrono::microseconds(wait));
+            }
+        }
+        const MacroStats &s = HidOut.macroStats();
+        printf("  started %u, finished %u, refused %u\n", s.started, s.finished, s.rejected);
+        printLate(s);
+        sleeps.report("service loop sleeps", "us");
+        return s.finished == (uint32_t)macros;
+    }
+}
+
+int benchMacro(int argc, char **argv)
+{
+    int macros = argc > 0 ? atoi(argv[0]) : 2000;
+    if (macros <= 0)
+        macros = 2000;
+    printf("== macro: timed multi-key actions ==\n");
+    bool ok = inputPath();
+    ok = timeline() && ok;
+    ok = inFlight() && ok;
+    ok = linkLost() && ok;
+    ok = accuracy(macros) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// Several controllers on one adapter: N fake Gear VRs advertise, the manager
+// links each to a slot of its own, then
+//  - throughput: every peripheral notifies as fast as its slot's ring takes
+//    frames (real time, one producer thread each, the manager on another);
+//    aggregate frames/s and each link's share of them
+//  - merge: two controllers hold the trigger over overlapping spans; the
+//    host must see one press and one release, motion from both
+//
+//   universal_host multi [max controllers]   (default 3)
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint32_t kAdvertiseMs = 100;
+    constexpr uint32_t kStreamMs = 1000; // saturated streaming per run
+
+    struct Rig
+    {
+        std::vector<std::unique_ptr<FakeGearVR>> devs;
+        std::vector<std::unique_ptr<GearVR>> gears;
+        std::unique_ptr<BLEManager<>> mgr;
+        size_t clients = 0;
+
+        explicit Rig(size_t n)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                devs.emplace_back(new FakeGearVR());
+                gears.emplace_back(new GearVR());
+            }
+            // slot i is created i-th: its client is controller i
+            BLEDevice::setClientFactory([this]() { return devs[clients++]->client(); });
+            Preferences::eraseAll();
+            hal::enableTasks(false);
+            mgr.reset(new BLEManager<>());
+            for (auto &g : gears)
+                mgr->registerHandler(g.get());
+            mgr->init();
+        }
+
+        ~Rig()
+        {
+            for (auto &d : devs)
+                d->client()->disconnect();
+            mgr.reset();
+            BLEDevice::setClientFactory(nullptr);
+        }
+
+        // Virtual time: controllers advertise (in slot order) until all are linked
+        uint32_t connectAll(uint32_t limitMs)
+        {
+            BLEScan *scan = BLEDevice::getScan();
+            uint32_t start = millis(), windowStart = start, starts = scan->startCalls();
+            while (mgr->links() < devs.size() && millis() - start < limitMs)
+            {
+                uint32_t now = millis();
+                if (scan->startCalls() != starts)
+                {
+                    starts = scan->startCalls();
+                    windowStart = now;
+                }
+                if (scan->isScanning() && now % kAdvertiseMs == 0)
+                    for (size_t i = 0; i < devs.size(); i++)
+                    {
+                        if (mgr->connected(i))
+                            continue;
+                        BLEAdvertisedDevice adv;
+                        uint8_t mac[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, (uint8_t)(i + 1)};
+                        adv.setName("Gear VR Controller(ABCD)");
+                        adv.setAddress(BLEAddress(mac));
+                        scan->deliver(adv);
+                    }
+                if (scan->isScanning() && now - windowStart >= scan->lastDuration() * 1000)
+                    scan->complete();
+                mgr->update(1);
+                if (millis() == now)
+                    hal::advanceUs(1000);
+            }
+            return millis() - start;
+        }
+    };
+
+    struct Throughput
+    {
+        uint32_t frames = 0;
+        uint32_t minShare = UINT32_MAX, maxShare = 0;
+        uint32_t highWater = 0;
+        uint32_t reports = 0;
+        uint64_t ns = 0;
+    };
+
+    // Real time: each peripheral notifies whenever its ring has room, the
+    // manager runs update() whenever msUntilNext() says there is work
+    Throughput saturate(Rig &rig)
+    {
+        hal::useRealTime();
+        HidOut = HidOutput();
+        hal::hid.keep = false;
+        std::vector<uint32_t> before;
+        for (auto &g : rig.gears)
+            before.push_back(g->joy.state.updateCounts);
+
+        std::atomic<bool> run{true};
+        std::thread service([&]() {
+            uint32_t last = millis();
+            while (run)
+            {
+                uint32_t now = millis();
+                if (rig.mgr->msUntilNext(now) != 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                rig.mgr->update(now - last);
+                last = now;
+            }
+        });
+        std::vector<std::thread> producers;
+        uint64_t t0 = benchNowNs();
+        for (size_t i = 0; i < rig.devs.size(); i++)
+            producers.emplace_back([&rig, &run, i]() {
+                FakeGearVR &dev = *rig.devs[i];
+                const GearVR::RxRing &rx = rig.gears[i]->rx();
+                uint32_t n = 0;
+                while (run)
+                {
+                    if (rx.size() >= rx.capacity())
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    dev.motion.touchX = (uint16_t)(160 + 80 * cosf(n * 0.05f));
+                    dev.motion.touchY = (uint16_t)(160 + 80 * sinf(n * 0.05f));
+                    dev.sendPacket();
+                    n++;
+                }
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(kStreamMs));
+        run = false;
+        for (std::thread &t : producers)
+            t.join();
+        service.join();
+
+        Throughput r;
+        r.ns = benchNowNs() - t0;
+        for (size_t i = 0; i < rig.gears.size(); i++)
+        {
+            uint32_t n = rig.gears[i]->joy.state.updateCounts - before[i];
+            r.frames += n;
+            r.minShare = min(r.minShare, n);
+            r.maxShare = max(r.maxShare, n);
+            r.highWater = max(r.highWater, rig.gears[i]->rx().highWater());
+        }
+        r.reports = HidOut.stats().totalSent();
+        return r;
+    }
+
+    // Virtual time, two controllers at the real frame rate: A holds the
+    // trigger over packets [20, 60), B over [40, 90)
+    bool mergeButtons()
+    {
+        hal::setTimeUs(50000000);
+        Rig rig(2);
+        if (rig.connectAll(10000) < 10000 && rig.mgr->links() != 2)
+            return false;
+        HidOut = HidOutput();
+        hal::hid.clear();
+        hal::hid.keep = true;
+        for (int i = 0; i < 120; i++)
+        {
+            for (size_t c = 0; c < 2; c++)
+            {
+                FakeGearVR::Motion &m = rig.devs[c]->motion;
+                int from = c == 0 ? 20 : 40, to = c == 0 ? 60 : 90;
+                m.buttons = i >= from && i < to ? 0x01 : 0x00;
+                // both thumbs on the pad, moving opposite ways along x
+                m.touchX = (uint16_t)(c == 0 ? 100 + i : 260 - i);
+                m.touchY = 160;
+                rig.devs[c]->sendPacket();
+            }
+            for (int ms = 0; ms < 15; ms++)
+            {
+                rig.mgr->update(1);
+                hal::advanceUs(1000);
+            }
+        }
+        std::vector<hal::HidReport> log = hal::hid.snapshot();
+        hal::hid.keep = false;
+
+        int presses = 0, releases = 0;
+        uint8_t held = 0;
+        uint32_t downUs = 0, upUs = 0;
+        for (const hal::HidReport &r : log)
+        {
+            if (r.iface != hal::kHidMouse)
+                continue;
+            uint8_t b = r.data[0] & 0x01;
+            if (b && !held)
+            {
+                presses++;
+                downUs = r.us;
+            }
+            if (!b && held)
+            {
+                releases++;
+                upUs = r.us;
+            }
+            held = b;
+        }
+        const HidOutputStats &st = HidOut.stats();
+        printf("merge: A holds the trigger for packets 20..59, B for 40..89\n");
+        printf("  host saw %d press, %d release, held %.0f ms (expected 1, 1, 1050 ms); %u mouse reports\n", presses,
+               releases, (upUs - downUs) / 1000.0, st.sent[kHidStreamMouse]);
+        return presses == 1 && releases == 1;
+    }
+}
+
+int benchMulti(int argc, char **argv)
+{
+    size_t most = argc > 0 ? (size_t)atoi(argv[0]) : 3;
+    if (most < 1 || most > BLEManagerBase::kMaxLinks)
+        most = 3;
+    printf("== multi: up to %zu controllers, one slot each ==\n", most);
+    bool ok = true;
+    for (size_t n = 1; n <= most; n++)
+    {
+        hal::setTimeUs(1000000);
+        Rig rig(n);
+        uint32_t ms = rig.connectAll(10000);
+        if (rig.mgr->links() != n)
+        {
+            printf("%zu controllers: only %zu linked after %u ms\n", n, rig.mgr->links(), ms);
+            ok = false;
+            continue;
+        }
+        Throughput t = saturate(rig);
+        double secs = t.ns / 1e9;
+        printf("%zu controller%s: linked in %u ms; %.0f frames/s aggregate (%.0f per link), share min/max "
+               "%.1f%%/%.1f%%, ring high water %u/%zu, %.0f HID reports/s\n",
+               n, n > 1 ? "s" : " ", ms, t.frames / secs, t.frames / secs / n, 100.0 * t.minShare / t.frames,
+               100.0 * t.maxShare / t.frames, t.highWater, GearVR::RxRing::capacity(), t.reports / secs);
+    }
+    ok = mergeButtons() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Per-packet cost of GearVR::onNotify (callback side) and of the main-loop
+// drain (parseFullPacket -> emitUSB) against a fake controller and recording
+// HID sinks.
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "HidOutput.h"
+#include "USBHID.h"
+
+namespace
+{
+    // Deterministic input script: slow wrist motion, a circling thumb on the
+    // touchpad and periodic trigger / volume presses.
+    void scriptMotion(FakeGearVR &dev, int i)
+    {
+        FakeGearVR::Motion &m = dev.motion;
+        m.gyro[0] = 0.3f * sinf(i * 0.013f);
+        m.gyro[1] = 0.8f * sinf(i * 0.021f);
+        m.gyro[2] = 2.0f * sinf(i * 0.017f);
+        m.linearAccel[0] = 0.5f * sinf(i * 0.011f);
+        if (i % 200 < 150)
+        {
+            m.touchX = (uint16_t)(160 + 80 * cosf(i * 0.05f));
+            m.touchY = (uint16_t)(160 + 80 * sinf(i * 0.05f));
+        }
+        else
+        {
+            m.touchX = m.touchY = 0;
+        }
+        m.buttons = 0;
+        if ((i / 64) % 2)
+            m.buttons |= 0x01; // trigger
+        if (i % 500 < 10)
+            m.buttons |= 0x10; // volume up
+    }
+}
+
+int benchPipeline(int argc, char **argv)
+{
+    int packets = argc > 0 ? atoi(argv[0]) : 200000;
+    if (packets <= 0)
+        packets = 200000;
+
+    hal::setTimeUs(1000000);
+    FakeGearVR dev;
+    GearVR gear;
+    gear.onConnected(dev.client());
+    gear.update(0); // flush the queued Sensor request
+
+    // Warm up caches/branch predictors
+    for (int i = 0; i < 1000; i++)
+    {
+        scriptMotion(dev, i);
+        hal::advanceUs(15000);
+        dev.sendPacket();
+        gear.update(0);
+    }
+    hal::hid.clear();
+    HidOutputStats hid0 = HidOut.stats();
+
+    BenchStats cycles, nanos, drainCycles;
+    cycles.reserve(packets);
+    nanos.reserve(packets);
+    drainCycles.reserve(packets);
+    uint8_t frame[60];
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < packets; i++)
+    {
+        scriptMotion(dev, i);
+        hal::advanceUs(15000); // controller frame spacing: each drain is a new USB frame
+        dev.makePacket(frame);
+        uint64_t n0 = benchNowNs();
+        uint32_t c0 = ESP.getCycleCount();
+        dev.notifyChar()->notify(frame, sizeof(frame));
+        uint32_t c1 = ESP.getCycleCount();
+        uint64_t n1 = benchNowNs();
+        gear.update(0);
+        uint32_t c2 = ESP.getCycleCount();
+        cycles.add(c1 - c0);
+        nanos.add((uint32_t)(n1 - n0));
+        drainCycles.add(c2 - c1);
+    }
+    uint64_t t1 = benchNowNs();
+
+    printf("== pipeline: %d packets, %.1f kpkt/s ==\n", packets, packets * 1e6 / (double)(t1 - t0));
+    cycles.report("onNotify (callback)", "cycles");
+    nanos.report("onNotify (callback)", "ns");
+    drainCycles.report("update (parse+emit)", "cycles");
+    printf("rx ring: pushed=%u overflows=%u highWater=%u/%u\n", gear.rx().pushed(),
+           gear.rx().overflows(), gear.rx().highWater(), (unsigned)GearVR::RxRing::capacity());
+    printf("HID reports: mouse=%u keyboard=%u consumer=%u (%.2f per packet)\n",
+           hal::hid.reports[hal::kHidMouse], hal::hid.reports[hal::kHidKeyboard],
+           hal::hid.reports[hal::kHidConsumer], hal::hid.total() / (double)packets);
+    HidOutputStats hs = HidOut.stats();
+    for (int k = 0; k < kHidStreams; k++)
+    {
+        hs.sent[k] -= hid0.sent[k];
+        hs.suppressed[k] -= hid0.suppressed[k];
+    }
+    printf("HID output: sent=%u suppressed=%u (mouse %u/%u, keyboard %u/%u, consumer %u/%u) busy=%u dropped=%u\n",
+           hs.totalSent(), hs.totalSuppressed(), hs.sent[kHidStreamMouse], hs.suppressed[kHidStreamMouse],
+           hs.sent[kHidStreamKeyboard], hs.suppressed[kHidStreamKeyboard], hs.sent[kHidStreamConsumer],
+           hs.suppressed[kHidStreamConsumer], hs.busy, hs.dropped);
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Touchpad pointer shaping per setting: jitter at rest, slow drags, lag
+// behind a fast flick and step latency. Input is the integer pad position at
+// the controller's packet rate; "legacy" is the old per-packet integer delta
+// with its |d| > 1 deadzone.
+#include "Bench.h"
+#include "Pointer.h"
+
+namespace
+{
+    constexpr float kDt = 3 * 4750e-6f; // one packet, three IMU subsamples
+    constexpr float kHz = 1.0f / kDt;
+
+    struct Setting
+    {
+        const char *label;
+        bool legacy;
+        PointerTuning tuning;
+    };
+
+    struct Lcg
+    {
+        uint32_t s = 0x2468ace1;
+        int jitter() // -1, 0 or +1 pad count
+        {
+            s = s * 1664525u + 1013904223u;
+            return (int)((s >> 16) % 3) - 1;
+        }
+    };
+
+    // Feeds positions, accumulates the emitted counts
+    struct Runner
+    {
+        const Setting &set;
+        PointerPath path;
+        int lastX = 0, lastY = 0;
+        bool primed = false;
+        long outX = 0, outY = 0;
+        uint64_t cycles = 0;
+        uint32_t steps = 0;
+
+        explicit Runner(const Setting &s) : set(s) {}
+
+        void feed(int x, int y)
+        {
+            int mx = 0, my = 0;
+            uint32_t c0 = ESP.getCycleCount();
+            if (set.legacy)
+            {
+                int dx = x - lastX, dy = y - lastY;
+                if (primed && (abs(dx) > 1 || abs(dy) > 1))
+                {
+                    mx = dx;
+                    my = dy;
+                }
+                lastX = x;
+                lastY = y;
+                primed = true;
+            }
+            else
+            {
+                path.track((float)x, (float)y, kDt, set.tuning, mx, my);
+            }
+            cycles += ESP.getCycleCount() - c0;
+            steps++;
+            outX += mx;
+            outY += my;
+        }
+    };
+
+    void run(const Setting &set)
+    {
+        Lcg rng;
+
+        // Resting thumb: +/-1 count of sensor noise for 30 s
+        Runner rest(set);
+        long travel = 0;
+        long px = 0, py = 0;
+        for (int i = 0; i < (int)(30 * kHz); i++)
+        {
+            rest.feed(160 + rng.jitter(), 160 + rng.jitter());
+            travel += labs(rest.outX - px) + labs(rest.outY - py);
+            px = rest.outX;
+            py = rest.outY;
+        }
+
+        // Steady slow drag, 12 counts/s for 5 s (under one count per packet)
+        Runner slow(set);
+        const float slowCps = 12.0f;
+        int slowN = (int)(5 * kHz);
+        for (int i = 0; i <= slowN; i++)
+            slow.feed(100 + (int)lrintf(slowCps * i * kDt), 160);
+        float slowIn = slowCps * slowN * kDt;
+
+        // Flick at 1500 counts/s for 0.15 s: lag of the output behind the finger
+        Runner flick(set);
+        const float flickCps = 1500.0f;
+        for (int i = 0; i < 10; i++)
+            flick.feed(40, 160);
+        float lagMs = 0, in = 0;
+        int flickN = (int)(0.15f * kHz);
+        for (int i = 1; i <= flickN; i++)
+        {
+            in = flickCps * i * kDt;
+            flick.feed(40 + (int)lrintf(in), 160);
+            lagMs = (in - flick.outX) / flickCps * 1000.0f;
+        }
+        char flickText[32];
+        if (set.tuning.curve.accel > 0) // output is scaled: lag is not comparable
+            snprintf(flickText, sizeof(flickText), "flick gain %5.2fx", flick.outX / in);
+        else
+            snprintf(flickText, sizeof(flickText), "flick lag %5.1f ms", lagMs);
+
+        // Step of 100 counts: time until 90% of it has been sent
+        Runner step(set);
+        for (int i = 0; i < 10; i++)
+            step.feed(100, 160);
+        int stepPackets = 0;
+        while (step.outX < 90 && stepPackets < 200)
+        {
+            step.feed(200, 160);
+            stepPackets++;
+        }
+
+        printf("%-22s rest %6.1f counts/s  slow %5.1f/%4.1f counts  %s  step90 %5.1f ms  %4.0f cycles\n",
+               set.label, travel / 30.0f, (float)slow.outX, slowIn, flickText, stepPackets * kDt * 1000.0f,
+               (double)(rest.cycles + slow.cycles + flick.cycles + step.cycles) /
+                   (rest.steps + slow.steps + flick.steps + step.steps));
+    }
+}
+
+int benchPointer(int argc, char **argv)
+{
+    AccelCurve accel;
+    accel.accel = 1.0f;
+    accel.thresholdCps = 300.0f;
+
+    const Setting settings[] = {
+        {"legacy (|d|>1, int)", true, {}},
+        {"carry only", false, {{0.0f, 0.0f, 1.0f}, AccelCurve()}},
+        {"one euro 1 Hz b0.05", false, {{1.0f, 0.05f, 1.0f}, AccelCurve()}},
+        {"one euro 0.5 Hz b0.02", false, {{0.5f, 0.02f, 1.0f}, AccelCurve()}},
+        {"one euro 2 Hz b0.1", false, {{2.0f, 0.1f, 1.0f}, AccelCurve()}},
+        {"1 Hz b0.05 + accel", false, {{1.0f, 0.05f, 1.0f}, accel}},
+    };
+
+    printf("== pointer (touchpad, packet every %.2f ms; rest = counts/s moved while resting) ==\n",
+           kDt * 1000.0f);
+    for (const Setting &s : settings)
+        run(s);
+    return 0;
+}
@@ -0,0 +1,258 @@
+// Orientation prediction offline: replay a trace through the handler, and at
+// each packet extrapolate the fused attitude by h ms; the error is the angle
+// to the attitude the filter actually reached h ms later (interpolated
+// between packets). Hold is the unpredicted pointer, i.e. what latency costs.
+//
+//   universal_host predict               synthetic flicks, jittered arrival
+//   universal_host predict file.gvc      a recorded capture (writes the
+//                                        synthetic one there if missing)
+#include <algorithm>
+#include <memory>
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "PacketCapture.h"
+
+namespace
+{
+    const int kHorizonsMs[] = {0, 5, 10, 15, 20, 30, 45};
+
+    struct Frame
+    {
+        uint32_t sensorUs;
+        uint32_t stampUs;
+        OrientationPredictor p; // state after this packet
+    };
+
+    // Wrist flicks: minimum-jerk yaw/pitch moves of 150..400 ms, random size,
+    // with holds between; arrival jittered over a connection interval
+    void recordFlicks(int packets, std::vector<uint8_t> &out)
+    {
+        hal::setTimeUs(1000000);
+        FakeGearVR dev;
+        dev.subsampleUs = 5000; // device clock in step with the 15 ms packets
+        dev.motion.gyroNoise = 3;
+        std::unique_ptr<GearVR> gear(new GearVR());
+        static PacketCapture cap;
+        MemorySink sink;
+        cap.begin(sink, false);
+        gear->setCapture(&cap);
+        gear->onConnected(dev.client());
+
+        uint32_t rng = 0x51f15e;
+        auto uniform = [&rng]() {
+            rng = rng * 1664525u + 1013904223u;
+            return (rng >> 8) * (1.0f / 16777216.0f);
+        };
+        float moveT = 0, moveLen = 0, yawAmp = 0, pitchAmp = 0, hold = 0.5f;
+        uint32_t due = micros();
+        for (int i = 0; i < packets; i++)
+        {
+            const float dt = 0.015f;
+            FakeGearVR::Motion &m = dev.motion;
+            if (moveLen == 0)
+            {
+                m.gyro[1] = m.gyro[2] = 0;
+                hold -= dt;
+                if (hold <= 0)
+                {
+                    moveT = 0;
+                    moveLen = 0.15f + 0.25f * uniform();
+                    yawAmp = (uniform() - 0.5f) * 1.4f; // +/- 40 deg
+                    pitchAmp = (uniform() - 0.5f) * 0.7f;
+                }
+            }
+            else
+            {
+                // Minimum-jerk speed profile: 30 s^2 (1 - s)^2 / T
+                moveT += dt;
+                float s = moveT / moveLen;
+                if (s >= 1)
+                {
+                    moveLen = 0;
+                    hold = 0.1f + 0.5f * uniform();
+                    s = 1;
+                }
+                float v = 30.0f * s * s * (1 - s) * (1 - s) / (moveLen ? moveLen : 1);
+                m.gyro[2] = yawAmp * v;
+                m.gyro[1] = pitchAmp * v;
+            }
+            due += 15000;
+            uint32_t at = due + (uint32_t)(uniform() * 7500);
+            if ((int32_t)(at - micros()) > 0)
+                hal::setTimeUs(at);
+            dev.sendPacket();
+            gear->update(0);
+            if ((i & 15) == 15)
+                cap.drain();
+        }
+        cap.end();
+        cap.drain();
+        out = sink.bytes;
+    }
+
+    // Replay frame by frame, keeping the predictor after each full packet
+    std::vector<Frame> replay(const std::vector<uint8_t> &bytes)
+    {
+        std::vector<Frame> frames;
+        MemoryStream in(bytes);
+        CaptureReader reader(in);
+        if (!reader.begin())
+            return frames;
+        std::unique_ptr<GearVR> gear(new GearVR());
+        CaptureRecord r;
+        bool first = true;
+        while (reader.next(r))
+        {
+            if (r.tx)
+                continue;
+            if (first)
+            {
+                hal::setTimeUs(r.stampUs);
+                first = false;
+            }
+            else if ((int32_t)(r.stampUs - micros()) > 0)
+                hal::setTimeUs(r.stampUs);
+            uint32_t updates = gear->joy.state.updateCounts;
+            gear->feedNotify(r.data, r.len);
+            gear->update(0);
+            if (gear->joy.state.updateCounts == updates)
+                continue; // command request frame
+            Frame f;
+            f.sensorUs = gear->joy.now().sensor_time[2];
+            f.stampUs = r.stampUs;
+            f.p = gear->predictor();
+            frames.push_back(f);
+        }
+        return frames;
+    }
+
+    float angleDeg(const Quaternion &a, const Quaternion &b)
+    {
+        float w = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+        float x = a.w * b.x - a.x * b.w - a.y * b.z + a.z * b.y;
+        float y = a.w * b.y + a.x * b.z - a.y * b.w - a.z * b.x;
+        float z = a.w * b.z - a.x * b.y + a.y * b.x - a.z * b.w;
+        return 2.0f * atan2f(sqrtf(x * x + y * y + z * z), fabsf(w)) * 57.29578f;
+    }
+
+    // Fused attitude at device time t, nlerp between the packets around it
+    bool attitudeAt(const std::vector<Frame> &frames, size_t from, uint32_t t, Quaternion &out)
+    {
+        const PredictionConfig hold;
+        for (size_t j = from; j + 1 < frames.size(); j++)
+        {
+            uint32_t a = frames[j].sensorUs, b = frames[j + 1].sensorUs;
+            if ((int32_t)(b - t) < 0)
+                continue;
+            if (b - a > 50000)
+                return false; // a gap: nothing to compare against
+            float w = (float)(t - a) / (b - a);
+            Quaternion qa = frames[j].p.predict(0, hold), qb = frames[j + 1].p.predict(0, hold);
+            if (qa.w * qb.w + qa.x * qb.x + qa.y * qb.y + qa.z * qb.z < 0)
+            {
+                qb.w = -qb.w, qb.x = -qb.x, qb.y = -qb.y, qb.z = -qb.z;
+            }
+            out.w = qa.w + (qb.w - qa.w) * w;
+            out.x = qa.x + (qb.x - qa.x) * w;
+            out.y = qa.y + (qb.y - qa.y) * w;
+            out.z = qa.z + (qb.z - qa.z) * w;
+            float n = 1.0f / sqrtf(out.w * out.w + out.x * out.x + out.y * out.y + out.z * out.z);
+            out.w *= n, out.x *= n, out.y *= n, out.z *= n;
+            return true;
+        }
+        return false;
+    }
+
+    struct ErrorSet
+    {
+        std::vector<float> deg;
+        void summary(float &mean, float &p99)
+        {
+            mean = p99 = 0;
+            if (deg.empty())
+                return;
+            std::sort(deg.begin(), deg.end());
+            double sum = 0;
+            for (float d : deg)
+                sum += d;
+            mean = (float)(sum / deg.size());
+            p99 = deg[(size_t)(deg.size() * 0.99)];
+        }
+    };
+}
+
+int benchPredict(int argc, char **argv)
+{
+    const char *path = argc > 0 ? argv[0] : nullptr;
+    std::vector<uint8_t> capture;
+    if (path)
+    {
+        if (FILE *f = fopen(path, "rb"))
+        {
+            uint8_t buf[4096];
+            while (size_t n = fread(buf, 1, sizeof(buf), f))
+                capture.insert(capture.end(), buf, buf + n);
+            fclose(f);
+        }
+    }
+    if (capture.empty())
+    {
+        recordFlicks(8000, capture);
+        printf("== predict: synthetic wrist flicks, 8000 packets (%.0f s) ==\n", 8000 * 0.015f);
+        if (path)
+        {
+            if (FILE *f = fopen(path, "wb"))
+            {
+                fwrite(capture.data(), 1, capture.size(), f);
+                fclose(f);
+                printf("written to %s\n", path);
+            }
+        }
+    }
+    else
+        printf("== predict: %s, %zu bytes ==\n", path, capture.size());
+
+    std::vector<Frame> frames = replay(capture);
+    if (frames.size() < 100)
+    {
+        printf("trace too short (%zu packets)\n", frames.size());
+        return 1;
+    }
+    // The filter settles over the first second
+    const size_t skip = 70;
+
+    PredictionConfig rateOnly, withAccel;
+    withAccel.useAccel = true;
+    printf("error vs the fused attitude h ms later, degrees (mean / p99), %zu packets\n", frames.size() - skip);
+    printf("%6s  %15s  %15s  %15s\n", "h ms", "hold", "rate", "rate+accel");
+    for (int h : kHorizonsMs)
+    {
+        ErrorSet e[3];
+        for (size_t i = skip; i < frames.size(); i++)
+        {
+            Quaternion later;
+            if (!attitudeAt(frames, i, frames[i].sensorUs + h * 1000, later))
+                continue;
+            const OrientationPredictor &p = frames[i].p;
+            e[0].deg.push_back(angleDeg(p.predict(0, rateOnly), later));
+            e[1].deg.push_back(angleDeg(p.predict(h * 1e-3f, rateOnly), later));
+            e[2].deg.push_back(angleDeg(p.predict(h * 1e-3f, withAccel), later));
+        }
+        float mean[3], p99[3];
+        for (int k = 0; k < 3; k++)
+            e[k].summary(mean[k], p99[k]);
+        printf("%6d  %6.3f / %6.3f  %6.3f / %6.3f  %6.3f / %6.3f\n", h, mean[0], p99[0], mean[1], p99[1], mean[2],
+               p99[2]);
+    }
+
+    // What the automatic horizon would pick on this trace (arrival jitter
+    // over the best case plus the base), no pipeline delay added
+    PredictionConfig autoCfg;
+    OrientationPredictor clock;
+    BenchStats horizon;
+    for (const Frame &f : frames)
+        horizon.add((uint32_t)(clock.horizonMs(f.stampUs, f.stampUs, f.sensorUs, autoCfg) * 1000));
+    horizon.report("auto horizon", "us");
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Power-on -> first controller report, cold (scan + GATT discovery) versus
+// cached (direct connect to the bonded address, handles from NVS). Virtual
+// time; link costs are modelled by the fake client, not measured on air.
+#include <memory>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    // Modelled link costs
+    constexpr uint32_t kConnectMs = 30;    // connection establishment
+    constexpr uint32_t kDiscoveryMs = 700; // primary + characteristic + descriptor discovery
+    constexpr uint32_t kAdvertiseMs = 100; // controller advertising interval
+    constexpr uint32_t kPacketMs = 15;     // full frame spacing once streaming
+
+    struct Boot
+    {
+        uint32_t connectMs = 0;    // manager: power-on -> link ready
+        int32_t firstReportMs = -1; // power-on -> first full frame queued
+        bool direct = false;
+        uint32_t discoveries = 0;
+    };
+
+    struct ReconnectSim
+    {
+        FakeGearVR dev;
+        std::unique_ptr<GearVR> gear;
+        std::unique_ptr<BLEManager<>> mgr;
+        BLEScan *scan = BLEDevice::getScan();
+        bool streaming = false;
+        uint32_t peerOnAt = 0; // peer neither advertises nor accepts links before this
+
+        ReconnectSim()
+        {
+            dev.client()->connectMs = kConnectMs;
+            dev.client()->discoveryMs = kDiscoveryMs;
+            dev.writeChar()->onWrite([this](const uint8_t *d, size_t len, bool) {
+                if (len >= 1 && d[0] == 0x01) // Sensor command starts the stream
+                    streaming = true;
+            });
+            BLEDevice::setClientFactory([this]() { return dev.client(); });
+        }
+
+        // Fresh firmware objects, as after a reset
+        void powerOn()
+        {
+            dev.client()->disconnect();
+            streaming = false;
+            mgr.reset();
+            gear.reset(new GearVR());
+            mgr.reset(new BLEManager<>());
+            mgr->registerHandler(gear.get());
+            mgr->init();
+        }
+
+        Boot run(uint32_t limitMs)
+        {
+            Boot b;
+            uint32_t start = millis();
+            uint32_t discoveries = dev.client()->discoveries();
+            uint32_t windowStart = 0, starts = scan->startCalls();
+            while (millis() - start < limitMs)
+            {
+                uint32_t now = millis();
+                dev.client()->setConnectable(now >= peerOnAt);
+                if (scan->startCalls() != starts)
+                {
+                    starts = scan->startCalls();
+                    windowStart = now;
+                }
+                if (scan->isScanning())
+                {
+                    double intervalMs = scan->interval() * 0.625, windowMs = scan->window() * 0.625;
+                    bool listening = fmod(now - windowStart, intervalMs) < windowMs;
+                    if (now >= peerOnAt && now % kAdvertiseMs == 0 && listening)
+                    {
+                        BLEAdvertisedDevice adv;
+                        uint8_t mac[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x01};
+                        adv.setName("Gear VR Controller(ABCD)");
+                        adv.setAddress(BLEAddress(mac));
+                        scan->deliver(adv);
+                    }
+                    if (now - windowStart >= scan->lastDuration() * 1000)
+                        scan->complete();
+                }
+                if (streaming && dev.client()->isConnected() && now % kPacketMs == 0)
+                    dev.sendPacket();
+                mgr->update(1);
+                if (gear->rx().pushed() > 0)
+                {
+                    b.firstReportMs = (int32_t)(millis() - start);
+                    break;
+                }
+                // connect/discovery already advanced the clock inside update()
+                if (millis() == now)
+                    hal::advanceUs(1000);
+            }
+            b.connectMs = mgr->lastConnectMs();
+            b.direct = mgr->lastConnectDirect();
+            b.discoveries = dev.client()->discoveries() - discoveries;
+            return b;
+        }
+    };
+
+    void print(const char *label, const Boot &b)
+    {
+        printf("%-22s link %5u ms  first report %5d ms  %s, %u discoveries\n", label, b.connectMs,
+               b.firstReportMs, b.direct ? "direct" : "scanned", b.discoveries);
+    }
+}
+
+int benchReconnect(int argc, char **argv)
+{
+    hal::setTimeUs(1000000);
+    Preferences::eraseAll();
+    ReconnectSim sim;
+    uint32_t nvsWrites = Preferences::writes();
+
+    printf("== reconnect (virtual time; connect %u ms, discovery %u ms, adv every %u ms) ==\n",
+           kConnectMs, kDiscoveryMs, kAdvertiseMs);
+
+    sim.powerOn();
+    Boot cold = sim.run(20000);
+    print("cold boot (empty NVS)", cold);
+
+    sim.powerOn();
+    Boot warm = sim.run(20000);
+    print("warm boot (cached)", warm);
+
+    // Link drop with the manager still running
+    sim.dev.client()->disconnect();
+    sim.streaming = false;
+    uint32_t before = sim.gear->rx().pushed();
+    Boot drop;
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < 20000 && sim.gear->rx().pushed() == before; i++)
+    {
+        if (sim.streaming && millis() % kPacketMs == 0)
+            sim.dev.sendPacket();
+        uint32_t now = millis();
+        sim.mgr->update(1);
+        if (millis() == now)
+            hal::advanceUs(1000);
+    }
+    drop.firstReportMs = (int32_t)(millis() - start);
+    drop.connectMs = sim.mgr->lastConnectMs();
+    drop.direct = sim.mgr->lastConnectDirect();
+    print("link drop (cached)", drop);
+
+    // Peer firmware moved its attributes: the stack fails the subscribe (a
+    // GATTC event, not the call), the entry is forgotten, rescan + discovery
+    BLERemoteCharacteristic *n = sim.dev.notifyChar();
+    uint16_t notifyHandle = n->getHandle();
+    n->setHandle((uint16_t)(notifyHandle + 0x40));
+    sim.powerOn();
+    Boot stale = sim.run(20000);
+    print("stale handles", stale);
+    n->setHandle(notifyHandle);
+
+    // Attributes swapped: every raw request succeeds on the wrong one and no
+    // stream starts; the handshake parks, then the same rediscovery
+    sim.powerOn();
+    sim.run(20000); // cache the real handles again
+    BLERemoteCharacteristic *w = sim.dev.writeChar();
+    const uint16_t writeHandle = w->getHandle();
+    w->setHandle(notifyHandle);
+    n->setHandle(writeHandle);
+    sim.powerOn();
+    Boot silent = sim.run(20000);
+    print("swapped handles", silent);
+    w->setHandle(writeHandle);
+    n->setHandle(notifyHandle);
+
+    // Controller still off at power-on: direct connect times out, then scan
+    sim.peerOnAt = millis() + 3000;
+    sim.powerOn();
+    Boot late = sim.run(20000);
+    print("peer on after 3 s", late);
+
+    printf("cached boot saves %d ms (%.0f%%) to first report; %u NVS blob writes in total\n",
+           cold.firstReportMs - warm.firstReportMs,
+           100.0 * (cold.firstReportMs - warm.firstReportMs) / cold.firstReportMs,
+           Preferences::writes() - nvsWrites);
+    return 0;
+}
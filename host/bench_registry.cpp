@@ -0,0 +1,208 @@
+// Handler registry, run-time vs compile-time: the same N Gear VRs behind
+// BLEManager<> (registerHandler(), virtual calls) and BLEManager<GearVR, ...>
+// (constant advertisement index, direct calls). Per call, in cycles:
+//  - scan: an advertisement from another device reaching the scan callback
+//  - idle pass: update() with every link up and nothing to do
+//  - busy pass: update() with one notification waiting per link
+//
+//   universal_host registry [passes]   (default 20000)
+#include <memory>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint32_t kAdvertiseMs = 100;
+
+    // Devices that are not controllers, named and unnamed
+    std::vector<BLEAdvertisedDevice> strangers()
+    {
+        static const char *kNames[] = {"LE-Bose QC35 II", "Mi Smart Band 4", "Gear VR Cam", "Jabra Elite 75t"};
+        std::vector<BLEAdvertisedDevice> v;
+        for (int i = 0; i < 16; i++)
+        {
+            std::vector<uint8_t> p = {0x02, 0x01, 0x06};
+            if (i % 4 != 3)
+            {
+                const char *name = kNames[i % 4];
+                p.push_back((uint8_t)(strlen(name) + 1));
+                p.push_back(0x09);
+                p.insert(p.end(), name, name + strlen(name));
+            }
+            else
+            {
+                const uint8_t mfg[] = {0x06, 0xFF, 0x4C, 0x00, 0x10, 0x05, (uint8_t)i};
+                p.insert(p.end(), mfg, mfg + sizeof(mfg));
+            }
+            BLEAdvertisedDevice adv;
+            adv.setPayload(p.data(), p.size());
+            uint8_t mac[6] = {0x10, 0x20, 0x30, 0x40, 0x50, (uint8_t)i};
+            adv.setAddress(BLEAddress(mac));
+            v.push_back(adv);
+        }
+        return v;
+    }
+
+    // BLEManager<GearVR x N>
+    template <size_t N, typename... Gs>
+    struct StaticOf : StaticOf<N - 1, GearVR, Gs...>
+    {
+    };
+    template <typename... Gs>
+    struct StaticOf<0, Gs...>
+    {
+        using type = BLEManager<Gs...>;
+    };
+
+    template <typename M, size_t... I>
+    void ownGears(M &mgr, std::vector<GearVR *> &out, std::index_sequence<I...>)
+    {
+        (out.push_back(&mgr.template handler<I>()), ...);
+    }
+
+    struct Result
+    {
+        BenchStats scan, idle, busy;
+        uint32_t frames = 0;
+        bool linked = false;
+    };
+
+    // N fake controllers linked to `mgr`, whose handlers are `gears`
+    void measure(BLEManagerBase &mgr, const std::vector<GearVR *> &gears, int passes, Result &r)
+    {
+        const size_t n = gears.size();
+        std::vector<std::unique_ptr<FakeGearVR>> devs;
+        for (size_t i = 0; i < n; i++)
+            devs.emplace_back(new FakeGearVR());
+        size_t clients = 0;
+        BLEDevice::setClientFactory([&]() { return devs[clients++]->client(); });
+        Preferences::eraseAll();
+        hal::enableTasks(false);
+        mgr.init();
+
+        // Scanning with every slot idle: strangers only
+        BLEScan *scan = BLEDevice::getScan();
+        std::vector<BLEAdvertisedDevice> others = strangers();
+        for (int i = 0; i < passes; i++)
+        {
+            const BLEAdvertisedDevice &adv = others[i % others.size()];
+            uint32_t t0 = ESP.getCycleCount();
+            scan->deliver(adv);
+            r.scan.add(ESP.getCycleCount() - t0);
+        }
+
+        // Link them all, advertising in slot order
+        uint32_t start = millis();
+        while (mgr.links() < n && millis() - start < 10000)
+        {
+            uint32_t now = millis();
+            if (scan->isScanning() && now % kAdvertiseMs == 0)
+                for (size_t i = 0; i < n; i++)
+                {
+                    if (mgr.connected(i))
+                        continue;
+                    BLEAdvertisedDevice adv;
+                    uint8_t mac[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, (uint8_t)(i + 1)};
+                    adv.setName("Gear VR Controller(ABCD)");
+                    adv.setAddress(BLEAddress(mac));
+                    scan->deliver(adv);
+                }
+            mgr.update(1);
+            hal::advanceUs(1000);
+        }
+        r.linked = mgr.links() == n;
+        if (r.linked)
+        {
+            // settle the handshake and stream start
+            for (int i = 0; i < 500; i++)
+            {
+                mgr.update(1);
+                hal::advanceUs(1000);
+            }
+            HidOut = HidOutput();
+            hal::hid.keep = false;
+            uint32_t before = 0;
+            for (GearVR *g : gears)
+                before += g->joy.state.updateCounts;
+            for (int i = 0; i < passes; i++)
+            {
+                uint32_t t0 = ESP.getCycleCount();
+                mgr.update(1);
+                r.idle.add(ESP.getCycleCount() - t0);
+                hal::advanceUs(1000);
+            }
+            for (int i = 0; i < passes; i++)
+            {
+                for (auto &d : devs)
+                    d->sendPacket();
+                uint32_t t0 = ESP.getCycleCount();
+                mgr.update(1);
+                r.busy.add(ESP.getCycleCount() - t0);
+                hal::advanceUs(15000);
+            }
+            for (GearVR *g : gears)
+                r.frames += g->joy.state.updateCounts;
+            r.frames -= before;
+        }
+        for (auto &d : devs)
+            d->client()->disconnect();
+        BLEDevice::setClientFactory(nullptr);
+    }
+
+    template <size_t N>
+    bool compare(int passes)
+    {
+        Result rt, ct;
+        {
+            hal::setTimeUs(1000000);
+            std::unique_ptr<BLEManager<>> mgr(new BLEManager<>());
+            std::unique_ptr<GearVR[]> own(new GearVR[N]);
+            std::vector<GearVR *> gears;
+            for (size_t i = 0; i < N; i++)
+            {
+                mgr->registerHandler(&own[i]);
+                gears.push_back(&own[i]);
+            }
+            measure(*mgr, gears, passes, rt);
+        }
+        {
+            hal::setTimeUs(1000000);
+            using Static = typename StaticOf<N>::type;
+            std::unique_ptr<Static> mgr(new Static());
+            std::vector<GearVR *> gears;
+            ownGears(*mgr, gears, std::make_index_sequence<N>());
+            measure(*mgr, gears, passes, ct);
+        }
+        printf("%zu controller%s:\n", N, N > 1 ? "s" : "");
+        if (!rt.linked || !ct.linked)
+        {
+            printf("  not every controller linked (run-time %d, compile-time %d)\n", rt.linked, ct.linked);
+            return false;
+        }
+        rt.scan.report("  scan, run-time", "cyc");
+        ct.scan.report("  scan, compile-time", "cyc");
+        rt.idle.report("  idle pass, run-time", "cyc");
+        ct.idle.report("  idle pass, compile-time", "cyc");
+        rt.busy.report("  busy pass, run-time", "cyc");
+        ct.busy.report("  busy pass, compile-time", "cyc");
+        printf("  frames handled: run-time %u, compile-time %u (expected %u)\n", rt.frames, ct.frames,
+               (uint32_t)(passes * N));
+        return rt.frames == ct.frames;
+    }
+}
+
+int benchRegistry(int argc, char **argv)
+{
+    int passes = argc > 0 ? atoi(argv[0]) : 20000;
+    if (passes <= 0)
+        passes = 20000;
+    printf("== registry: run-time registerHandler() vs BLEManager<GearVR, ...>, %d calls each ==\n", passes);
+    bool ok = compare<1>(passes);
+    ok = compare<2>(passes) && ok;
+    ok = compare<3>(passes) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Scan scheduling in virtual time: radio usage while idle, scan-to-match
+// latency after boot, after a disconnect and during backoff, and the hard
+// stop on timeout.
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+
+namespace
+{
+    struct ScanSim
+    {
+        BLEManager<> mgr;
+        GearVR gear;
+        FakeGearVR dev;
+        BLEScan *scan = BLEDevice::getScan();
+        uint32_t windowStart = 0;
+        uint32_t starts = 0;
+        double radioOnMs = 0; // scan-window time actually listening
+
+        ScanSim()
+        {
+            BLEDevice::setClientFactory([this]() { return dev.client(); });
+            mgr.registerHandler(&gear);
+            mgr.init();
+        }
+
+        // Drop the link; the cached peer is forgotten so every case scans
+        void disconnect()
+        {
+            mgr.peers().clear();
+            dev.client()->disconnect();
+        }
+
+        // Run the main loop at 1 ms; the peer advertises every 100 ms from
+        // `advertiseAt` (0 = never). Returns ms from `advertiseAt` to connect.
+        int32_t run(uint32_t ms, uint32_t advertiseAt = 0)
+        {
+            int32_t matched = -1;
+            for (uint32_t i = 0; i < ms; i++)
+            {
+                uint32_t now = millis();
+                if (scan->startCalls() != starts)
+                {
+                    starts = scan->startCalls();
+                    windowStart = now;
+                }
+                if (scan->isScanning())
+                {
+                    double intervalMs = scan->interval() * 0.625, windowMs = scan->window() * 0.625;
+                    radioOnMs += windowMs / intervalMs;
+                    bool listening = fmod(now - windowStart, intervalMs) < windowMs;
+                    if (advertiseAt && now >= advertiseAt && now % 100 == 0 && listening)
+                    {
+                        BLEAdvertisedDevice adv;
+                        adv.setName("Gear VR Controller(ABCD)");
+                        scan->deliver(adv);
+                    }
+                    if (now - windowStart >= scan->lastDuration() * 1000)
+                        scan->complete();
+                }
+                mgr.update(1);
+                if (matched < 0 && mgr.GetState() == SystemState::Connected)
+                    return (int32_t)(now - advertiseAt);
+                hal::advanceUs(1000);
+            }
+            return matched;
+        }
+    };
+
+    const char *phaseName(BLEManagerBase &m)
+    {
+        switch (m.GetState())
+        {
+        case SystemState::Scanning:
+            return "scanning";
+        case SystemState::Connected:
+            return "connected";
+        default:
+            return "idle";
+        }
+    }
+}
+
+int benchScan(int argc, char **argv)
+{
+    hal::setTimeUs(1000000);
+    ScanSim sim;
+
+    printf("== scan scheduler (virtual time, 1 ms loop) ==\n");
+
+    // Peer shows up 2.5 s after boot
+    int32_t boot = sim.run(10000, millis() + 2500);
+    printf("boot:       match+connect %d ms after first advertisement\n", boot);
+
+    // Link drops; peer re-advertises 400 ms later (burst window)
+    sim.disconnect();
+    int32_t burst = sim.run(20000, millis() + 400);
+    printf("disconnect: match+connect %d ms after re-advertising (burst)\n", burst);
+
+    // Link drops; peer stays silent for 45 s (scheduler is backing off)
+    sim.disconnect();
+    int32_t late = sim.run(120000, millis() + 45000);
+    printf("late peer:  match+connect %d ms after advertising resumed (backoff)\n", late);
+
+    const ScanStats &st = sim.mgr.scanStats();
+    printf("latency stats: matches=%u min=%u avg=%u max=%u ms (session start -> match)\n",
+           st.matches, st.minLatencyMs, st.avgLatencyMs(), st.maxLatencyMs);
+
+    // Nobody around: 10 minutes idle
+    sim.disconnect();
+    uint32_t startsBefore = sim.scan->startCalls();
+    sim.radioOnMs = 0;
+    sim.run(600000);
+    printf("idle 600 s: %u scan starts, radio listening %.1f s (%.2f%%), state=%s, timeouts=%u\n",
+           sim.scan->startCalls() - startsBefore, sim.radioOnMs / 1000.0, sim.radioOnMs / 6000.0,
+           phaseName(sim.mgr), sim.mgr.scanStats().timeouts);
+    printf("legacy loop: one BLEScan::start per loop() => ~600000 calls and 33%% duty for 600 s\n");
+    return 0;
+}
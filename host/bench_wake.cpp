@@ -0,0 +1,166 @@
+// Notify -> HID report latency and idle wake-ups: the event-driven BLE task
+// (blocks on task notifications) against the old loop() that polled update()
+// every 1 ms. Real time and real threads: the bench thread plays the
+// Bluedroid callback, the manager runs on its own thread in both modes.
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <Preferences.h>
+#include "BLEManager.h"
+#include "Bench.h"
+#include "FakeGearVR.h"
+#include "GearVR.h"
+#include "USBHID.h"
+
+namespace
+{
+    constexpr uint32_t kPacketMs = 15; // controller frame spacing
+    constexpr uint32_t kIdleMs = 2000; // controller silent, link up
+
+    struct Result
+    {
+        BenchStats latency; // packet sent -> mouse report recorded, µs
+        uint32_t packets = 0;
+        float streamWakeups = 0; // per second while streaming
+        float idleWakeups = 0;   // per second while the controller is silent
+    };
+
+    // Bonded controller in NVS so init() goes straight to a direct connect
+    void seedCache(FakeGearVR &dev)
+    {
+        GearVR probe;
+        probe.onConnected(dev.client());
+        PeerHandles handles;
+        probe.exportHandles(handles);
+        dev.client()->disconnect();
+
+        const uint8_t mac[6] = {0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x01};
+        Preferences::eraseAll();
+        PeerCache cache;
+        cache.load();
+        cache.remember(mac, 0, 0, handles);
+        cache.save();
+    }
+
+    bool waitConnected(BLEManagerBase &mgr)
+    {
+        for (int i = 0; i < 2000 && !mgr.connected(); i++)
+            delay(1);
+        return mgr.connected();
+    }
+
+    // Streams `packets` frames with a circling thumb (one mouse report each),
+    // then stays silent; `wakeups` reads the mode's service-pass counter
+    template <typename Wakeups>
+    void drive(FakeGearVR &dev, uint32_t packets, Wakeups wakeups, Result &r)
+    {
+        hal::hid.clear();
+        hal::hid.keep = true;
+        std::vector<uint32_t> sent;
+        sent.reserve(packets);
+
+        uint32_t w0 = wakeups();
+        uint64_t t0 = micros();
+        auto next = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < packets; i++)
+        {
+            next += std::chrono::milliseconds(kPacketMs);
+            std::this_thread::sleep_until(next);
+            dev.motion.touchX = (uint16_t)(160 + 80 * cosf(i * 0.2f));
+            dev.motion.touchY = (uint16_t)(160 + 80 * sinf(i * 0.2f));
+            sent.push_back(micros());
+            dev.sendPacket();
+        }
+        delay(20); // let the last frame drain
+        r.streamWakeups = (wakeups() - w0) * 1e6f / (float)(micros() - t0);
+        r.packets = packets;
+
+        // Each mouse report belongs to the latest frame sent before it
+        std::vector<hal::HidReport> log = hal::hid.snapshot();
+        hal::hid.keep = false;
+        size_t s = 0;
+        for (const hal::HidReport &rep : log)
+        {
+            if (rep.iface != hal::kHidMouse)
+                continue;
+            while (s + 1 < sent.size() && (int32_t)(rep.us - sent[s + 1]) >= 0)
+                s++;
+            if ((int32_t)(rep.us - sent[s]) >= 0)
+                r.latency.add(rep.us - sent[s]);
+        }
+
+        uint32_t w1 = wakeups();
+        delay(kIdleMs);
+        r.idleWakeups = (wakeups() - w1) * 1000.0f / kIdleMs;
+    }
+
+    void print(const char *label, Result &r)
+    {
+        printf("-- %s: %u packets, %.0f wake-ups/s streaming, %.1f wake-ups/s idle --\n", label,
+               r.packets, r.streamWakeups, r.idleWakeups);
+        r.latency.report("notify -> mouse report", "us");
+    }
+}
+
+int benchWake(int argc, char **argv)
+{
+    uint32_t packets = argc > 0 ? (uint32_t)atoi(argv[0]) : 400;
+    if (packets == 0)
+        packets = 400;
+    hal::useRealTime();
+
+    printf("== wake (real time; frame every %u ms, %u ms idle) ==\n", kPacketMs, kIdleMs);
+
+    // Old loop(): update() + delay(1) on a thread of its own
+    Result polled;
+    {
+        FakeGearVR dev;
+        seedCache(dev);
+        BLEDevice::setClientFactory([&dev]() { return dev.client(); });
+        GearVR gear;
+        BLEManager<> mgr;
+        mgr.registerHandler(&gear);
+        hal::enableTasks(false);
+        mgr.init();
+
+        std::atomic<bool> run{true};
+        std::atomic<uint32_t> passes{0};
+        std::thread loop([&]() {
+            uint32_t last = millis();
+            while (run)
+            {
+                uint32_t now = millis();
+                mgr.update(now - last);
+                last = now;
+                passes++;
+                delay(1);
+            }
+        });
+        if (!waitConnected(mgr))
+            printf("polled: no link\n");
+        drive(dev, packets, [&]() { return passes.load(); }, polled);
+        run = false;
+        loop.join();
+        dev.client()->disconnect();
+    }
+    print("polled loop (update + delay(1))", polled);
+
+    // BLE task blocking on notifications. The task never exits, so this
+    // mode runs last and the process leaves through _exit().
+    Result evented;
+    static FakeGearVR dev;
+    seedCache(dev);
+    BLEDevice::setClientFactory([]() { return dev.client(); });
+    static GearVR gear;
+    static BLEManager<> mgr;
+    mgr.registerHandler(&gear);
+    hal::enableTasks(true);
+    mgr.init();
+    if (!mgr.taskRunning() || !waitConnected(mgr))
+        printf("evented: no link\n");
+    drive(dev, packets, []() { return mgr.taskWakeups(); }, evented);
+    print("BLE task (notify-driven)", evented);
+
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,127 @@
+#pragma once
+// Host stand-in for the subset of the ESP32 Arduino core used by the sketch.
+// Only compiled by the CMake host target; the Arduino IDE never sees host/.
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using std::max;
+using std::min;
+
+#ifndef RGB_BUILTIN
+#define RGB_BUILTIN 48
+#endif
+#ifndef RGB_BRIGHTNESS
+#define RGB_BRIGHTNESS 64
+#endif
+#define OUTPUT 0x03
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ===== Time =====
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// ===== GPIO / LED =====
+void pinMode(uint8_t pin, uint8_t mode);
+void neopixelWrite(uint8_t pin, uint8_t r, uint8_t g, uint8_t b);
+
+// ===== String =====
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    size_t length() const { return s_.length(); }
+    const char *c_str() const { return s_.c_str(); }
+    bool startsWith(const String &p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+
+private:
+    std::string s_;
+};
+
+// ===== Print / Stream / Serial =====
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (len--)
+            n += write(*buf++);
+        return n;
+    }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t println(const char *s = "") { return print(s) + print("\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+class HostSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t len) override;
+};
+extern HostSerial Serial;
+
+// ===== Chip =====
+class EspClass
+{
+public:
+    // Host: TSC on x86, nanoseconds elsewhere
+    uint32_t getCycleCount();
+};
+extern EspClass ESP;
+
+// ===== FreeRTOS =====
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void (*TaskFunction_t)(void *);
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Host: tasks are not started (handle = nullptr) and the harness drives
+// update() directly, unless hal::enableTasks(true) was called: then each
+// task runs on a detached std::thread against the wall clock.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *param, int prio, TaskHandle_t *handle, int core);
+void vTaskDelay(TickType_t ticks);
+// Task notifications used as a counting semaphore
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+void xTaskNotifyGive(TaskHandle_t task);
+
+// ===== Host clock control (not part of the Arduino API) =====
+namespace hal
+{
+    // Freeze time at an explicit microsecond value (deterministic runs)
+    void setTimeUs(uint64_t us);
+    void advanceUs(uint64_t us);
+    // Back to the wall clock (default)
+    void useRealTime();
+    uint64_t nowUs();
+    // Start xTaskCreatePinnedToCore tasks as threads (wall clock only)
+    void enableTasks(bool on);
+}
@@ -0,0 +1,387 @@
+#pragma once
+// Host stand-in for the ESP32 Arduino BLE client API. Peripherals are fakes
+// populated by the harness: services/characteristics are plain objects and
+// notifications are pushed with BLERemoteCharacteristic::notify().
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// ===== esp-idf bits referenced by the sketch =====
+typedef uint8_t esp_ble_auth_req_t;
+typedef uint8_t esp_ble_io_cap_t;
+typedef uint8_t esp_power_level_t;
+typedef uint8_t esp_ble_addr_type_t;
+#define ESP_LE_AUTH_REQ_SC_MITM_BOND 0x0D
+#define ESP_IO_CAP_IO 0x01
+#define ESP_BLE_ENC_KEY_MASK 0x01
+#define ESP_BLE_ID_KEY_MASK 0x02
+#define ESP_PWR_LVL_P9 7
+#define BLE_ADDR_TYPE_PUBLIC 0x00
+#define BLE_ADDR_TYPE_RANDOM 0x01
+
+typedef uint8_t esp_bd_addr_t[6];
+typedef uint8_t esp_gatt_if_t;
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum
+{
+    ESP_GATT_WRITE_TYPE_NO_RSP = 1,
+    ESP_GATT_WRITE_TYPE_RSP = 2,
+} esp_gatt_write_type_t;
+
+typedef enum
+{
+    ESP_GATT_AUTH_REQ_NONE = 0,
+} esp_gatt_auth_req_t;
+
+typedef enum
+{
+    ESP_GATT_OK = 0x00,
+    ESP_GATT_INVALID_HANDLE = 0x01,
+    ESP_GATT_ERROR = 0x85,
+} esp_gatt_status_t;
+
+typedef enum
+{
+    ESP_GATTC_WRITE_CHAR_EVT = 4,
+    ESP_GATTC_WRITE_DESCR_EVT = 9,
+    ESP_GATTC_NOTIFY_EVT = 10,
+    ESP_GATTC_REG_FOR_NOTIFY_EVT = 38,
+    ESP_GATTC_DISCONNECT_EVT = 41,
+} esp_gattc_cb_event_t;
+
+typedef union
+{
+    struct gattc_write_evt_param
+    {
+        uint16_t conn_id;
+        esp_gatt_status_t status;
+        uint16_t handle;
+        uint16_t offset;
+    } write;
+    struct gattc_reg_for_notify_evt_param
+    {
+        esp_gatt_status_t status;
+        uint16_t handle;
+    } reg_for_notify;
+    struct gattc_notify_evt_param
+    {
+        uint16_t conn_id;
+        esp_bd_addr_t remote_bda;
+        uint16_t handle;
+        uint16_t value_len;
+        uint8_t *value;
+        bool is_notify;
+    } notify;
+} esp_ble_gattc_cb_param_t;
+
+typedef void (*gattc_event_handler)(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                    esp_ble_gattc_cb_param_t *param);
+
+// Raw GATT client calls (routed to the fake peripheral owning the handle).
+// As on the real stack they only queue the request: ESP_OK, with the outcome
+// in a GATTC event to the custom handler (delivered before they return)
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                   uint16_t value_len, uint8_t *value,
+                                   esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_write_char_descr(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                         uint16_t value_len, uint8_t *value,
+                                         esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t gattc_if, esp_bd_addr_t server_bda,
+                                            uint16_t handle);
+
+struct esp_ble_auth_cmpl_t
+{
+    bool success = true;
+    int fail_reason = 0;
+};
+
+class BLEUUID
+{
+public:
+    BLEUUID() {}
+    BLEUUID(const char *s) : s_(s) {}
+    BLEUUID(uint16_t u16);
+    bool equals(const BLEUUID &o) const { return s_ == o.s_; }
+    bool operator==(const BLEUUID &o) const { return equals(o); }
+    bool operator<(const BLEUUID &o) const { return s_ < o.s_; }
+    String toString() const { return String(s_); }
+
+private:
+    std::string s_;
+};
+
+class BLEAddress
+{
+public:
+    BLEAddress() {}
+    explicit BLEAddress(const uint8_t mac[6]) { memcpy(mac_, mac, 6); }
+    esp_bd_addr_t *getNative() { return &mac_; }
+    String toString() const;
+    bool equals(const BLEAddress &o) const { return memcmp(mac_, o.mac_, 6) == 0; }
+
+private:
+    esp_bd_addr_t mac_ = {0};
+};
+
+class BLEAdvertisedDevice
+{
+public:
+    String getName() { return String(name_); }
+    bool haveName() const { return !name_.empty(); }
+    BLEAddress getAddress() const { return addr_; }
+    esp_ble_addr_type_t getAddressType() const { return addrType_; }
+
+    // Raw advertisement + scan response AD structures
+    uint8_t *getPayload() { return payload_.data(); }
+    size_t getPayloadLength() const { return payload_.size(); }
+
+    // Host-only setters. setName() builds a flags + complete-name payload;
+    // setPayload() takes raw AD structures and picks the name out of them.
+    void setName(const char *n);
+    void setPayload(const uint8_t *data, size_t len);
+    void setAddress(const BLEAddress &a, esp_ble_addr_type_t type = BLE_ADDR_TYPE_PUBLIC)
+    {
+        addr_ = a;
+        addrType_ = type;
+    }
+
+private:
+    std::string name_;
+    std::vector<uint8_t> payload_;
+    BLEAddress addr_;
+    esp_ble_addr_type_t addrType_ = BLE_ADDR_TYPE_PUBLIC;
+};
+
+class BLEAdvertisedDeviceCallbacks
+{
+public:
+    virtual ~BLEAdvertisedDeviceCallbacks() {}
+    virtual void onResult(BLEAdvertisedDevice advertisedDevice) = 0;
+};
+
+class BLEScanResults
+{
+public:
+    int getCount() const { return 0; }
+};
+
+class BLEScan
+{
+public:
+    void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks *cb) { cb_ = cb; }
+    void setInterval(uint16_t v) { interval_ = v; }
+    void setWindow(uint16_t v) { window_ = v; }
+    void setActiveScan(bool v) { active_ = v; }
+    // Host: non-blocking; advertisements are injected with deliver() and the
+    // window is ended by the harness with complete()
+    void *start(uint32_t duration, bool is_continue = false);
+    bool start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool is_continue = false);
+    void stop() { scanning_ = false; }
+    void clearResults() {}
+
+    // Host-only
+    void deliver(const BLEAdvertisedDevice &dev)
+    {
+        if (cb_)
+            cb_->onResult(dev);
+    }
+    void complete()
+    {
+        scanning_ = false;
+        if (done_)
+            done_(BLEScanResults());
+    }
+    bool isScanning() const { return scanning_; }
+    uint32_t startCalls() const { return starts_; }
+    uint32_t lastDuration() const { return duration_; }
+    uint16_t interval() const { return interval_; }
+    uint16_t window() const { return window_; }
+
+private:
+    BLEAdvertisedDeviceCallbacks *cb_ = nullptr;
+    uint16_t interval_ = 0, window_ = 0;
+    bool active_ = false;
+    bool scanning_ = false;
+    uint32_t starts_ = 0;
+    uint32_t duration_ = 0;
+    void (*done_)(BLEScanResults) = nullptr;
+};
+
+class BLERemoteCharacteristic;
+
+class BLERemoteDescriptor
+{
+public:
+    BLERemoteDescriptor(BLEUUID uuid, uint16_t handle) : uuid_(uuid), handle_(handle) {}
+    bool writeValue(uint8_t *data, size_t len, bool response = false);
+    BLEUUID getUUID() const { return uuid_; }
+    uint16_t getHandle() const { return handle_; }
+    uint32_t writes() const { return writes_; }
+
+private:
+    BLEUUID uuid_;
+    uint16_t handle_;
+    uint32_t writes_ = 0;
+};
+
+class BLERemoteCharacteristic
+{
+public:
+    typedef std::function<void(BLERemoteCharacteristic *, uint8_t *, size_t, bool)> notify_callback;
+    // Host hook: invoked for every write (fake peripheral logic lives here)
+    typedef std::function<void(const uint8_t *, size_t, bool)> write_hook;
+
+    BLERemoteCharacteristic(BLEUUID uuid, bool canWrite, bool canNotify)
+        : uuid_(uuid), canWrite_(canWrite), canNotify_(canNotify) {}
+
+    bool canWrite() const { return canWrite_; }
+    bool canNotify() const { return canNotify_; }
+    BLEUUID getUUID() const { return uuid_; }
+    uint16_t getHandle() const { return handle_; }
+    void registerForNotify(notify_callback cb, bool notifications = true) { cb_ = cb; }
+    bool writeValue(uint8_t *data, size_t len, bool response = false);
+    BLERemoteDescriptor *getDescriptor(BLEUUID uuid);
+
+    // Host-only
+    void setHandle(uint16_t h) { handle_ = h; }
+    BLERemoteDescriptor *addDescriptor(BLEUUID uuid);
+    BLERemoteDescriptor *descriptorByHandle(uint16_t handle);
+    void onWrite(write_hook hook) { hook_ = hook; }
+    uint32_t failWrites = 0; // next N writes fail (no hook call)
+    // Delivers through registerForNotify, or as a raw GATTC event if the
+    // client subscribed by handle (esp_ble_gattc_register_for_notify)
+    void notify(uint8_t *data, size_t len);
+    void setRawNotify(bool on, uint16_t connId)
+    {
+        rawNotify_ = on;
+        connId_ = connId;
+    }
+    uint32_t writes() const { return writes_; }
+
+private:
+    BLEUUID uuid_;
+    bool canWrite_, canNotify_;
+    uint16_t handle_ = 0;
+    notify_callback cb_;
+    write_hook hook_;
+    uint32_t writes_ = 0;
+    bool rawNotify_ = false;
+    uint16_t connId_ = 0;
+    std::vector<std::unique_ptr<BLERemoteDescriptor>> descriptors_;
+};
+
+class BLERemoteService
+{
+public:
+    explicit BLERemoteService(BLEUUID uuid) : uuid_(uuid) {}
+    BLERemoteCharacteristic *getCharacteristic(BLEUUID uuid);
+    BLEUUID getUUID() const { return uuid_; }
+
+    // Host-only
+    BLERemoteCharacteristic *addCharacteristic(BLEUUID uuid, bool canWrite, bool canNotify);
+    const std::vector<std::unique_ptr<BLERemoteCharacteristic>> &characteristics() const { return chars_; }
+
+private:
+    BLEUUID uuid_;
+    std::vector<std::unique_ptr<BLERemoteCharacteristic>> chars_;
+};
+
+class BLEClient;
+
+class BLEClientCallbacks
+{
+public:
+    virtual ~BLEClientCallbacks() {}
+    virtual void onConnect(BLEClient *pClient) = 0;
+    virtual void onDisconnect(BLEClient *pClient) = 0;
+};
+
+class BLEClient
+{
+public:
+    void setClientCallbacks(BLEClientCallbacks *cb) { cb_ = cb; }
+    bool connect(BLEAdvertisedDevice *dev);
+    bool connect(BLEAddress addr, esp_ble_addr_type_t type = BLE_ADDR_TYPE_PUBLIC,
+                 uint32_t timeoutMs = portMAX_DELAY);
+    void disconnect();
+    bool isConnected() const { return connected_; }
+    BLERemoteService *getService(BLEUUID uuid);
+    void setMTU(uint16_t mtu) { mtu_ = mtu; }
+    uint16_t getMTU() const { return mtu_; }
+    BLEAddress getPeerAddress() const { return peer_; }
+    uint16_t getConnId() const { return connId_; }
+    esp_gatt_if_t getGattcIf() const { return 3; }
+
+    BLEClient();
+    ~BLEClient();
+
+    // Host-only: peripheral attributes, connect policy and simulated link costs
+    BLERemoteService *addService(BLEUUID uuid);
+    void setConnectable(bool ok) { connectable_ = ok; }
+    uint32_t connectMs = 0;   // virtual time spent in a successful connect()
+    uint32_t discoveryMs = 0; // virtual time spent in the first getService()
+    uint32_t discoveries() const { return discoveries_; }
+    // Attribute lookup by handle (raw GATT calls)
+    BLERemoteCharacteristic *charByHandle(uint16_t handle);
+    BLERemoteDescriptor *descByHandle(uint16_t handle);
+    static BLEClient *byConnId(uint16_t connId);
+
+private:
+    BLEClientCallbacks *cb_ = nullptr;
+    BLEAddress peer_;
+    bool connected_ = false;
+    bool connectable_ = true;
+    bool discovered_ = false;
+    uint32_t discoveries_ = 0;
+    uint16_t mtu_ = 23;
+    uint16_t connId_;
+    std::vector<std::unique_ptr<BLERemoteService>> services_;
+    friend class BLERemoteService;
+};
+
+class BLESecurityCallbacks
+{
+public:
+    virtual ~BLESecurityCallbacks() {}
+    virtual uint32_t onPassKeyRequest() = 0;
+    virtual void onPassKeyNotify(uint32_t pass_key) = 0;
+    virtual bool onConfirmPIN(uint32_t pass_key) = 0;
+    virtual bool onSecurityRequest() = 0;
+    virtual void onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl) = 0;
+};
+
+class BLESecurity
+{
+public:
+    void setAuthenticationMode(esp_ble_auth_req_t) {}
+    void setCapability(esp_ble_io_cap_t) {}
+    void setInitEncryptionKey(uint8_t) {}
+};
+
+class BLEDevice
+{
+public:
+    static void init(const char *name) {}
+    static void setMTU(uint16_t mtu) { mtu_ = mtu; }
+    static uint16_t getMTU() { return mtu_; }
+    static void setSecurityCallbacks(BLESecurityCallbacks *) {}
+    static void setPower(esp_power_level_t) {}
+    static BLEScan *getScan();
+    static BLEClient *createClient();
+    static void setCustomGattcHandler(gattc_event_handler handler) { gattc_ = handler; }
+    static gattc_event_handler customGattcHandler() { return gattc_; }
+
+    // Host-only: lets the harness attach fake peripherals to new clients
+    typedef std::function<BLEClient *()> client_factory;
+    static void setClientFactory(client_factory f) { factory_ = f; }
+
+private:
+    static uint16_t mtu_;
+    static client_factory factory_;
+    static gattc_event_handler gattc_;
+};
@@ -0,0 +1,504 @@
+// Host implementations of the Arduino/ESP32 stand-ins in host/hal.
+#include <Arduino.h>
+#include "BLEDevice.h"
+#include "USB.h"
+#include "USBHID.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+HostSerial Serial;
+EspClass ESP;
+ESPUSB USB;
+hal::HidRecorder hal::hid;
+
+// ===== Clock =====
+namespace
+{
+    bool gVirtual = false;
+    uint64_t gVirtualUs = 0;
+    const auto gEpoch = std::chrono::steady_clock::now();
+}
+
+uint64_t hal::nowUs()
+{
+    if (gVirtual)
+        return gVirtualUs;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - gEpoch)
+        .count();
+}
+
+void hal::setTimeUs(uint64_t us)
+{
+    gVirtual = true;
+    gVirtualUs = us;
+}
+
+void hal::advanceUs(uint64_t us)
+{
+    if (gVirtual)
+        gVirtualUs += us;
+}
+
+void hal::useRealTime() { gVirtual = false; }
+
+uint32_t millis() { return (uint32_t)(hal::nowUs() / 1000); }
+uint32_t micros() { return (uint32_t)hal::nowUs(); }
+
+void delayMicroseconds(uint32_t us)
+{
+    if (gVirtual)
+        gVirtualUs += us;
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+
+void pinMode(uint8_t, uint8_t) {}
+void neopixelWrite(uint8_t, uint8_t, uint8_t, uint8_t) {}
+
+// ===== Serial =====
+size_t Print::printf(const char *fmt, ...)
+{
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return 0;
+    return write((const uint8_t *)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+size_t HostSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+size_t HostSerial::write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, stdout); }
+
+// ===== Chip / RTOS =====
+uint32_t EspClass::getCycleCount()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+namespace
+{
+    struct HostTask
+    {
+        std::mutex m;
+        std::condition_variable cv;
+        uint32_t notified = 0;
+    };
+
+    bool gTasks = false;
+    thread_local HostTask *tCurrent = nullptr;
+}
+
+void hal::enableTasks(bool on) { gTasks = on; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *, uint32_t, void *param, int,
+                                   TaskHandle_t *handle, int)
+{
+    if (!gTasks)
+    {
+        if (handle)
+            *handle = nullptr;
+        return pdPASS;
+    }
+    // Never freed: firmware tasks run forever
+    HostTask *t = new HostTask();
+    if (handle)
+        *handle = t;
+    std::thread([t, fn, param]() {
+        tCurrent = t;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+    HostTask *t = tCurrent;
+    if (!t)
+    {
+        // not a host task: nobody can notify us
+        if (ticks != portMAX_DELAY)
+            delay(ticks);
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(t->m);
+    auto ready = [t]() { return t->notified != 0; };
+    if (ticks == portMAX_DELAY)
+        t->cv.wait(lock, ready);
+    else
+        t->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+    uint32_t n = t->notified;
+    t->notified = clearOnExit ? 0 : (n ? n - 1 : 0);
+    return n;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    HostTask *t = (HostTask *)task;
+    if (!t)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(t->m);
+        t->notified++;
+    }
+    t->cv.notify_one();
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// ===== HID recorder =====
+void hal::HidRecorder::record(HidInterface iface, const void *data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    reports[iface]++;
+    if (!keep)
+        return;
+    HidReport r = {};
+    r.iface = iface;
+    r.us = micros();
+    r.len = (uint8_t)std::min(len, sizeof(r.data));
+    memcpy(r.data, data, r.len);
+    log.push_back(r);
+}
+
+uint32_t hal::HidRecorder::total() const
+{
+    uint32_t n = 0;
+    for (uint32_t c : reports)
+        n += c;
+    return n;
+}
+
+void hal::HidRecorder::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(reports, 0, sizeof(reports));
+    log.clear();
+}
+
+// ===== BLE =====
+uint16_t BLEDevice::mtu_ = 23;
+BLEDevice::client_factory BLEDevice::factory_;
+gattc_event_handler BLEDevice::gattc_ = nullptr;
+
+namespace
+{
+    std::vector<BLEClient *> gClients;
+    uint16_t gNextConnId = 0;
+}
+
+BLEUUID::BLEUUID(uint16_t u16)
+{
+    char buf[40];
+    snprintf(buf, sizeof(buf), "0000%04x-0000-1000-8000-00805f9b34fb", u16);
+    s_ = buf;
+}
+
+String BLEAddress::toString() const
+{
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac_[0], mac_[1], mac_[2], mac_[3], mac_[4], mac_[5]);
+    return String(buf);
+}
+
+void BLEAdvertisedDevice::setName(const char *n)
+{
+    name_ = n;
+    size_t len = std::min(name_.size(), (size_t)29);
+    payload_ = {0x02, 0x01, 0x06, (uint8_t)(len + 1), 0x09};
+    payload_.insert(payload_.end(), name_.begin(), name_.begin() + len);
+}
+
+void BLEAdvertisedDevice::setPayload(const uint8_t *data, size_t len)
+{
+    payload_.assign(data, data + len);
+    name_.clear();
+    for (size_t i = 0; i + 1 < len && data[i]; i += data[i] + 1)
+        if (i + 1 + data[i] <= len && (data[i + 1] == 0x08 || data[i + 1] == 0x09))
+            name_.assign((const char *)data + i + 2, data[i] - 1);
+}
+
+void *BLEScan::start(uint32_t duration, bool)
+{
+    scanning_ = true;
+    starts_++;
+    duration_ = duration;
+    done_ = nullptr;
+    return nullptr;
+}
+
+bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool)
+{
+    scanning_ = true;
+    starts_++;
+    duration_ = duration;
+    done_ = scanCompleteCB;
+    return true;
+}
+
+bool BLERemoteDescriptor::writeValue(uint8_t *, size_t, bool)
+{
+    writes_++;
+    return true;
+}
+
+bool BLERemoteCharacteristic::writeValue(uint8_t *data, size_t len, bool response)
+{
+    if (failWrites)
+    {
+        failWrites--;
+        return false;
+    }
+    writes_++;
+    if (hook_)
+        hook_(data, len, response);
+    return true;
+}
+
+BLERemoteDescriptor *BLERemoteCharacteristic::getDescriptor(BLEUUID uuid)
+{
+    for (auto &d : descriptors_)
+        if (d->getUUID() == uuid)
+            return d.get();
+    return nullptr;
+}
+
+BLERemoteDescriptor *BLERemoteCharacteristic::addDescriptor(BLEUUID uuid)
+{
+    descriptors_.emplace_back(new BLERemoteDescriptor(uuid, (uint16_t)(handle_ + descriptors_.size() + 1)));
+    return descriptors_.back().get();
+}
+
+BLERemoteDescriptor *BLERemoteCharacteristic::descriptorByHandle(uint16_t handle)
+{
+    for (auto &d : descriptors_)
+        if (d->getHandle() == handle)
+            return d.get();
+    return nullptr;
+}
+
+void BLERemoteCharacteristic::notify(uint8_t *data, size_t len)
+{
+    if (cb_)
+    {
+        cb_(this, data, len, true);
+        return;
+    }
+    gattc_event_handler h = BLEDevice::customGattcHandler();
+    if (!rawNotify_ || !h)
+        return;
+    esp_ble_gattc_cb_param_t p = {};
+    p.notify.conn_id = connId_;
+    p.notify.handle = handle_;
+    p.notify.value_len = (uint16_t)len;
+    p.notify.value = data;
+    p.notify.is_notify = true;
+    h(ESP_GATTC_NOTIFY_EVT, 3, &p);
+}
+
+BLERemoteCharacteristic *BLERemoteService::getCharacteristic(BLEUUID uuid)
+{
+    for (auto &c : chars_)
+        if (c->getUUID() == uuid)
+            return c.get();
+    return nullptr;
+}
+
+BLERemoteCharacteristic *BLERemoteService::addCharacteristic(BLEUUID uuid, bool canWrite, bool canNotify)
+{
+    chars_.emplace_back(new BLERemoteCharacteristic(uuid, canWrite, canNotify));
+    chars_.back()->setHandle((uint16_t)(0x0010 + chars_.size() * 4));
+    return chars_.back().get();
+}
+
+BLEClient::BLEClient() : connId_(gNextConnId++) { gClients.push_back(this); }
+
+BLEClient::~BLEClient() { gClients.erase(std::find(gClients.begin(), gClients.end(), this)); }
+
+BLEClient *BLEClient::byConnId(uint16_t connId)
+{
+    for (BLEClient *c : gClients)
+        if (c->connId_ == connId)
+            return c;
+    return nullptr;
+}
+
+BLERemoteCharacteristic *BLEClient::charByHandle(uint16_t handle)
+{
+    for (auto &s : services_)
+        for (auto &c : s->characteristics())
+            if (c->getHandle() == handle)
+                return c.get();
+    return nullptr;
+}
+
+BLERemoteDescriptor *BLEClient::descByHandle(uint16_t handle)
+{
+    for (auto &s : services_)
+        for (auto &c : s->characteristics())
+            if (BLERemoteDescriptor *d = c->descriptorByHandle(handle))
+                return d;
+    return nullptr;
+}
+
+bool BLEClient::connect(BLEAdvertisedDevice *dev)
+{
+    return dev && connect(dev->getAddress(), dev->getAddressType());
+}
+
+bool BLEClient::connect(BLEAddress addr, esp_ble_addr_type_t, uint32_t timeoutMs)
+{
+    // An absent peer costs the whole timeout; re-connecting an already
+    // linked fake just re-announces the link
+    if (!connectable_)
+    {
+        delay(timeoutMs == portMAX_DELAY ? connectMs : timeoutMs);
+        return false;
+    }
+    delay(connectMs);
+    peer_ = addr;
+    connected_ = true;
+    discovered_ = false;
+    if (cb_)
+        cb_->onConnect(this);
+    return true;
+}
+
+void BLEClient::disconnect()
+{
+    if (!connected_)
+        return;
+    connected_ = false;
+    // notification subscriptions die with the link
+    for (auto &s : services_)
+        for (auto &c : s->characteristics())
+        {
+            c->registerForNotify(nullptr);
+            c->setRawNotify(false, 0);
+        }
+    if (cb_)
+        cb_->onDisconnect(this);
+}
+
+BLERemoteService *BLEClient::getService(BLEUUID uuid)
+{
+    if (!connected_)
+        return nullptr;
+    if (!discovered_)
+    {
+        // full primary service + characteristic + descriptor discovery
+        delay(discoveryMs);
+        discovered_ = true;
+        discoveries_++;
+    }
+    for (auto &s : services_)
+        if (s->getUUID() == uuid)
+            return s.get();
+    return nullptr;
+}
+
+BLERemoteService *BLEClient::addService(BLEUUID uuid)
+{
+    services_.emplace_back(new BLERemoteService(uuid));
+    return services_.back().get();
+}
+
+BLEScan *BLEDevice::getScan()
+{
+    static BLEScan scan;
+    return &scan;
+}
+
+BLEClient *BLEDevice::createClient()
+{
+    if (factory_)
+        return factory_();
+    return new BLEClient();
+}
+
+// ===== Raw GATT client =====
+namespace
+{
+    void gattcEvent(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t &p)
+    {
+        if (gattc_event_handler h = BLEDevice::customGattcHandler())
+            h(event, 3, &p);
+    }
+
+    esp_gatt_status_t writeStatus(BLEClient *c, bool found)
+    {
+        if (!c || !c->isConnected())
+            return ESP_GATT_ERROR;
+        return found ? ESP_GATT_OK : ESP_GATT_INVALID_HANDLE;
+    }
+}
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t, uint16_t conn_id, uint16_t handle,
+                                   uint16_t value_len, uint8_t *value,
+                                   esp_gatt_write_type_t write_type, esp_gatt_auth_req_t)
+{
+    BLEClient *c = BLEClient::byConnId(conn_id);
+    BLERemoteCharacteristic *chr = c && c->isConnected() ? c->charByHandle(handle) : nullptr;
+    if (chr)
+        chr->writeValue(value, value_len, write_type == ESP_GATT_WRITE_TYPE_RSP);
+    esp_ble_gattc_cb_param_t p = {};
+    p.write.conn_id = conn_id;
+    p.write.status = writeStatus(c, chr != nullptr);
+    p.write.handle = handle;
+    gattcEvent(ESP_GATTC_WRITE_CHAR_EVT, p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_write_char_descr(esp_gatt_if_t, uint16_t conn_id, uint16_t handle,
+                                         uint16_t value_len, uint8_t *value,
+                                         esp_gatt_write_type_t write_type, esp_gatt_auth_req_t)
+{
+    BLEClient *c = BLEClient::byConnId(conn_id);
+    BLERemoteDescriptor *d = c && c->isConnected() ? c->descByHandle(handle) : nullptr;
+    if (d)
+        d->writeValue(value, value_len, write_type == ESP_GATT_WRITE_TYPE_RSP);
+    esp_ble_gattc_cb_param_t p = {};
+    p.write.conn_id = conn_id;
+    p.write.status = writeStatus(c, d != nullptr);
+    p.write.handle = handle;
+    gattcEvent(ESP_GATTC_WRITE_DESCR_EVT, p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t, esp_bd_addr_t server_bda, uint16_t handle)
+{
+    esp_ble_gattc_cb_param_t p = {};
+    p.reg_for_notify.status = ESP_GATT_INVALID_HANDLE;
+    p.reg_for_notify.handle = handle;
+    for (uint16_t id = 0; id < gNextConnId; id++)
+    {
+        BLEClient *c = BLEClient::byConnId(id);
+        if (!c || !c->isConnected() || memcmp(*c->getPeerAddress().getNative(), server_bda, 6) != 0)
+            continue;
+        if (BLERemoteCharacteristic *chr = c->charByHandle(handle))
+        {
+            chr->setRawNotify(true, id);
+            p.reg_for_notify.status = ESP_GATT_OK;
+            break;
+        }
+    }
+    gattcEvent(ESP_GATTC_REG_FOR_NOTIFY_EVT, p);
+    return ESP_OK;
+}
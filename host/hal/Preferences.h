@@ -0,0 +1,72 @@
+#pragma once
+// Host stand-in for the ESP32 Preferences (NVS) API. Namespaces live in a
+// process-wide map so data survives Preferences objects, like flash does.
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = nullptr)
+    {
+        ns_ = &store()[name];
+        readOnly_ = readOnly;
+        return true;
+    }
+    void end() { ns_ = nullptr; }
+
+    bool clear()
+    {
+        if (!ns_ || readOnly_)
+            return false;
+        ns_->clear();
+        return true;
+    }
+    bool remove(const char *key) { return ns_ && !readOnly_ && ns_->erase(key) > 0; }
+    bool isKey(const char *key) const { return ns_ && ns_->count(key) > 0; }
+
+    size_t putBytes(const char *key, const void *value, size_t len)
+    {
+        if (!ns_ || readOnly_)
+            return 0;
+        const uint8_t *p = (const uint8_t *)value;
+        (*ns_)[key].assign(p, p + len);
+        writes()++;
+        return len;
+    }
+    size_t getBytesLength(const char *key) const
+    {
+        if (!ns_)
+            return 0;
+        auto it = ns_->find(key);
+        return it == ns_->end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char *key, void *buf, size_t maxLen) const
+    {
+        size_t len = getBytesLength(key);
+        if (!len || len > maxLen)
+            return 0;
+        memcpy(buf, ns_->find(key)->second.data(), len);
+        return len;
+    }
+
+    // Host-only: wipe every namespace ("erase flash") and count writes
+    static void eraseAll() { store().clear(); }
+    static uint32_t &writes()
+    {
+        static uint32_t n = 0;
+        return n;
+    }
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+    static std::map<std::string, Namespace> &store()
+    {
+        static std::map<std::string, Namespace> s;
+        return s;
+    }
+    Namespace *ns_ = nullptr;
+    bool readOnly_ = false;
+};
@@ -0,0 +1,13 @@
+#pragma once
+// Host stand-in for the TinyUSB device wrapper.
+#include <Arduino.h>
+
+class ESPUSB
+{
+public:
+    void productName(const char *) {}
+    void manufacturerName(const char *) {}
+    void serialNumber(const char *) {}
+    bool begin() { return true; }
+};
+extern ESPUSB USB;
@@ -0,0 +1,84 @@
+#pragma once
+// Host stand-in for the USB HID class. Every report that would go on the wire
+// is counted per interface and optionally kept for inspection by the harness.
+#include <Arduino.h>
+#include <mutex>
+#include <vector>
+
+namespace hal
+{
+    enum HidInterface : uint8_t
+    {
+        kHidMouse,
+        kHidKeyboard,
+        kHidConsumer,
+        kHidAbsolute,
+        kHidOther,
+        kHidInterfaceCount
+    };
+
+    struct HidReport
+    {
+        uint8_t iface;
+        uint32_t us;
+        uint8_t len;
+        uint8_t data[8];
+    };
+
+    struct HidRecorder
+    {
+        uint32_t reports[kHidInterfaceCount] = {0};
+        bool keep = false;
+        std::vector<HidReport> log;
+
+        void record(HidInterface iface, const void *data, size_t len);
+        uint32_t total() const;
+        void clear();
+        // Copy of the log, safe while a host task is still reporting
+        std::vector<HidReport> snapshot()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return log;
+        }
+
+    private:
+        std::mutex mutex_;
+    };
+    extern HidRecorder hid;
+}
+
+// Report IDs of the ESP32 core's composite HID interface
+enum
+{
+    HID_REPORT_ID_NONE,
+    HID_REPORT_ID_KEYBOARD,
+    HID_REPORT_ID_MOUSE,
+    HID_REPORT_ID_GAMEPAD,
+    HID_REPORT_ID_CONSUMER_CONTROL,
+    HID_REPORT_ID_SYSTEM_CONTROL,
+    HID_REPORT_ID_VENDOR
+};
+
+class USBHIDDevice
+{
+public:
+    virtual ~USBHIDDevice() {}
+    virtual uint16_t _onGetDescriptor(uint8_t *buffer) { return 0; }
+};
+
+class USBHID
+{
+public:
+    void begin() {}
+    static bool addDevice(USBHIDDevice *device, uint16_t descriptor_len) { return true; }
+    bool SendReport(uint8_t report_id, const void *data, size_t len, uint32_t timeout_ms = 100)
+    {
+        hal::HidInterface iface = report_id == HID_REPORT_ID_MOUSE      ? hal::kHidMouse
+                                  : report_id == HID_REPORT_ID_KEYBOARD ? hal::kHidKeyboard
+                                  : report_id == HID_REPORT_ID_CONSUMER_CONTROL ? hal::kHidConsumer
+                                  : report_id == HID_REPORT_ID_VENDOR + 1       ? hal::kHidAbsolute // HidAbsPointer
+                                                                                : hal::kHidOther;
+        hal::hid.record(iface, data, len);
+        return true;
+    }
+};
@@ -0,0 +1,20 @@
+#pragma once
+// Host stand-in for the HID consumer-control interface: recording sink.
+#include "USBHID.h"
+
+class USBHIDConsumerControl
+{
+public:
+    void begin() {}
+    size_t press(uint16_t usage)
+    {
+        hal::hid.record(hal::kHidConsumer, &usage, sizeof(usage));
+        return 1;
+    }
+    size_t release()
+    {
+        uint16_t none = 0;
+        hal::hid.record(hal::kHidConsumer, &none, sizeof(none));
+        return 1;
+    }
+};
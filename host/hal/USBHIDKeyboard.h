@@ -0,0 +1,63 @@
+#pragma once
+// Host stand-in for the HID keyboard: recording sink.
+#include "USBHID.h"
+
+#define KEY_LEFT_CTRL 0x80
+#define KEY_LEFT_SHIFT 0x81
+#define KEY_LEFT_ALT 0x82
+#define KEY_LEFT_GUI 0x83
+#define KEY_TAB 0xB3
+
+typedef struct
+{
+    uint8_t modifiers;
+    uint8_t reserved;
+    uint8_t keys[6];
+} KeyReport;
+
+class USBHIDKeyboard
+{
+public:
+    void begin() {}
+    void sendReport(KeyReport *keys) { hal::hid.record(hal::kHidKeyboard, keys, sizeof(KeyReport)); }
+    size_t press(uint8_t k)
+    {
+        if (k >= 0x80 && k < 0x88)
+            report_.modifiers |= (uint8_t)(1 << (k - 0x80));
+        else if (!has(k))
+            for (uint8_t &slot : report_.keys)
+                if (slot == 0)
+                {
+                    slot = k;
+                    break;
+                }
+        sendReport(&report_);
+        return 1;
+    }
+    size_t release(uint8_t k)
+    {
+        if (k >= 0x80 && k < 0x88)
+            report_.modifiers &= (uint8_t) ~(1 << (k - 0x80));
+        else
+            for (uint8_t &slot : report_.keys)
+                if (slot == k)
+                    slot = 0;
+        sendReport(&report_);
+        return 1;
+    }
+    void releaseAll()
+    {
+        report_ = KeyReport{};
+        sendReport(&report_);
+    }
+
+private:
+    KeyReport report_ = {};
+    bool has(uint8_t k) const
+    {
+        for (uint8_t slot : report_.keys)
+            if (slot == k)
+                return true;
+        return false;
+    }
+};
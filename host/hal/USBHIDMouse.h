@@ -0,0 +1,39 @@
+#pragma once
+// Host stand-in for the relative HID mouse: recording sink.
+#include "USBHID.h"
+
+#define MOUSE_LEFT 0x01
+#define MOUSE_RIGHT 0x02
+#define MOUSE_MIDDLE 0x04
+#define MOUSE_BACKWARD 0x08
+#define MOUSE_FORWARD 0x10
+
+class USBHIDMouse
+{
+public:
+    void begin() {}
+    void move(int8_t x, int8_t y, int8_t wheel = 0, int8_t pan = 0)
+    {
+        int8_t r[5] = {(int8_t)buttons_, x, y, wheel, pan};
+        hal::hid.record(hal::kHidMouse, r, sizeof(r));
+    }
+    void click(uint8_t b = MOUSE_LEFT)
+    {
+        buttons(b);
+        buttons(0);
+    }
+    void press(uint8_t b = MOUSE_LEFT) { buttons(buttons_ | b); }
+    void release(uint8_t b = MOUSE_LEFT) { buttons(buttons_ & ~b); }
+    bool isPressed(uint8_t b = MOUSE_LEFT) const { return (buttons_ & b) != 0; }
+    void buttons(uint8_t b)
+    {
+        if (b != buttons_)
+        {
+            buttons_ = b;
+            move(0, 0, 0, 0);
+        }
+    }
+
+private:
+    uint8_t buttons_ = 0;
+};
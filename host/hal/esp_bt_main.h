@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in: nothing from esp_bt_main.h is used directly.
@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in: GAP types live in BLEDevice.h.
+#include "BLEDevice.h"
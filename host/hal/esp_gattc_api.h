@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in: GATTC types and raw client calls live in BLEDevice.h.
+#include "BLEDevice.h"
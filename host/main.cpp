@@ -0,0 +1,75 @@
+// Host profiling harness: runs the real firmware pipeline against the HAL
+// stand-ins in host/hal. Usage: universal_host <bench> [args...]
+#include "Bench.h"
+#include "DeferredLog.h"
+#include "HidAbsPointer.h"
+#include "HidOutput.h"
+#include "USBHIDConsumerControl.h"
+#include "USBHIDKeyboard.h"
+#include "USBHIDMouse.h"
+
+// Sinks normally defined by universal.ino
+USBHIDMouse Mouse;
+USBHIDKeyboard Keyboard;
+USBHIDConsumerControl ConsumerControl;
+HidAbsPointer AbsPointer;
+HidOutput HidOut;
+
+namespace
+{
+    struct BenchEntry
+    {
+        const char *name;
+        int (*fn)(int argc, char **argv);
+        const char *help;
+    };
+
+    const BenchEntry kBenches[] = {
+        {"pipeline", benchPipeline, "[packets]  notify -> parse -> HID cost per packet"},
+        {"layout", benchLayout, "[packets]  PacketField layout decoder vs the hand-written parser"},
+        {"ahrs", benchAhrs, "[packets]  AHRS cycles per update and still-yaw drift"},
+        {"gyrobias", benchGyroBias, "           bias convergence, motion rejection, drift"},
+        {"scan", benchScan, "           scan scheduling: idle radio use, reconnect latency"},
+        {"reconnect", benchReconnect, "           power-on -> first report, cold vs cached peer"},
+        {"advflood", benchAdvFlood, "[adverts]  advertisement matching cost and allocations"},
+        {"cmdqueue", benchCmdQueue, "           command queue cost, bursts, retries"},
+        {"handshake", benchHandshake, "           stream start-up against the fake controller protocol"},
+        {"hidout", benchHidOut, "[packets]  HID report coalescing: reports sent vs suppressed, edges kept"},
+        {"bindings", benchBindings, "[packets]  binding table vs if cascade: equivalence, mapping cost"},
+        {"macro", benchMacro, "[macros]  timed multi-key actions: input path cost, timeline, timing accuracy"},
+        {"pointer", benchPointer, "           pointer filter/curve per setting: rest jitter, slow drag, lag"},
+        {"multi", benchMulti, "[max links]  several controllers: aggregate notify rate, fair HID merge"},
+        {"connect", benchConnect, "[discovery ms]  a second controller connecting while the first streams"},
+        {"registry", benchRegistry, "[passes]  run-time vs compile-time handler registry: scan and update cost"},
+        {"loss", benchLinkLoss, "[packets]  dropped/repeated packets: detection, gap bridging error"},
+        {"predict", benchPredict, "[file.gvc]  orientation prediction error vs horizon on a trace"},
+        {"replay", benchReplay, "[packets | file.gvc]  session capture + deterministic replay"},
+        {"log", benchLog, "[per-producer]  deferred logging: fidelity, call-site cost, concurrency"},
+        {"latency", benchLatency, "[packets]  per-stage latency histograms (LATENCY_TRACE)"},
+        {"wake", benchWake, "[packets]  BLE task wake-ups and notify -> HID latency vs polling"},
+    };
+
+    void usage(const char *self)
+    {
+        printf("usage: %s <bench> [args...]\n", self);
+        for (const BenchEntry &b : kBenches)
+            printf("  %-10s %s\n", b.name, b.help);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : "pipeline";
+    for (const BenchEntry &b : kBenches)
+        if (strcmp(b.name, name) == 0)
+        {
+            int rc = b.fn(argc > 2 ? argc - 2 : 0, argv + 2);
+            // HOST_DEBUG_LOG: no formatter task here, print what the ring kept
+            while (DebugLog.drain(Serial))
+            {
+            }
+            return rc;
+        }
+    usage(argv[0]);
+    return 1;
+}
@@ -4,10 +4,18 @@
 #include <USBHIDMouse.h>
 #include <USBHIDKeyboard.h>
 #include <USBHIDConsumerControl.h>
+#include "DeferredLog.h"
 #include "Helper.h"
+#include "HidAbsPointer.h"
+#include "HidOutput.h"
+#include "LatencyTrace.h"
 
 #include "BLEManager.h"
 #include "GearVR.h"
+#include "PacketCapture.h"
+#if PACKET_CAPTURE
+#include <LittleFS.h>
+#endif
 
 #define RGB_BRIGHTNESS 16
 
@@ -15,17 +23,91 @@ USBHID HID;
 USBHIDMouse Mouse;
 USBHIDKeyboard Keyboard;
 USBHIDConsumerControl ConsumerControl;
+HidAbsPointer AbsPointer; // gyro aiming: cursor placed at the projected point
+HidOutput HidOut; // coalesced reports for the devices above
 
-BLEManager bt;
-GearVR gear;
+// Gear VR controllers served at once, one BLE link slot each (up to
+// BLEManagerBase::kMaxLinks); their HID output is merged
+#ifndef GEARVR_CONTROLLERS
+#define GEARVR_CONTROLLERS 1
+#endif
 
-uint32_t lastMs = 0;
+BLEManager<> bt;
+GearVR gear[GEARVR_CONTROLLERS];
+
+#if PACKET_CAPTURE
+PacketCapture Capture;
+File captureFile;
+const char *const kCapturePath = "/capture.gvc";
+
+// Serial console for session capture:
+//   'c' start capturing to LittleFS, 's' stop,
+//   'd' dump the file over Serial (framed by a "capture <bytes>" line),
+//   'p' / 'P' replay it at original / maximum speed (controller off; scan
+//   and connects are suspended meanwhile, so only this task drives gear[0]
+//   and HidOut)
+void captureCommand(int c)
+{
+    if (c == 'c' && !Capture.active())
+    {
+        captureFile = LittleFS.open(kCapturePath, "w");
+        if (!captureFile)
+        {
+            Serial.println("capture: cannot open file");
+            return;
+        }
+        Capture.begin(captureFile);
+        Serial.println("capture: started");
+    }
+    else if (c == 's' && Capture.active())
+    {
+        Capture.end();
+        while (Capture.pending())
+            delay(5);
+        captureFile.close();
+        Serial.printf("capture: %u records, %u bytes, %u dropped\n", Capture.records(), Capture.bytes(),
+                      Capture.dropped());
+    }
+    else if (c == 'd' && !Capture.active())
+    {
+        File f = LittleFS.open(kCapturePath, "r");
+        if (!f)
+            return;
+        Serial.printf("capture %u\n", (unsigned)f.size());
+        uint8_t buf[256];
+        while (size_t n = f.read(buf, sizeof(buf)))
+            Serial.write(buf, n);
+        f.close();
+    }
+    else if ((c == 'p' || c == 'P') && !Capture.active())
+    {
+        File f = LittleFS.open(kCapturePath, "r");
+        CaptureReader reader(f);
+        if (!f || !reader.begin())
+        {
+            Serial.println("replay: no capture");
+            return;
+        }
+        if (!bt.suspend())
+        {
+            Serial.println("replay: controller connected");
+            f.close();
+            return;
+        }
+        ReplayStats r = replayCapture(reader, gear[0], c == 'p' ? ReplaySpeed::Original : ReplaySpeed::Max);
+        bt.resume();
+        f.close();
+        Serial.printf("replay: %u frames in %u us\n", r.frames, r.elapsedUs);
+    }
+}
+#endif
 
 void setup()
 {
     Serial.begin(115200);
     delay(200);
     Serial.println("ESP32-S3 Universal Controller Adapter");
+    DebugLog.begin(Serial); // GVLOG/BLELOG lines are formatted off the hot path
 
     pinMode(RGB_BUILTIN, OUTPUT);
     neopixelWrite(RGB_BUILTIN, 0, 0, 0);
@@ -37,22 +119,40 @@ void setup()
     Mouse.begin();           // Mouse emulation
     Keyboard.begin();        // Keyboard keys (Alt-Tab, arrows, etc.)
     ConsumerControl.begin(); // Media keys (volume, etc.)
+    AbsPointer.begin();      // Absolute pointer (gyro mode)
     USB.begin();
     Serial.println("USB HID Ready");
-    bt = BLEManager();
-    // Register exactly one device type for now (can add more later)
-    bt.registerHandler(&gear);
+    for (GearVR &g : gear)
+    {
+        g.bindings.loadStored(); // a saved button profile replaces the defaults
+        bt.registerHandler(&g);
+    }
+#if PACKET_CAPTURE
+    LittleFS.begin(true);
+    gear[0].setCapture(&Capture); // first controller's session
+#endif
 
     bt.init();
 }
 
 void loop()
 {
-    uint32_t now = millis();
-    uint32_t tick = (lastMs == 0) ? 0 : (now - lastMs);
-    lastMs = now;
-
-    bt.update(tick);
-
-    delay(1);
+#if LATENCY_TRACE || PACKET_CAPTURE
+    int c = Serial.read();
+#if LATENCY_TRACE
+    // Serial console for the latency histograms: 'l' dumps, 'r' clears
+    if (c == 'l')
+        Latency.dump(Serial);
+    else if (c == 'r')
+        Latency.reset();
+#endif
+#if PACKET_CAPTURE
+    captureCommand(c);
+#endif
+    delay(20);
+#else
+    // BLE, handler timers and HID output all run in the BLE task, woken by
+    // the stack; nothing is left to poll here
+    vTaskDelete(nullptr);
+#endif
 }